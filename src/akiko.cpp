@@ -304,6 +304,62 @@ static smp_comm_pipe requests;
 static volatile int akiko_thread_running;
 static uae_sem_t akiko_sem = 0, sub_sem = 0;
 
+/*
+ * The CD thread sleeps in the request pipe. Besides the commands, the
+ * emulation side posts AKIKO_WAKE when the thread has other work to do:
+ * a q-code or media poll is due, or the sector buffer needs refilling.
+ * At most one wakeup is in flight at a time.
+ */
+#define AKIKO_WAKE 0
+static volatile int akiko_wake_pending;
+
+/* Command latency: submit time of each queued command, in queue order */
+#define AKIKO_TRACE 0
+#define AKIKO_TRACE_SLOTS 128
+static frame_time_t akiko_cmd_time[AKIKO_TRACE_SLOTS];
+static volatile int akiko_cmd_wr, akiko_cmd_rd;
+static unsigned int akiko_cmd_count, akiko_wake_count;
+static frame_time_t akiko_cmd_total, akiko_cmd_max;
+
+static void akiko_thread_wake (void)
+{
+	if (akiko_thread_running <= 0 || akiko_wake_pending)
+		return;
+	akiko_wake_pending = 1;
+	write_comm_pipe_u32 (&requests, AKIKO_WAKE, 1);
+}
+
+/* Queue a command for the CD thread. Arguments follow with write_comm_pipe_u32 (). */
+static void akiko_queue_cmd (uae_u32 cmd, int last)
+{
+	akiko_cmd_time[akiko_cmd_wr & (AKIKO_TRACE_SLOTS - 1)] = read_processor_time ();
+	akiko_cmd_wr++;
+	write_comm_pipe_u32 (&requests, cmd, last);
+}
+
+static void akiko_trace_cmd (uae_u32 cmd)
+{
+	frame_time_t t = read_processor_time () - akiko_cmd_time[akiko_cmd_rd & (AKIKO_TRACE_SLOTS - 1)];
+	akiko_cmd_rd++;
+	akiko_cmd_count++;
+	akiko_cmd_total += t;
+	if (t > akiko_cmd_max)
+		akiko_cmd_max = t;
+#if AKIKO_TRACE
+	write_log (_T("CD32: command %04x started after %d us\n"), cmd, (int)t);
+#endif
+}
+
+static void akiko_trace_stats (void)
+{
+	if (!akiko_cmd_count)
+		return;
+	write_log (_T("CD32: %u commands, avg latency %d us, max %d us, %u wakeups\n"),
+		akiko_cmd_count, (int)(akiko_cmd_total / akiko_cmd_count), (int)akiko_cmd_max, akiko_wake_count);
+	akiko_cmd_count = akiko_wake_count = 0;
+	akiko_cmd_total = akiko_cmd_max = 0;
+}
+
 static void checkint (void)
 {
 	if (cdrom_intreq & cdrom_intena) {
@@ -338,7 +394,7 @@ static void cdaudiostop (void)
 	cdrom_audiotimeout = 0;
 	cdrom_paused = 0;
 	cdrom_playing = 0;
-	write_comm_pipe_u32 (&requests, 0x0104, 1);
+	akiko_queue_cmd (0x0104, 1);
 }
 
 static void subfunc (uae_u8 *data, int cnt)
@@ -458,7 +514,7 @@ static int cd_play_audio (int startlsn, int endlsn, int scan)
 	last_play_end = endlsn;
 	cdrom_audiotimeout = 10;
 	cdrom_paused = 0;
-	write_comm_pipe_u32 (&requests, 0x0110, 0);
+	akiko_queue_cmd (0x0110, 0);
 	write_comm_pipe_u32 (&requests, startlsn, 0);
 	write_comm_pipe_u32 (&requests, endlsn, 0);
 	write_comm_pipe_u32 (&requests, scan, 1);
@@ -745,7 +801,7 @@ static int cdrom_command_pause (void)
 	cdrom_paused = 1;
 	if (!cdrom_playing)
 		return 2;
-	write_comm_pipe_u32 (&requests, 0x0102, 1);
+	akiko_queue_cmd (0x0102, 1);
 	return 2;
 }
 
@@ -761,7 +817,7 @@ static int cdrom_command_unpause (void)
 	cdrom_paused = 0;
 	if (!cdrom_playing)
 		return 2;
-	write_comm_pipe_u32 (&requests, 0x0103, 1);
+	akiko_queue_cmd (0x0103, 1);
 	return 2;
 }
 
@@ -966,6 +1022,22 @@ static void cdrom_run_command_run (void)
 }
 
 /* DMA transfer one CD sector */
+/* True if the CD thread should (re)fill the sector buffer starting at sector */
+static bool sector_buffer_needs_fill (int sector)
+{
+	int i;
+
+	if (sector < 0 || !is_valid_data_sector (sector))
+		return false;
+	if (sector_buffer_sector_1 < 0 || sector < sector_buffer_sector_1 || sector >= sector_buffer_sector_1 + SECTOR_BUFFER_SIZE * 2 / 3)
+		return true;
+	for (i = 0; i < SECTOR_BUFFER_SIZE; i++) {
+		if (sector_buffer_info_1[i] == 0xff)
+			return true;
+	}
+	return false;
+}
+
 static void cdrom_run_read (void)
 {
 	int i, sector, inc;
@@ -1037,6 +1109,8 @@ static void cdrom_run_read (void)
 	}
 	if (inc)
 		cdrom_sector_counter++;
+	if (sector_buffer_needs_fill (cdrom_current_sector))
+		akiko_thread_wake ();
 }
 
 static int lastmediastate = 0;
@@ -1169,10 +1243,14 @@ void AKIKO_hsync_handler (void)
 		subcodecounter = maxvpos * vblank_hz / (75 * cdrom_speed) - 5;
 	}
 
-	if (frame2counter > 0)
-		frame2counter--;
-	if (mediacheckcounter > 0)
-		mediacheckcounter--;
+	if (frame2counter > 0) {
+		if (--frame2counter == 0)
+			akiko_thread_wake ();
+	}
+	if (mediacheckcounter > 0) {
+		if (--mediacheckcounter == 0)
+			akiko_thread_wake ();
+	}
 
 	akiko_internal ();
 	akiko_handler (framesync);
@@ -1187,30 +1265,7 @@ static void *akiko_thread (void *null)
 	int tmp3;
 	int sector;
 
-	while (akiko_thread_running || comm_pipe_has_data (&requests)) {
-
-		if (comm_pipe_has_data (&requests)) {
-			uae_u32 b = read_comm_pipe_u32_blocking (&requests);
-			switch (b)
-			{
-			case 0x0102: // pause
-				sys_command_cd_pause (unitnum, 1);
-				break;
-			case 0x0103: // unpause
-				sys_command_cd_pause (unitnum, 0);
-				break;
-			case 0x0104: // stop
-				cdaudiostop_do ();
-				break;
-			case 0x0105: // mute change
-				sys_command_cd_volume (unitnum, cdrom_muted ? 0 : 0x7fff, cdrom_muted ? 0 : 0x7fff);
-				break;
-			case 0x0110: // do_play!
-				sys_command_cd_volume (unitnum, cdrom_muted ? 0 : 0x7fff, cdrom_muted ? 0 : 0x7fff);
-				cdaudioplay_do ();
-				break;
-			}
-		}
+	for (;;) {
 
 		if (frame2counter <= 0) {
 			frame2counter = 312 * 50 / 2;
@@ -1244,12 +1299,7 @@ static void *akiko_thread (void *null)
 
 		uae_sem_wait (&akiko_sem);
 		sector = cdrom_current_sector;
-		for (i = 0; i < SECTOR_BUFFER_SIZE; i++) {
-			if (sector_buffer_info_1[i] == 0xff)
-				break;
-		}
-		if (sector >= 0 && is_valid_data_sector(sector) &&
-		(sector_buffer_sector_1 < 0 || sector < sector_buffer_sector_1 || sector >= sector_buffer_sector_1 + SECTOR_BUFFER_SIZE * 2 / 3 || i != SECTOR_BUFFER_SIZE)) {
+		if (sector_buffer_needs_fill (sector)) {
 			int blocks;
 			memset (sector_buffer_info_2, 0, SECTOR_BUFFER_SIZE);
 			sector_buffer_sector_2 = sector;
@@ -1289,7 +1339,37 @@ static void *akiko_thread (void *null)
 			}
 		}
 		uae_sem_post (&akiko_sem);
-		sleep_millis (10);
+
+		if (!akiko_thread_running && !comm_pipe_has_data (&requests))
+			break;
+
+		// sleep until a command arrives or the emulation side wakes us
+		uae_u32 b = read_comm_pipe_u32_blocking (&requests);
+		if (b == AKIKO_WAKE) {
+			akiko_wake_pending = 0;
+			akiko_wake_count++;
+			continue;
+		}
+		akiko_trace_cmd (b);
+		switch (b)
+		{
+		case 0x0102: // pause
+			sys_command_cd_pause (unitnum, 1);
+			break;
+		case 0x0103: // unpause
+			sys_command_cd_pause (unitnum, 0);
+			break;
+		case 0x0104: // stop
+			cdaudiostop_do ();
+			break;
+		case 0x0105: // mute change
+			sys_command_cd_volume (unitnum, cdrom_muted ? 0 : 0x7fff, cdrom_muted ? 0 : 0x7fff);
+			break;
+		case 0x0110: // do_play!
+			sys_command_cd_volume (unitnum, cdrom_muted ? 0 : 0x7fff, cdrom_muted ? 0 : 0x7fff);
+			cdaudioplay_do ();
+			break;
+		}
 	}
 	akiko_thread_running = -1;
 	return 0;
@@ -1716,10 +1796,12 @@ void akiko_reset (void)
 	if (akiko_thread_running > 0) {
 		cdaudiostop ();
 		akiko_thread_running = 0;
+		write_comm_pipe_u32 (&requests, AKIKO_WAKE, 1);
 		while(akiko_thread_running == 0)
 			sleep_millis (10);
 	  destroy_comm_pipe(&requests);
 		akiko_thread_running = 0;
+		akiko_trace_stats ();
 	}
 	akiko_cdrom_free ();
 	mediacheckcounter = 0;
@@ -1767,6 +1849,8 @@ int akiko_init (void)
 	patchrom ();
 	if (!akiko_thread_running) {
 		akiko_thread_running = 1;
+		akiko_wake_pending = 0;
+		akiko_cmd_wr = akiko_cmd_rd = 0;
 		init_comm_pipe (&requests, 100, 1);
 		uae_start_thread (_T("akiko"), akiko_thread, 0, NULL);
 	}
@@ -1912,12 +1996,12 @@ void restore_akiko_finish (void)
 	akiko_init ();
 	akiko_c2p_do ();
 	get_cdrom_toc ();
-	write_comm_pipe_u32 (&requests, 0x0102, 1); // pause
-	write_comm_pipe_u32 (&requests, 0x0104, 1); // stop
-	write_comm_pipe_u32 (&requests, 0x0103, 1); // unpause
+	akiko_queue_cmd (0x0102, 1); // pause
+	akiko_queue_cmd (0x0104, 1); // stop
+	akiko_queue_cmd (0x0103, 1); // unpause
 	if (cdrom_playing && isaudiotrack (last_play_pos)) {
-		write_comm_pipe_u32 (&requests, 0x0103, 1); // unpause
-		write_comm_pipe_u32 (&requests, 0x0110, 0); // play
+		akiko_queue_cmd (0x0103, 1); // unpause
+		akiko_queue_cmd (0x0110, 0); // play
 		write_comm_pipe_u32 (&requests, last_play_pos, 0);
 		write_comm_pipe_u32 (&requests, last_play_end, 0);
 		write_comm_pipe_u32 (&requests, 0, 1);
@@ -1931,6 +2015,6 @@ void akiko_mute (int muted)
 {
 	cdrom_muted = muted;
 	if (unitnum >= 0)
-		write_comm_pipe_u32 (&requests, 0x0105, 1);
+		akiko_queue_cmd (0x0105, 1);
 }
 
@@ -1422,6 +1422,7 @@ static void action_replay_setbanks (void)
 			chipmem_bank.lput = chipmem_lput_actionreplay1;
 			break;
 		}
+		memory_direct_update (&chipmem_bank);
 	}
 }
 
@@ -1430,6 +1431,7 @@ static void action_replay_unsetbanks (void)
 	chipmem_bank.bput = chipmem_bput;
 	chipmem_bank.wput = chipmem_wput;
 	chipmem_bank.lput = chipmem_lput;
+	memory_direct_update (&chipmem_bank);
 }
 
 /* param to allow us to unload the cart. Currently we know it is safe if we are doing a reset to unload it.*/
@@ -39,11 +39,50 @@
 
 enum audenc { AUDENC_NONE, AUDENC_PCM, AUDENC_MP3, AUDENC_FLAC };
 
+struct cdtoc;
+
+/* Sector cache. Data sectors are kept as 2352 byte frames: 2352 byte
+ * tracks as is, 2048 and 2336 byte tracks at offset 16 so that the
+ * 2048->2352 conversion (header, EDC/ECC) can be done in place once. */
+#ifndef CD_CACHE_SECTORS
+#define CD_CACHE_SECTORS 256	/* power of two, 0 turns the cache off */
+#endif
+#define CD_READAHEAD_MIN 4
+#define CD_READAHEAD_MAX 64
+
+struct cdcache_entry
+{
+	struct cdtoc *t;
+	int sector;
+	bool l2;	/* header and EDC/ECC already generated */
+	uae_u8 data[2352];
+};
+
+struct cdda_stream
+{
+	uae_sem_t lock;		/* guards buf, start and len */
+	uae_sem_t progress;	/* posted whenever the decoder got further */
+	struct cdtoc *t;
+	uae_u8 *buf;
+	uae_s64 start;		/* decoded byte offset of buf[0] */
+	int len;
+	volatile uae_s64 playpos;	/* next byte the player wants */
+	volatile uae_s64 decpos;	/* where the decoder continues */
+	volatile int idle;
+	volatile bool eof;
+	FLAC__StreamDecoder *flac;
+	mp3decoder *mp3;
+	uae_u8 *tmp;
+	int tmplen, tmpsize;
+	uae_u32 starttime;
+	bool firstdone;
+};
+
 struct cdtoc
 {
 	struct zfile *handle;
 	uae_s64 offset;
-	uae_u8 *data;
+	struct cdda_stream *stream;
 	struct zfile *subhandle;
 	int suboffset;
 	uae_u8 *subdata;
@@ -60,7 +99,6 @@ struct cdtoc
 	int pregap; // sectors of silence
 	int postgap; // sectors of silence
 	audenc enctype;
-	int writeoffset;
 	int subcode;
 };
 
@@ -88,6 +126,14 @@ struct cdunit {
 	TCHAR imgname[MAX_DPATH];
 	uae_sem_t sub_sem;
 	struct device_info di;
+	struct cdda_stream stream;
+
+	uae_sem_t cache_sem;
+	struct cdcache_entry *cache;
+	uae_u8 *ra_buf;
+	struct cdtoc *ra_track;
+	int ra_next, ra_size;
+	uae_u32 cache_hits, cache_misses, cache_readahead;
 };
 
 static struct cdunit cdunits[MAX_TOTAL_SCSI_DEVICES];
@@ -131,9 +177,93 @@ static struct cdtoc *findtoc (struct cdunit *cdu, int *sectorp, bool data)
 	return NULL;
 }
 
+static int cdcache_base (struct cdtoc *t)
+{
+	return t->size == 2352 ? 0 : 16;
+}
+
+/* Caller holds cache_sem */
+static struct cdcache_entry *cdcache_get (struct cdunit *cdu, struct cdtoc *t, int sector)
+{
+	struct cdcache_entry *e;
+	int ssize, count, len, got, i;
+
+	if (CD_CACHE_SECTORS == 0 || !t->handle || t->size > 2352 || sector < 0)
+		return NULL;
+	if (!cdu->cache) {
+		cdu->cache = xcalloc (struct cdcache_entry, CD_CACHE_SECTORS);
+		cdu->ra_buf = xmalloc (uae_u8, CD_READAHEAD_MAX * (2352 + 96));
+		if (!cdu->cache || !cdu->ra_buf) {
+			xfree (cdu->cache);
+			xfree (cdu->ra_buf);
+			cdu->cache = NULL;
+			cdu->ra_buf = NULL;
+			return NULL;
+		}
+	}
+	e = &cdu->cache[sector & (CD_CACHE_SECTORS - 1)];
+	if (e->t == t && e->sector == sector) {
+		cdu->cache_hits++;
+		return e;
+	}
+	cdu->cache_misses++;
+
+	// read-ahead grows while the reads stay sequential
+	if (cdu->ra_track == t && sector == cdu->ra_next) {
+		cdu->ra_size *= 2;
+		if (cdu->ra_size > CD_READAHEAD_MAX)
+			cdu->ra_size = CD_READAHEAD_MAX;
+	} else {
+		cdu->ra_size = CD_READAHEAD_MIN;
+	}
+	ssize = t->size + t->skipsize;
+	count = cdu->ra_size;
+	if (ssize > 2352 + 96)
+		count = 1;
+	len = (count - 1) * ssize + t->size;
+	zfile_fseek (t->handle, t->offset + (uae_u64)sector * ssize, SEEK_SET);
+	got = zfile_fread (cdu->ra_buf, 1, len, t->handle);
+	for (i = 0; i < count && i * ssize + t->size <= got; i++) {
+		struct cdcache_entry *ce = &cdu->cache[(sector + i) & (CD_CACHE_SECTORS - 1)];
+		ce->t = t;
+		ce->sector = sector + i;
+		ce->l2 = false;
+		memcpy (ce->data + cdcache_base (t), cdu->ra_buf + i * ssize, t->size);
+	}
+	if (i == 0) {
+		cdu->ra_track = NULL;
+		return NULL;
+	}
+	cdu->cache_readahead += i - 1;
+	cdu->ra_track = t;
+	cdu->ra_next = sector + i;
+	return e;
+}
+
+static void cdcache_flush (struct cdunit *cdu)
+{
+	if (cdu->cache_hits + cdu->cache_misses)
+		write_log (_T("CDIMAGE: sector cache %u hits, %u misses, %u read ahead\n"),
+			cdu->cache_hits, cdu->cache_misses, cdu->cache_readahead);
+	xfree (cdu->cache);
+	xfree (cdu->ra_buf);
+	cdu->cache = NULL;
+	cdu->ra_buf = NULL;
+	cdu->ra_track = NULL;
+	cdu->cache_hits = cdu->cache_misses = cdu->cache_readahead = 0;
+}
+
 static int do_read (struct cdunit *cdu, struct cdtoc *t, uae_u8 *data, int sector, int offset, int size, bool audio)
 {
 	if (t->handle) {
+		uae_sem_wait (&cdu->cache_sem);
+		struct cdcache_entry *e = cdcache_get (cdu, t, sector);
+		if (e && offset + size <= t->size) {
+			memcpy (data, e->data + cdcache_base (t) + offset, size);
+			uae_sem_post (&cdu->cache_sem);
+			return 1;
+		}
+		uae_sem_post (&cdu->cache_sem);
 		int ssize = t->size + t->skipsize;
 		zfile_fseek (t->handle, t->offset + (uae_u64)sector * ssize + offset, SEEK_SET);
 		return zfile_fread (data, 1, size, t->handle) == size;
@@ -141,11 +271,53 @@ static int do_read (struct cdunit *cdu, struct cdtoc *t, uae_u8 *data, int secto
 	return 0;
 }
 
+/* 2048 byte track sector as a full mode 1 frame */
+static int do_read_l2 (struct cdunit *cdu, struct cdtoc *t, uae_u8 *data, int sector)
+{
+	uae_sem_wait (&cdu->cache_sem);
+	struct cdcache_entry *e = cdcache_get (cdu, t, sector);
+	if (e) {
+		if (!e->l2) {
+			memset (e->data, 0, 16);
+			encode_l2 (e->data, sector + 150);
+			e->l2 = true;
+		}
+		memcpy (data, e->data, 2352);
+		uae_sem_post (&cdu->cache_sem);
+		return 1;
+	}
+	uae_sem_post (&cdu->cache_sem);
+	memset (data, 0, 16);
+	do_read (cdu, t, data + 16, sector, 0, 2048, false);
+	encode_l2 (data, sector + 150);
+	return 1;
+}
+
 // WOHOO, library that supports virtual file access functions. Perfect!
+/*
+ * Compressed audio tracks are decoded on the unpack thread into a bounded
+ * window that runs ahead of the play position, instead of unpacking the
+ * whole track before playback can start. The window holds
+ * CDDA_STREAM_SECTORS decoded sectors; the decoder keeps a persistent
+ * FLAC or MP3 decoder per unit and seeks it when the player jumps outside
+ * the window.
+ */
+#define CDDA_STREAM_SECTORS (75 * 8)
+#define CDDA_STREAM_SIZE (CDDA_STREAM_SECTORS * 2352)
+#define CDDA_STREAM_CHUNK (2352 * 8)
+#define CDDA_STREAM_WAIT 500 /* ms the player waits for a missing sector */
+
+static uae_u32 cdda_msecs (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 static void flac_metadata_callback (const FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *metadata, void *client_data)
 {
 	struct cdtoc *t = (struct cdtoc*)client_data;
-	if (t->data)
+	if (t->stream)
 		return;
 	if(metadata->type == FLAC__METADATA_TYPE_STREAMINFO) {
 		t->filesize = metadata->data.stream_info.total_samples * (metadata->data.stream_info.bits_per_sample / 8) * metadata->data.stream_info.channels;
@@ -158,12 +330,20 @@ static void flac_error_callback (const FLAC__StreamDecoder *decoder, FLAC__Strea
 static FLAC__StreamDecoderWriteStatus flac_write_callback (const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data)
 {
 	struct cdtoc *t = (struct cdtoc*)client_data;
-	uae_u16 *p = (uae_u16*)(t->data + t->writeoffset);
-	int size = 4;
-	for (int i = 0; i < frame->header.blocksize && t->writeoffset < t->filesize - size; i++, t->writeoffset += size) {
+	struct cdda_stream *s = t->stream;
+	if (!s)
+		return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+	int size = frame->header.blocksize * 4;
+	if (s->tmplen + size > s->tmpsize) {
+		s->tmpsize = s->tmplen + size;
+		s->tmp = xrealloc (uae_u8, s->tmp, s->tmpsize);
+	}
+	uae_u16 *p = (uae_u16*)(s->tmp + s->tmplen);
+	for (int i = 0; i < frame->header.blocksize; i++) {
 		*p++ = (FLAC__int16)buffer[0][i];
 		*p++ = (FLAC__int16)buffer[1][i];
 	}
+	s->tmplen += size;
 	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
 static FLAC__StreamDecoderReadStatus file_read_callback (const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
@@ -210,24 +390,6 @@ static void flac_get_size (struct cdtoc *t)
 		FLAC__stream_decoder_delete (decoder);
 	}
 }
-static uae_u8 *flac_get_data (struct cdtoc *t)
-{
-	write_log (_T("FLAC: unpacking '%s'..\n"), zfile_getname (t->handle));
-	t->writeoffset = 0;
-	FLAC__StreamDecoder *decoder = FLAC__stream_decoder_new ();
-	if (decoder) {
-		FLAC__stream_decoder_set_md5_checking (decoder, false);
-		int init_status = FLAC__stream_decoder_init_stream (decoder,
-			&file_read_callback, &file_seek_callback, &file_tell_callback,
-			&file_len_callback, &file_eof_callback,
-			&flac_write_callback, &flac_metadata_callback, &flac_error_callback, t);
-		FLAC__stream_decoder_process_until_end_of_stream (decoder);
-		FLAC__stream_decoder_delete (decoder);
-		write_log (_T("FLAC: %s unpacked\n"), zfile_getname (t->handle));
-	}
-	return t->data;
-}
-
 void sub_to_interleaved (const uae_u8 *s, uae_u8 *d)
 {
 	for (int i = 0; i < 8 * SUB_ENTRY_SIZE; i ++) {
@@ -323,10 +485,228 @@ static int setstate (struct cdunit *cdu, int state, int playpos)
 	return 0;
 }
 
+static void cdda_stream_close (struct cdda_stream *s)
+{
+	if (s->flac) {
+		FLAC__stream_decoder_finish (s->flac);
+		FLAC__stream_decoder_delete (s->flac);
+		s->flac = NULL;
+	}
+	if (s->mp3)
+		s->mp3->close ();
+	if (s->t)
+		s->t->stream = NULL;
+	uae_sem_wait (&s->lock);
+	s->t = NULL;
+	s->start = 0;
+	s->len = 0;
+	uae_sem_post (&s->lock);
+	s->decpos = 0;
+	s->eof = false;
+}
+
+static void cdda_stream_free (struct cdda_stream *s)
+{
+	cdda_stream_close (s);
+	delete s->mp3;
+	s->mp3 = NULL;
+	xfree (s->buf);
+	s->buf = NULL;
+	xfree (s->tmp);
+	s->tmp = NULL;
+	s->tmpsize = 0;
+}
+
+static bool cdda_stream_open (struct cdda_stream *s, struct cdtoc *t)
+{
+	cdda_stream_close (s);
+	if (!s->buf)
+		s->buf = xmalloc (uae_u8, CDDA_STREAM_SIZE);
+	if (!s->buf)
+		return false;
+	t->stream = s;
+	if (t->enctype == AUDENC_FLAC) {
+		s->flac = FLAC__stream_decoder_new ();
+		if (s->flac) {
+			FLAC__stream_decoder_set_md5_checking (s->flac, false);
+			if (FLAC__stream_decoder_init_stream (s->flac,
+				&file_read_callback, &file_seek_callback, &file_tell_callback,
+				&file_len_callback, &file_eof_callback,
+				&flac_write_callback, &flac_metadata_callback, &flac_error_callback, t) != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+				FLAC__stream_decoder_delete (s->flac);
+				s->flac = NULL;
+			}
+		}
+		if (!s->flac) {
+			t->stream = NULL;
+			return false;
+		}
+	} else {
+		if (!s->mp3) {
+			try {
+				s->mp3 = new mp3decoder();
+			} catch (exception) { };
+		}
+		if (!s->mp3 || !s->mp3->open (t->handle)) {
+			t->stream = NULL;
+			return false;
+		}
+	}
+	s->t = t;
+	s->starttime = cdda_msecs ();
+	s->firstdone = false;
+	write_log (_T("CDDA: streaming '%s' (%d KB window)\n"), zfile_getname (t->handle), CDDA_STREAM_SIZE / 1024);
+	return true;
+}
+
+/* Decode the next piece of the track into s->tmp. False at the end. */
+static bool cdda_stream_decode (struct cdda_stream *s)
+{
+	s->tmplen = 0;
+	if (s->flac) {
+		while (s->tmplen < CDDA_STREAM_CHUNK) {
+			if (FLAC__stream_decoder_get_state (s->flac) == FLAC__STREAM_DECODER_END_OF_STREAM)
+				break;
+			if (!FLAC__stream_decoder_process_single (s->flac))
+				break;
+		}
+	} else {
+		if (s->tmpsize < CDDA_STREAM_CHUNK) {
+			s->tmpsize = CDDA_STREAM_CHUNK;
+			s->tmp = xrealloc (uae_u8, s->tmp, s->tmpsize);
+		}
+		int got = s->mp3->read (s->tmp, CDDA_STREAM_CHUNK);
+		if (got > 0)
+			s->tmplen = got;
+	}
+	return s->tmplen > 0;
+}
+
+static void cdda_stream_seek (struct cdda_stream *s, uae_s64 pos)
+{
+	pos &= ~3;
+	uae_sem_wait (&s->lock);
+	s->start = pos;
+	s->len = 0;
+	uae_sem_post (&s->lock);
+	if (s->flac) {
+		s->tmplen = 0;
+		if (!FLAC__stream_decoder_seek_absolute (s->flac, pos / 4))
+			FLAC__stream_decoder_flush (s->flac);
+		/* seek_absolute already delivered the first frame */
+		if (s->tmplen > 0) {
+			uae_sem_wait (&s->lock);
+			int len = s->tmplen > CDDA_STREAM_SIZE ? CDDA_STREAM_SIZE : s->tmplen;
+			memcpy (s->buf, s->tmp, len);
+			s->len = len;
+			uae_sem_post (&s->lock);
+			pos += len;
+		}
+	} else {
+		s->mp3->seek (pos / 4);
+	}
+	s->decpos = pos;
+	s->eof = false;
+}
+
+/* Append s->tmp to the window, dropping the oldest data if needed */
+static void cdda_stream_append (struct cdda_stream *s)
+{
+	int len = s->tmplen;
+	uae_u8 *src = s->tmp;
+
+	if (len > CDDA_STREAM_SIZE) {
+		src += len - CDDA_STREAM_SIZE;
+		len = CDDA_STREAM_SIZE;
+	}
+	uae_sem_wait (&s->lock);
+	if (s->len + len > CDDA_STREAM_SIZE) {
+		int drop = s->len + len - CDDA_STREAM_SIZE;
+		memmove (s->buf, s->buf + drop, s->len - drop);
+		s->start += drop;
+		s->len -= drop;
+	}
+	memcpy (s->buf + s->len, src, len);
+	s->len += len;
+	uae_sem_post (&s->lock);
+	s->decpos += s->tmplen;
+}
+
+/* Unpack thread: keep the window filled ahead of the play position */
+static void cdda_stream_fill (struct cdda_stream *s, struct cdtoc *t)
+{
+	if (s->t != t && !cdda_stream_open (s, t)) {
+		uae_sem_post (&s->progress);
+		return;
+	}
+	s->idle = 0;
+	while (cdimage_unpack_thread > 0 && !comm_pipe_has_data (&unpack_pipe)) {
+		uae_s64 pos = s->playpos;
+		if (pos < s->start || pos > s->decpos + CDDA_STREAM_CHUNK)
+			cdda_stream_seek (s, pos);
+		if (s->eof || s->decpos - pos >= CDDA_STREAM_SIZE - CDDA_STREAM_CHUNK)
+			break;
+		if (!cdda_stream_decode (s)) {
+			s->eof = true;
+			break;
+		}
+		cdda_stream_append (s);
+		uae_sem_post (&s->progress);
+		if (!s->firstdone) {
+			s->firstdone = true;
+			write_log (_T("CDDA: first audio after %d ms\n"), cdda_msecs () - s->starttime);
+		}
+	}
+	/* The player pokes us again once it has used up some of the window */
+	s->idle = 1;
+	uae_sem_post (&s->progress);
+}
+
+/* Player thread: fetch one sector worth of decoded audio */
+static bool cdda_stream_read (struct cdunit *cdu, struct cdtoc *t, uae_u8 *dst, uae_s64 pos, int size)
+{
+	struct cdda_stream *s = &cdu->stream;
+	uae_u32 waitstart = 0;
+
+	for (;;) {
+		bool ok = false;
+		/* Forget old progress, only what happens from now on counts */
+		while (uae_sem_trywait (&s->progress) == 0);
+		uae_sem_wait (&s->lock);
+		if (s->t == t && pos >= s->start && pos + size <= s->start + s->len) {
+			memcpy (dst, s->buf + (pos - s->start), size);
+			ok = true;
+		}
+		uae_sem_post (&s->lock);
+		s->playpos = ok ? pos + size : pos;
+		if (ok) {
+			if (s->idle && !s->eof && s->decpos - pos < CDDA_STREAM_SIZE / 2) {
+				s->idle = 0;
+				write_comm_pipe_u32 (&unpack_pipe, cdu - &cdunits[0], 0);
+				write_comm_pipe_u32 (&unpack_pipe, t - &cdu->toc[0], 1);
+			}
+			return true;
+		}
+		if (s->t == t && s->eof && pos >= s->decpos)
+			return false;
+		if (!waitstart) {
+			waitstart = cdda_msecs ();
+			s->idle = 0;
+			write_comm_pipe_u32 (&unpack_pipe, cdu - &cdunits[0], 0);
+			write_comm_pipe_u32 (&unpack_pipe, t - &cdu->toc[0], 1);
+		}
+		int left = CDDA_STREAM_WAIT - (int)(cdda_msecs () - waitstart);
+		if (left <= 0 || cdu->cdda_play <= 0)
+			return false;
+		/* Sleep until the unpack thread has decoded more */
+		if (uae_sem_trywait_delay (&s->progress, left) != 0)
+			return false;
+	}
+}
+
 static void *cdda_unpack_func (void *v)
 {
 	cdimage_unpack_thread = 1;
-	mp3decoder *mp3dec = NULL;
 
 	for (;;) {
 		uae_u32 cduidx = read_comm_pipe_u32_blocking (&unpack_pipe);
@@ -336,39 +716,34 @@ static void *cdda_unpack_func (void *v)
 		struct cdunit *cdu = &cdunits[cduidx];
 		struct cdtoc *t = &cdu->toc[tocidx];
 		if (t->handle) {
-			// force unpack if handle points to delayed zipped file
-			uae_s64 pos = zfile_ftell (t->handle);
-			zfile_fseek (t->handle, -1, SEEK_END);
-			uae_u8 b;
-			zfile_fread (&b, 1, 1, t->handle);
-			zfile_fseek (t->handle, pos, SEEK_SET);
-			if (!t->data && (t->enctype == AUDENC_MP3 || t->enctype == AUDENC_FLAC)) {
-				t->data = xcalloc (uae_u8, t->filesize + 2352);
+			if (cdu->stream.t != t) {
+				// force unpack if handle points to delayed zipped file
+				uae_s64 pos = zfile_ftell (t->handle);
+				zfile_fseek (t->handle, -1, SEEK_END);
+				uae_u8 b;
+				zfile_fread (&b, 1, 1, t->handle);
+				zfile_fseek (t->handle, pos, SEEK_SET);
+			}
+			if (t->enctype == AUDENC_MP3 || t->enctype == AUDENC_FLAC) {
 				cdimage_unpack_active = 1;
-				if (t->data) {
-					if (t->enctype == AUDENC_MP3) {
-						if (!mp3dec) {
-							try {
-								mp3dec = new mp3decoder();
-							} catch (exception) { };
-						}
-						if (mp3dec)
-							t->data = mp3dec->get (t->handle, t->data, t->filesize);
-					} else if (t->enctype == AUDENC_FLAC) {
-						flac_get_data (t);
-					}
-				}
+				cdda_stream_fill (&cdu->stream, t);
 			}
 		}
 		cdimage_unpack_active = 2;
 	}
-	delete mp3dec;
+	for (int i = 0; i < MAX_TOTAL_SCSI_DEVICES; i++) {
+		if (cdunits[i].stream.buf)
+			cdda_stream_free (&cdunits[i].stream);
+	}
 	cdimage_unpack_thread = -1;
 	return 0;
 }
 
 static void audio_unpack (struct cdunit *cdu, struct cdtoc *t)
 {
+	// compressed tracks are requested by cdda_stream_read as needed
+	if (t->enctype == AUDENC_MP3 || t->enctype == AUDENC_FLAC)
+		return;
 	// do this even if audio is not compressed, t->handle also could be
 	// compressed and we want to unpack it in background too
 	while (cdimage_unpack_active == 1)
@@ -538,9 +913,9 @@ static void *cdda_play_func (void *v)
 						  int totalsize = t->size + t->skipsize;
 							int offset = t->offset;
 							if (offset >= 0) {
-  						  if ((t->enctype == AUDENC_MP3 || t->enctype == AUDENC_FLAC) && t->data) {
+  						  if (t->enctype == AUDENC_MP3 || t->enctype == AUDENC_FLAC) {
 									if (t->filesize >= sector * totalsize + offset + t->size)
-										memcpy (dst, t->data + sector * totalsize + offset, t->size);
+										cdda_stream_read (cdu, t, dst, (uae_s64)sector * totalsize + offset, t->size);
 						    } else if (t->enctype == AUDENC_PCM) {
 									if (sector * totalsize + offset + totalsize < t->filesize) {
 										zfile_fseek (t->handle, (uae_u64)sector * totalsize + offset, SEEK_SET);
@@ -629,6 +1004,8 @@ static void cdda_stop (struct cdunit *cdu)
 {
 	if (cdu->cdda_play != 0) {
 		cdu->cdda_play = -1;
+		/* wake the player if it is waiting for decoded audio */
+		uae_sem_post (&cdu->stream.progress);
 		while (cdu->cdda_play && cdu->thread_active) {
 			sleep_millis(10);
 		}
@@ -666,6 +1043,7 @@ static int command_play (int unitnum, int startlsn, int endlsn, int scan, play_s
 		return 0;
 	if (cdu->cdda_play) {
 		cdu->cdda_play = -1;
+		uae_sem_post (&cdu->stream.progress);
 		while (cdu->thread_active)
 			Sleep (10);
 		cdu->cdda_play = 0;
@@ -795,9 +1173,7 @@ static int command_rawread (int unitnum, uae_u8 *data, int sector, int size, int
 		} else if (sectorsize == 2352 && t->size == 2048) {
 			// 2048 -> 2352
 			while (size-- > 0) {
-				memset (data, 0, 16);
-				do_read (cdu, t, data + 16, sector, 0, 2048, false);
-				encode_l2 (data, sector + 150);
+				do_read_l2 (cdu, t, data, sector);
 				sector++;
 				asector++;
 				data += sectorsize;
@@ -1939,7 +2315,6 @@ static void unload_image (struct cdunit *cdu)
 		if (t->handle != t->subhandle)
 			zfile_fclose (t->subhandle);
 		xfree (t->fname);
-		xfree (t->data);
 		xfree (t->subdata);
 		xfree (t->extrainfo);
 	}
@@ -1956,6 +2331,10 @@ static int open_device (int unitnum, const TCHAR *ident, int flags)
 
 	if (!cdu->open) {
 		uae_sem_init (&cdu->sub_sem, 0, 1);
+		memset (&cdu->stream, 0, sizeof cdu->stream);
+		uae_sem_init (&cdu->stream.lock, 0, 1);
+		uae_sem_init (&cdu->stream.progress, 0, 0);
+		uae_sem_init (&cdu->cache_sem, 0, 1);
 		cdu->imgname[0] = 0;
 		if (ident)
 			_tcscpy (cdu->imgname, ident);
@@ -1991,8 +2370,14 @@ static void close_device (int unitnum)
 			cdimage_unpack_thread = 0;
 			destroy_comm_pipe (&unpack_pipe);
 		}
+		if (cdu->stream.buf)
+			cdda_stream_free (&cdu->stream);
+		cdcache_flush (cdu);
 		unload_image (cdu);
 		uae_sem_destroy (&cdu->sub_sem);
+		uae_sem_destroy (&cdu->stream.lock);
+		uae_sem_destroy (&cdu->stream.progress);
+		uae_sem_destroy (&cdu->cache_sem);
 	}
 	blkdev_cd_change (unitnum, cdu->imgname);
 }
@@ -223,7 +223,6 @@ static uae_u16 cl450_pending_interrupts;
 static uae_u16 cl450_threshold;
 static int cl450_buffer_offset;
 static int cl450_buffer_empty_cnt;
-static int libmpeg_offset;
 static float fmv_syncadjust;
 
 struct cl450_videoram
@@ -266,6 +265,40 @@ static uae_u16 mpeg_io_reg;
 static mpeg2dec_t *mpeg_decoder;
 static const mpeg2_info_t *mpeg_info;
 
+/*
+ * MPEG decoding and colour conversion run on their own thread. The
+ * emulation side hands over the CL450 bitstream buffer in chunks and
+ * picks finished frames from videoram[] at the display rate; everything
+ * else the decoder learns (sequence and GOP headers) is passed back and
+ * applied to the emulated chip state on the emulation thread.
+ * fmv_lock protects the videoram queue and the pending header info.
+ * cl450_reset() bumps fmv_generation, which makes the decoder throw away
+ * whatever it was still working on.
+ */
+#define CL450_MAX_CHUNKS 2
+
+struct cl450_chunk
+{
+	int generation;
+	int len;
+	uae_u8 data[1];
+};
+
+static smp_comm_pipe fmv_chunk_pipe;
+static uae_sem_t fmv_lock, fmv_space_sem;
+static uae_thread_id fmv_thread;
+static volatile int fmv_thread_running;
+static volatile int fmv_generation;
+static volatile int fmv_decoder_waiting;
+static volatile uae_atomic fmv_chunks_inflight;
+static bool fmv_seq_pending, fmv_gop_pending;
+static int fmv_seq_rate, fmv_seq_width, fmv_seq_height;
+static uae_u16 fmv_gop_tc0, fmv_gop_tc1;
+
+/* Playback statistics */
+static int fmv_stat_vsyncs, fmv_stat_decoded, fmv_stat_shown, fmv_stat_underruns;
+static frame_time_t fmv_stat_time;
+
 static void do_irq(void)
 {
 	if (!(intreq & 8)) {
@@ -758,80 +791,212 @@ static void cl450_write_dram(int addr, uae_u16 w)
 	fmv_ram_bank.baseaddr[addr * 2 + 1] = w;
 }
 
-static void cl450_parse_frame(void)
+/* Decoder thread: run libmpeg2 until the next picture is ready */
+static bool cl450_decode_frame(struct cl450_chunk **chunk, int *generation)
 {
+	int slot, width = 0, height = 0, pixbytes = 2;
+
+	uae_sem_wait(&fmv_lock);
+	while (fmv_thread_running > 0 && cl450_videoram_cnt >= CL450_VIDEO_BUFFERS - 1) {
+		fmv_decoder_waiting = 1;
+		uae_sem_post(&fmv_lock);
+		uae_sem_wait(&fmv_space_sem);
+		uae_sem_wait(&fmv_lock);
+	}
+	slot = cl450_videoram_write;
+	uae_sem_post(&fmv_lock);
+	if (fmv_thread_running <= 0)
+		return false;
+
 	for (;;) {
 		mpeg2_state_t mpeg_state = mpeg2_parse(mpeg_decoder);
 		switch (mpeg_state)
 		{
 			case STATE_BUFFER:
 			{
-				int bufsize = cl450_buffer_offset;
-				if (bufsize == 0)
-					return;
-				while (bufsize > 0 && cl450_newpacket_mode) {
-					struct cl450_newpacket *np = &cl450_newpacket_buffer[cl450_newpacket_offset_read];
-					if (cl450_newpacket_offset_read == cl450_newpacket_offset_write)
-						return;
-					int size = np->length > bufsize ? bufsize : np->length;
-
-					if (np->length == 0) {
-						write_log(_T("CL450 no matching newpacket!?\n"));
-						return;
-					}
-
-					np->length -= size;
-					bufsize -= size;
-					if (np->length > 0)
-						break;
-					//write_log(_T("CL450: NewPacket %d done\n"), cl450_newpacket_offset_read);
-					cl450_newpacket_offset_read++;
-					cl450_newpacket_offset_read &= CL450_NEWPACKET_BUFFER_SIZE - 1;
+				struct cl450_chunk *next;
+				if (*chunk) {
+					xfree(*chunk);
+					*chunk = NULL;
+					atomic_dec(&fmv_chunks_inflight);
+				}
+				next = (struct cl450_chunk*)read_comm_pipe_pvoid_blocking(&fmv_chunk_pipe);
+				if (!next)
+					return false;
+				if (next->generation != *generation) {
+					mpeg2_reset(mpeg_decoder, 1);
+					*generation = next->generation;
 				}
-				memcpy(&fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_BUFFER], cl450_buffer_offset);
-				mpeg2_buffer(mpeg_decoder, &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset + cl450_buffer_offset);
-				libmpeg_offset += cl450_buffer_offset;
-				if (libmpeg_offset >= CL450_MPEG_DECODE_BUFFER_SIZE - CL450_MPEG_BUFFER_SIZE)
-					libmpeg_offset = 0;
-				cl450_buffer_offset = 0;
+				mpeg2_buffer(mpeg_decoder, next->data, next->data + next->len);
+				*chunk = next;
 			}
 			break;
 			case STATE_SEQUENCE:
-				cl450_frame_pixbytes = 2;
-				mpeg2_convert(mpeg_decoder, cl450_frame_pixbytes == 2 ? mpeg2convert_rgb16 : mpeg2convert_rgb32, NULL);
-				cl450_set_status(CL_INT_SEQ_V);
-				cl450_frame_rate = mpeg_info->sequence->frame_period ? 27000000 / mpeg_info->sequence->frame_period : 0;
-				cl450_frame_width = mpeg_info->sequence->width;
-				cl450_frame_height = mpeg_info->sequence->height;
-				cl450_write_dram(CL_DRAM_PICTURE_RATE, cl450_frame_rate);
-				cl450_write_dram(CL_DRAM_H_SIZE, cl450_frame_width);
-				cl450_write_dram(CL_DRAM_V_SIZE, cl450_frame_height);
+				mpeg2_convert(mpeg_decoder, pixbytes == 2 ? mpeg2convert_rgb16 : mpeg2convert_rgb32, NULL);
+				uae_sem_wait(&fmv_lock);
+				fmv_seq_rate = mpeg_info->sequence->frame_period ? 27000000 / mpeg_info->sequence->frame_period : 0;
+				fmv_seq_width = mpeg_info->sequence->width;
+				fmv_seq_height = mpeg_info->sequence->height;
+				fmv_seq_pending = *generation == fmv_generation;
+				uae_sem_post(&fmv_lock);
 				break;
 			case STATE_PICTURE:
 				break;
 			case STATE_GOP:
-				cl450_write_dram(CL_DRAM_TIME_CODE_0, (mpeg_info->gop->hours << 6) | (mpeg_info->gop->minutes));
-				cl450_write_dram(CL_DRAM_TIME_CODE_1, (mpeg_info->gop->seconds << 6) | (mpeg_info->gop->pictures));
+				uae_sem_wait(&fmv_lock);
+				fmv_gop_tc0 = (mpeg_info->gop->hours << 6) | (mpeg_info->gop->minutes);
+				fmv_gop_tc1 = (mpeg_info->gop->seconds << 6) | (mpeg_info->gop->pictures);
+				fmv_gop_pending = *generation == fmv_generation;
+				uae_sem_post(&fmv_lock);
 				break;
 			case STATE_SLICE:
 			case STATE_END:
-				if (mpeg_info->display_fbuf) {
-					memcpy(videoram[cl450_videoram_write].data, mpeg_info->display_fbuf->buf[0], cl450_frame_width * cl450_frame_height * cl450_frame_pixbytes);
-					videoram[cl450_videoram_write].width = cl450_frame_width;
-					videoram[cl450_videoram_write].height = cl450_frame_height;
-					videoram[cl450_videoram_write].depth = cl450_frame_pixbytes;
-					cl450_videoram_write++;
-					cl450_videoram_write &= CL450_VIDEO_BUFFERS - 1;
-					cl450_videoram_cnt++;
-					//write_log(_T("%d\n"), cl450_videoram_cnt);
+				if (mpeg_info->display_fbuf && mpeg_info->sequence) {
+					width = mpeg_info->sequence->width;
+					height = mpeg_info->sequence->height;
+					if (width * height * pixbytes > CL450_VIDEO_BUFFER_SIZE)
+						return true;
+					memcpy(videoram[slot].data, mpeg_info->display_fbuf->buf[0], width * height * pixbytes);
+					videoram[slot].width = width;
+					videoram[slot].height = height;
+					videoram[slot].depth = pixbytes;
+					uae_sem_wait(&fmv_lock);
+					if (*generation == fmv_generation && slot == cl450_videoram_write) {
+						cl450_videoram_write++;
+						cl450_videoram_write &= CL450_VIDEO_BUFFERS - 1;
+						cl450_videoram_cnt++;
+						fmv_stat_decoded++;
+					}
+					uae_sem_post(&fmv_lock);
 				}
-				return;
+				return true;
 			default:
 				break;
 		}
 	}
 }
 
+static void *cl450_decode_thread(void *null)
+{
+	struct cl450_chunk *chunk = NULL;
+	int generation = -1;
+
+	while (cl450_decode_frame(&chunk, &generation));
+	if (chunk) {
+		xfree(chunk);
+		atomic_dec(&fmv_chunks_inflight);
+	}
+	fmv_thread_running = -1;
+	return 0;
+}
+
+/* Emulation thread: hand the bitstream buffer over to the decoder */
+static void cl450_parse_frame(void)
+{
+	struct cl450_chunk *chunk;
+	int bufsize = cl450_buffer_offset;
+
+	if (bufsize == 0 || fmv_thread_running <= 0 || fmv_chunks_inflight >= CL450_MAX_CHUNKS)
+		return;
+	while (bufsize > 0 && cl450_newpacket_mode) {
+		struct cl450_newpacket *np = &cl450_newpacket_buffer[cl450_newpacket_offset_read];
+		if (cl450_newpacket_offset_read == cl450_newpacket_offset_write)
+			return;
+		int size = np->length > bufsize ? bufsize : np->length;
+
+		if (np->length == 0) {
+			write_log(_T("CL450 no matching newpacket!?\n"));
+			return;
+		}
+
+		np->length -= size;
+		bufsize -= size;
+		if (np->length > 0)
+			break;
+		//write_log(_T("CL450: NewPacket %d done\n"), cl450_newpacket_offset_read);
+		cl450_newpacket_offset_read++;
+		cl450_newpacket_offset_read &= CL450_NEWPACKET_BUFFER_SIZE - 1;
+	}
+	chunk = (struct cl450_chunk*)xmalloc(uae_u8, sizeof(struct cl450_chunk) + cl450_buffer_offset);
+	if (!chunk)
+		return;
+	chunk->generation = fmv_generation;
+	chunk->len = cl450_buffer_offset;
+	memcpy(chunk->data, &fmv_ram_bank.baseaddr[CL450_MPEG_BUFFER], cl450_buffer_offset);
+	atomic_inc(&fmv_chunks_inflight);
+	write_comm_pipe_pvoid(&fmv_chunk_pipe, chunk, 1);
+	cl450_buffer_offset = 0;
+}
+
+/* Emulation thread: apply what the decoder found in the stream headers */
+static void cl450_decoder_sync(void)
+{
+	bool seq, gop;
+
+	if (!fmv_seq_pending && !fmv_gop_pending)
+		return;
+	uae_sem_wait(&fmv_lock);
+	seq = fmv_seq_pending;
+	gop = fmv_gop_pending;
+	fmv_seq_pending = fmv_gop_pending = false;
+	if (seq) {
+		cl450_frame_pixbytes = 2;
+		cl450_frame_rate = fmv_seq_rate;
+		cl450_frame_width = fmv_seq_width;
+		cl450_frame_height = fmv_seq_height;
+	}
+	uae_sem_post(&fmv_lock);
+	if (seq) {
+		cl450_set_status(CL_INT_SEQ_V);
+		cl450_write_dram(CL_DRAM_PICTURE_RATE, cl450_frame_rate);
+		cl450_write_dram(CL_DRAM_H_SIZE, cl450_frame_width);
+		cl450_write_dram(CL_DRAM_V_SIZE, cl450_frame_height);
+	}
+	if (gop) {
+		cl450_write_dram(CL_DRAM_TIME_CODE_0, fmv_gop_tc0);
+		cl450_write_dram(CL_DRAM_TIME_CODE_1, fmv_gop_tc1);
+	}
+}
+
+static void cl450_decoder_start(void)
+{
+	if (fmv_thread_running > 0)
+		return;
+	if (fmv_lock == 0)
+		uae_sem_init(&fmv_lock, 0, 1);
+	if (fmv_space_sem == 0)
+		uae_sem_init(&fmv_space_sem, 0, 0);
+	init_comm_pipe(&fmv_chunk_pipe, 16, 1);
+	fmv_chunks_inflight = 0;
+	fmv_decoder_waiting = 0;
+	fmv_thread_running = 1;
+	if (!uae_start_thread(_T("cd32fmv"), cl450_decode_thread, NULL, &fmv_thread)) {
+		write_log(_T("CD32 FMV: failed to start decoder thread\n"));
+		fmv_thread_running = 0;
+		destroy_comm_pipe(&fmv_chunk_pipe);
+	}
+}
+
+static void cl450_decoder_stop(void)
+{
+	if (fmv_thread_running <= 0)
+		return;
+	fmv_thread_running = 0;
+	write_comm_pipe_pvoid(&fmv_chunk_pipe, NULL, 1);
+	uae_sem_wait(&fmv_lock);
+	if (fmv_decoder_waiting) {
+		fmv_decoder_waiting = 0;
+		uae_sem_post(&fmv_space_sem);
+	}
+	uae_sem_post(&fmv_lock);
+	uae_wait_thread(fmv_thread);
+	while (comm_pipe_has_data(&fmv_chunk_pipe))
+		xfree(read_comm_pipe_pvoid_blocking(&fmv_chunk_pipe));
+	destroy_comm_pipe(&fmv_chunk_pipe);
+	fmv_thread_running = 0;
+	fmv_chunks_inflight = 0;
+}
+
 static void cl450_reset(void)
 {
 	cl450_play = 0;
@@ -842,16 +1007,24 @@ static void cl450_reset(void)
 	cl450_threshold = 4096;
 	cl450_buffer_offset = 0;
 	cl450_buffer_empty_cnt = 0;
-	libmpeg_offset = 0;
 	cl450_newpacket_mode = false;
 	cl450_newpacket_offset_write = 0;
 	cl450_newpacket_offset_read = 0;
+	if (fmv_lock)
+		uae_sem_wait(&fmv_lock);
+	// the decoder resets itself when it sees the new generation
+	fmv_generation++;
+	fmv_seq_pending = fmv_gop_pending = false;
 	cl450_videoram_write = 0;
 	cl450_videoram_read = 0;
 	cl450_videoram_cnt = 0;
+	if (fmv_decoder_waiting) {
+		fmv_decoder_waiting = 0;
+		uae_sem_post(&fmv_space_sem);
+	}
+	if (fmv_lock)
+		uae_sem_post(&fmv_lock);
 	memset(cl450_regs, 0, sizeof cl450_regs);
-	if (mpeg_decoder)
-		mpeg2_reset(mpeg_decoder, 1);
 	if (fmv_ram_bank.baseaddr) {
 		memset(fmv_ram_bank.baseaddr, 0, 0x100);
 		write_log(_T("CL450 reset\n"));
@@ -1297,6 +1470,22 @@ void cd32_fmv_set_sync(float svpos, float adjust)
 
 void cd32_fmv_vsync_handler(void)
 {
+	if (!fmv_ram_bank.baseaddr || cl450_play <= 0) {
+		fmv_stat_vsyncs = 0;
+		return;
+	}
+	frame_time_t now = read_processor_time();
+	if (fmv_stat_vsyncs == 0) {
+		fmv_stat_time = now;
+		fmv_stat_decoded = fmv_stat_shown = fmv_stat_underruns = 0;
+	} else if (now - fmv_stat_time >= 5000000) {
+		int fps10 = (int)((uae_u64)fmv_stat_vsyncs * 10000000 / (now - fmv_stat_time));
+		write_log(_T("CD32 FMV: %d.%d emulated fps, %d decoded, %d shown, %d underruns\n"),
+			fps10 / 10, fps10 % 10, fmv_stat_decoded, fmv_stat_shown, fmv_stat_underruns);
+		fmv_stat_vsyncs = 0;
+		return;
+	}
+	fmv_stat_vsyncs++;
 }
 
 static void cd32_fmv_audio_handler(void)
@@ -1364,11 +1553,20 @@ void cd32_fmv_hsync_handler(void)
 	if (cl450_video_hsync_wait == 0) {
 		cl450_set_status(CL_INT_PIC_D);
 		if (cl450_videoram_cnt > 0) {
+			uae_sem_wait(&fmv_lock);
 			cd32_fmv_new_image(videoram[cl450_videoram_read].width, videoram[cl450_videoram_read].height, 
 				videoram[cl450_videoram_read].depth, cl450_blank ? NULL : videoram[cl450_videoram_read].data);
 			cl450_videoram_read++;
 			cl450_videoram_read &= CL450_VIDEO_BUFFERS - 1;
 			cl450_videoram_cnt--;
+			if (fmv_decoder_waiting) {
+				fmv_decoder_waiting = 0;
+				uae_sem_post(&fmv_space_sem);
+			}
+			uae_sem_post(&fmv_lock);
+			fmv_stat_shown++;
+		} else if (cl450_play > 0) {
+			fmv_stat_underruns++;
 		}
 		cl450_video_hsync_wait = max_sync_vpos;
 		while (remaining_sync_vpos >= 1.0) {
@@ -1386,6 +1584,8 @@ void cd32_fmv_hsync_handler(void)
 	if (vpos & 7)
 		return;
 
+	cl450_decoder_sync();
+
 	if (cl450_play > 0) {
 		if (cl450_newpacket_mode && cl450_buffer_offset < cl450_threshold) {
 			int newpacket_len = 0;
@@ -1411,6 +1611,7 @@ void cd32_fmv_reset(void)
 
 void cd32_fmv_free(void)
 {
+	cl450_decoder_stop();
 	mapped_free(&fmv_rom_bank);
 	mapped_free(&fmv_ram_bank);
 	xfree(audioram);
@@ -1475,6 +1676,7 @@ addrbank *cd32_fmv_init (struct autoconfig_info *aci)
 		mpeg_decoder = mpeg2_init();
 		mpeg_info = mpeg2_info(mpeg_decoder);
 	}
+	cl450_decoder_start();
 	fmv_bank.mask = fmv_board_size - 1;
 	map_banks(&fmv_rom_bank, (fmv_start + ROM_BASE) >> 16, fmv_rom_size >> 16, 0);
 	map_banks(&fmv_ram_bank, (fmv_start + RAM_BASE) >> 16, fmv_ram_size >> 16, 0);
@@ -16,6 +16,10 @@
 #include "custom.h"
 #include "xwin.h"
 
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 static uae_u8 *mpeg_out_buffer;
 static int mpeg_width, mpeg_height, mpeg_depth;
 static uae_u32 fmv_border_color;
@@ -64,10 +68,25 @@ void cd32_fmv_state(int state)
 	cd32_fmv_active = state;
 }
 
-// slow software method but who cares.
+/*
+ * The compositor works a row at a time: the MPEG row is first expanded to
+ * output width (horizontal scaling and border fill) into genlock_line,
+ * which is then reused for every output row it covers, and merged with
+ * the Amiga row under the key mask. genlock_merge_* are written so that
+ * they vectorize; with NEON they use intrinsics directly.
+ *
+ * genlock_32_ref and genlock_16_ref are the original per-pixel versions.
+ * They are still used for odd source formats, and with GENLOCK_CHECK set
+ * every frame is composited both ways and compared.
+ */
+#ifndef GENLOCK_CHECK
+#define GENLOCK_CHECK 0
+#endif
 
+static uae_u8 *genlock_line;
+static int genlock_line_size;
 
-static void genlock_32(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
+static void genlock_32_ref(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
 {
 	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
 		for (int h2 = 0; h2 < mult; h2++) {
@@ -96,7 +115,7 @@ static void genlock_32(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, i
 	}
 }
 
-static void genlock_16(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
+static void genlock_16_ref(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
 {
 	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
 		for (int h2 = 0; h2 < mult; h2++) {
@@ -125,31 +144,128 @@ static void genlock_16(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, i
 	}
 }
 
-static void genlock_16_nomult(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset)
+STATIC_INLINE void genlock_merge_32(uae_u32 *dst, const uae_u32 *src, const uae_u32 *fmv, int w)
+{
+	int x = 0;
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+	uint32x4_t keymask = vdupq_n_u32(0xff);
+	uint32x4_t key = vdupq_n_u32(GENLOCK_VAL_32);
+	for (; x + 4 <= w; x += 4) {
+		uint32x4_t s = vld1q_u32(src + x);
+		uint32x4_t m = vcgeq_u32(vandq_u32(s, keymask), key);
+		vst1q_u32(dst + x, vbslq_u32(m, s, vld1q_u32(fmv + x)));
+	}
+#endif
+	for (; x < w; x++) {
+		uae_u32 s = src[x];
+		dst[x] = ((uae_u8*)&src[x])[0] >= GENLOCK_VAL_32 ? s : fmv[x];
+	}
+}
+
+STATIC_INLINE void genlock_merge_16(uae_u16 *dst, const uae_u16 *src, const uae_u16 *fmv, int w)
+{
+	int x = 0;
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+	uint16x8_t key = vdupq_n_u16(GENLOCK_VAL_16);
+	for (; x + 8 <= w; x += 8) {
+		uint16x8_t s = vld1q_u16(src + x);
+		uint16x8_t m = vcgeq_u16(vshrq_n_u16(s, 11), key);
+		vst1q_u16(dst + x, vbslq_u16(m, s, vld1q_u16(fmv + x)));
+	}
+#endif
+	for (; x < w; x++) {
+		uae_u16 s = src[x];
+		dst[x] = (s >> 11) >= GENLOCK_VAL_16 ? s : fmv[x];
+	}
+}
+
+// Expand one MPEG row (or none: border only) to w output pixels
+#define GENLOCK_EXPAND(type, border) \
+	type *l = (type*)genlock_line; \
+	int left = hoffset * mult, right = (hoffset + mpeg_width) * mult; \
+	if (!srcp) \
+		left = right = w; \
+	if (left > w) \
+		left = w; \
+	if (right > w) \
+		right = w; \
+	int x = 0; \
+	for (; x < left; x++) \
+		l[x] = border; \
+	if (mult == 1) { \
+		if (right > x) \
+			memcpy(l + x, srcp, (right - x) * sizeof(type)); \
+		x = right; \
+	} else { \
+		for (const type *sp = srcp; x + mult <= right; sp++) { \
+			for (int i = 0; i < mult; i++) \
+				l[x++] = *sp; \
+		} \
+		for (; x < right; x++) \
+			l[x] = srcp[x / mult - hoffset]; \
+	} \
+	for (; x < w; x++) \
+		l[x] = border;
+
+static void genlock_32(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int hoffset, int voffset, int mult)
+{
+	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
+		uae_u32 *srcp = NULL;
+		if (sh >= 0 && sh < mpeg_height)
+			srcp = (uae_u32*)(mpeg_out_buffer + sh * mpeg_width * MPEG_PIXBYTES_32);
+		GENLOCK_EXPAND(uae_u32, fmv_border_color)
+		for (int h2 = 0; h2 < mult; h2++) {
+			int y = hh + h2 + voffset;
+			genlock_merge_32((uae_u32*)(vbout->bufmem + vbout->rowbytes * y),
+				(uae_u32*)(vbin->bufmem + vbin->rowbytes * y), l, w);
+		}
+	}
+}
+
+static void genlock_16(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int hoffset, int voffset, int mult)
 {
-	for (int hh = 0, sh = -voffset; hh < h; sh++, hh++) {
-		uae_u8 *d8 = vbout->bufmem + vbout->rowbytes * (hh + voffset);
-		uae_u16 *d16 = (uae_u16*)d8;
-		uae_u8 *s8 = vbin->bufmem + vbin->rowbytes * (hh + voffset) ;
+	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
 		uae_u16 *srcp = NULL;
 		if (sh >= 0 && sh < mpeg_height)
 			srcp = (uae_u16*)(mpeg_out_buffer + sh * mpeg_width * MPEG_PIXBYTES_16);
-		for (int ww = 0, sw = -hoffset; ww < w; sw++, ww++) {
-			uae_u16 sv = fmv_border_color_16;
-			if (sw >= 0 && sw < mpeg_width && srcp)
-				sv = srcp[sw];
-			uae_u32 v;
-			if ((((uae_u16*)s8)[0] >> 11) >= GENLOCK_VAL_16) {
-				v = *((uae_u16*)s8);
-			} else {
-				v = sv;
-			}
-			*d16++ = v;
-			s8 += d;
+		GENLOCK_EXPAND(uae_u16, fmv_border_color_16)
+		for (int h2 = 0; h2 < mult; h2++) {
+			int y = hh + h2 + voffset;
+			genlock_merge_16((uae_u16*)(vbout->bufmem + vbout->rowbytes * y),
+				(uae_u16*)(vbin->bufmem + vbin->rowbytes * y), l, w);
 		}
 	}
 }
 
+#if GENLOCK_CHECK
+static void genlock_check(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
+{
+	static int errors;
+	int rows = (h + mult - 1) / mult * mult;
+	int bytes = w * (mpeg_depth == 2 ? 2 : 4);
+	uae_u8 *fast = xmalloc(uae_u8, rows * bytes);
+
+	if (!fast || vbin == vbout) {
+		xfree(fast);
+		return;
+	}
+	for (int y = 0; y < rows; y++)
+		memcpy(fast + y * bytes, vbout->bufmem + vbout->rowbytes * (y + voffset), bytes);
+	if (mpeg_depth == 2)
+		genlock_16_ref(vbin, vbout, w, h, d, hoffset, voffset, mult);
+	else
+		genlock_32_ref(vbin, vbout, w, h, d, hoffset, voffset, mult);
+	for (int y = 0; y < rows; y++) {
+		if (memcmp(fast + y * bytes, vbout->bufmem + vbout->rowbytes * (y + voffset), bytes)) {
+			if (errors++ < 10)
+				write_log(_T("FMV genlock mismatch: row %d, %dx%d mult %d offsets %d,%d\n"), y, w, h, mult, hoffset, voffset);
+			break;
+		}
+	}
+	xfree(fast);
+}
+#endif
+
 void cd32_fmv_genlock(struct vidbuffer *vbin, struct vidbuffer *vbout)
 {
 	int hoffset, voffset, mult;
@@ -178,12 +294,26 @@ void cd32_fmv_genlock(struct vidbuffer *vbin, struct vidbuffer *vbout)
 	if (voffset < 0)
 		voffset = 0;
 
+	// the per-pixel loops write whole mult x mult blocks
+	int w2 = (w + mult - 1) / mult * mult;
+	if (genlock_line_size < w2 * MPEG_PIXBYTES_32) {
+		genlock_line_size = w2 * MPEG_PIXBYTES_32;
+		genlock_line = xrealloc(uae_u8, genlock_line, genlock_line_size);
+	}
+
 	if (mpeg_depth == 2) {
-		if(mult == 1)
-		  genlock_16_nomult(vbin, vbout, w, h, d, hoffset, voffset);
+		if (d == 2 && genlock_line)
+			genlock_16(vbin, vbout, w2, h, hoffset, voffset, mult);
 		else
-  		genlock_16(vbin, vbout, w, h, d, hoffset, voffset, mult);
+			genlock_16_ref(vbin, vbout, w, h, d, hoffset, voffset, mult);
+	} else {
+		if (d == 4 && genlock_line)
+			genlock_32(vbin, vbout, w2, h, hoffset, voffset, mult);
+		else
+			genlock_32_ref(vbin, vbout, w, h, d, hoffset, voffset, mult);
 	}
-	else
-		genlock_32(vbin, vbout, w, h, d, hoffset, voffset, mult);
+#if GENLOCK_CHECK
+	if ((mpeg_depth == 2 && d == 2) || (mpeg_depth != 2 && d == 4))
+		genlock_check(vbin, vbout, w2, h, d, hoffset, voffset, mult);
+#endif
 }
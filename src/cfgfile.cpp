@@ -97,6 +97,7 @@ static const TCHAR *cdmodes[] = { _T("disabled"), _T(""), _T("image"), _T("ioctl
 static const TCHAR *cdconmodes[] = { _T(""), _T("uae"), _T("ide"), _T("scsi"), _T("cdtv"), _T("cd32"), 0 };
 static const TCHAR *waitblits[] = { _T("disabled"), _T("automatic"), _T("noidleonly"), _T("always"), 0 };
 static const TCHAR *autoext2[] = { _T("disabled"), _T("copy"), _T("replace"), 0 };
+static const TCHAR *hdwriteback[] = { _T("lazy"), _T("async"), _T("sync"), 0 };
 
 struct hdcontrollerconfig
 {
@@ -1365,6 +1366,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
   /* do not reorder end */
 
 	cfgfile_dwrite_bool (f, _T("fpu_no_unimplemented"), p->fpu_no_unimplemented);
+	cfgfile_dwrite_bool (f, _T("fpu_fast"), p->fpu_fast);
 	cfgfile_write_bool (f, _T("fpu_strict"), p->fpu_strict);
 
   cfgfile_write (f, _T("rtg_modes"), _T("0x%x"), p->picasso96_modeflags);
@@ -1388,6 +1390,9 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_dwrite_str (f, _T("filesys_inject_icons_tool"), p->filesys_inject_icons_tool);
 #endif
 	cfgfile_dwrite_bool(f, _T("harddrive_write_protect"), p->harddrive_read_only);
+	cfgfile_dwrite_bool(f, _T("harddrive_mmap"), p->harddrive_mmap);
+	cfgfile_dwrite(f, _T("harddrive_cache_size"), _T("%d"), p->harddrive_cache_size);
+	cfgfile_dwrite_str(f, _T("harddrive_writeback"), hdwriteback[p->harddrive_writeback]);
 
   write_inputdevice_config (p, f);
 }
@@ -3028,6 +3033,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
   if (cfgfile_yesno (option, value, _T("immediate_blits"), &p->immediate_blits)
 	  || cfgfile_yesno (option, value, _T("fast_copper"), &p->fast_copper)
 		|| cfgfile_yesno(option, value, _T("fpu_no_unimplemented"), &p->fpu_no_unimplemented)
+		|| cfgfile_yesno(option, value, _T("fpu_fast"), &p->fpu_fast)
 		|| cfgfile_yesno (option, value, _T("cd32cd"), &p->cs_cd32cd)
 		|| cfgfile_yesno (option, value, _T("cd32c2p"), &p->cs_cd32c2p)
 		|| cfgfile_yesno (option, value, _T("cd32nvram"), &p->cs_cd32nvram)
@@ -3045,7 +3051,8 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_yesno (option, value, _T("compfpu"), &p->compfpu)
 #endif
 		|| cfgfile_yesno (option, value, _T("floppy_write_protect"), &p->floppy_read_only)
-		|| cfgfile_yesno(option, value, _T("harddrive_write_protect"), &p->harddrive_read_only))
+		|| cfgfile_yesno(option, value, _T("harddrive_write_protect"), &p->harddrive_read_only)
+		|| cfgfile_yesno(option, value, _T("harddrive_mmap"), &p->harddrive_mmap))
 	  return 1;
 
   if (cfgfile_intval (option, value, _T("cachesize"), &p->cachesize, 1)
@@ -3062,6 +3069,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_intval (option, value, _T("cd_speed"), &p->cd_speed, 1)
 	  || cfgfile_intval (option, value, _T("floppy_write_length"), &p->floppy_write_length, 1)
 	  || cfgfile_intval (option, value, _T("nr_floppies"), &p->nr_floppies, 1)
+		|| cfgfile_intval (option, value, _T("harddrive_cache_size"), &p->harddrive_cache_size, 1)
 	  || cfgfile_intval (option, value, _T("floppy0type"), &p->floppyslots[0].dfxtype, 1)
 	  || cfgfile_intval (option, value, _T("floppy1type"), &p->floppyslots[1].dfxtype, 1)
 	  || cfgfile_intval (option, value, _T("floppy2type"), &p->floppyslots[2].dfxtype, 1)
@@ -3073,6 +3081,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
     || cfgfile_strval (option, value, _T("collision_level"), &p->collision_level, collmode, 0)
 		|| cfgfile_strval (option, value, _T("waiting_blits"), &p->waiting_blits, waitblits, 0)
 		|| cfgfile_strval (option, value, _T("floppy_auto_extended_adf"), &p->floppy_auto_ext2, autoext2, 0)
+		|| cfgfile_strval (option, value, _T("harddrive_writeback"), &p->harddrive_writeback, hdwriteback, 0)
 		|| cfgfile_strval (option, value,  _T("z3mapping"), &p->z3_mapping_mode, z3mapping, 0)
 		|| cfgfile_strval(option, value, _T("boot_rom_uae"), &p->boot_rom, uaebootrom, 0)
 		|| cfgfile_strval(option, value, _T("uaeboard"), &p->uaeboard, uaeboard, 0))
@@ -4517,6 +4526,7 @@ void default_prefs (struct uae_prefs *p, bool reset, int type)
   p->fpu_model = 0;
   p->cpu_model = 68000;
 	p->fpu_no_unimplemented = false;
+	p->fpu_fast = false;
 	p->fpu_strict = 0;
   p->m68k_speed = 0;
   p->cpu_compatible = 0;
@@ -4525,6 +4535,9 @@ void default_prefs (struct uae_prefs *p, bool reset, int type)
   p->ntscmode = 0;
 	p->filesys_limit = 0;
 	p->filesys_max_name = 107;
+	p->harddrive_mmap = false;
+	p->harddrive_cache_size = 4;
+	p->harddrive_writeback = 0;
 
   p->fastmem[0].size = 0x00000000;
 	p->mbresmem_low_size = 0x00000000;
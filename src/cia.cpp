@@ -74,6 +74,14 @@ static uae_u8 kbcode;
 static struct rtc_msm_data rtc_msm;
 static struct rtc_ricoh_data rtc_ricoh;
 
+/* Log how often the CIA timers touch the event scheduler */
+#define CIA_EVENT_STATS 0
+
+#if CIA_EVENT_STATS
+static unsigned int cia_stat_calc, cia_stat_sched, cia_stat_handler;
+static unsigned int cia_stat_expiries, cia_stat_shared, cia_stat_frames;
+#endif
+
 STATIC_INLINE void setclr (unsigned int *p, unsigned int val)
 {
   if (val & 0x80) {
@@ -315,6 +323,12 @@ static int CIA_update_check (void)
   if (bsp) {
 		ciabicr |= 8; icr |= 2;
   }
+#if CIA_EVENT_STATS
+	int expiries = aovfla + aovflb + asp + bovfla + bovflb + bsp;
+	cia_stat_expiries += expiries;
+	if (expiries > 1)
+		cia_stat_shared++;
+#endif
 	return icr;
 }
 static void CIA_update (void)
@@ -363,11 +377,28 @@ static void CIA_calctimers (void)
       ciatime = ciabtimeb;
   	eventtab[ev_cia].evtime = ciatime + get_cycles ();
   }
-  events_schedule();
+#if CIA_EVENT_STATS
+	cia_stat_calc++;
+#endif
+	/* No full events_schedule() here, timers are reprogrammed far too
+	   often for that. A nextevent that is now too early only costs one
+	   extra pass through the event loop, which schedules again after
+	   running the handlers; that also covers CIA_handler itself. So only
+	   pull nextevent in when the CIA expires before it. */
+	if (eventtab[ev_cia].active
+		&& eventtab[ev_cia].evtime - get_cycles () < nextevent - get_cycles ()) {
+		nextevent = eventtab[ev_cia].evtime;
+#if CIA_EVENT_STATS
+		cia_stat_sched++;
+#endif
+	}
 }
 
 void CIA_handler (void)
 {
+#if CIA_EVENT_STATS
+	cia_stat_handler++;
+#endif
   CIA_update ();
   CIA_calctimers ();
 }
@@ -541,6 +572,14 @@ void CIA_hsync_posthandler (bool ciahsync)
 void CIA_vsync_prehandler (void)
 {
 	CIA_handler ();
+#if CIA_EVENT_STATS
+	if (++cia_stat_frames >= 500) {
+		write_log (_T("CIA: %u timer updates, %u reschedules, %u events, %u expiries (%u shared an update)\n"),
+			cia_stat_calc, cia_stat_sched, cia_stat_handler, cia_stat_expiries, cia_stat_shared);
+		cia_stat_calc = cia_stat_sched = cia_stat_handler = 0;
+		cia_stat_expiries = cia_stat_shared = cia_stat_frames = 0;
+	}
+#endif
 	if (kblostsynccnt > 0) {
 		kblostsynccnt -= maxvpos;
 		if (kblostsynccnt <= 0) {
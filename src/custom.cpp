@@ -2046,40 +2046,44 @@ static void do_playfield_collisions (void)
   hwres_t ddf_left = thisline_decision.plfleft * 2 << bplres;
   hwres_t hw_diwlast = coord_window_to_diw_x (thisline_decision.diwlastword);
   hwres_t hw_diwfirst = coord_window_to_diw_x (thisline_decision.diwfirstword);
-  int i, collided, minpos, maxpos;
+  int i, j, minpos, maxpos, nplanes;
   int planes = (aga_mode) ? 8 : 6;
+  uae_u8 *pdata[MAX_PLANES];
+  uae_u32 pxor[MAX_PLANES];
+
+  /* Only the enabled planes take part. An enabled plane that is not
+   * fetched reads as 0, which either never matches or always does. */
+  nplanes = 0;
+  for (j = 0; j < planes; j++) {
+    int match = (clxcon_bpl_match >> j) & 1;
+    if (!((clxcon_bpl_enable >> j) & 1))
+      continue;
+    if (j >= thisline_decision.nr_planes) {
+      if (match)
+        return;
+      continue;
+    }
+    pdata[nplanes] = line_data[next_lineno] + 2 * j * MAX_WORDS_PER_LINE;
+    pxor[nplanes] = (match & 1) - 1;
+    nplanes++;
+  }
 
-  collided = 0;
   minpos = thisline_decision.plfleft * 2;
   if (minpos < hw_diwfirst)
     minpos = hw_diwfirst;
   maxpos = thisline_decision.plfright * 2;
   if (maxpos > hw_diwlast)
     maxpos = hw_diwlast;
-  for (i = minpos; i < maxpos && !collided; i+= 32) {
+  for (i = minpos; i < maxpos; i+= 32) {
     int offs = ((i << bplres) - ddf_left) >> 3;
-    int j;
     uae_u32 total = 0xffffffff;
-    for (j = 0; j < planes; j++) {
-      int ena = (clxcon_bpl_enable >> j) & 1;
-      int match = (clxcon_bpl_match >> j) & 1;
-      uae_u32 t = 0xffffffff;
-      if (ena) {
-        if (j < thisline_decision.nr_planes) {
-          t = *(uae_u32 *)(line_data[next_lineno] + offs + 2 * j * MAX_WORDS_PER_LINE);
-          t ^= (match & 1) - 1;
-        } else {
-          t = (match & 1) - 1;
-        }
-      }
-      total &= t;
-    }
+    for (j = 0; j < nplanes && total; j++)
+      total &= *(uae_u32 *)(pdata[j] + offs) ^ pxor[j];
     if (total) {
-      collided = 1;
+      clxdat |= 1;
+      return;
     }
   }
-  if (collided)
-    clxdat |= 1;
 }
 
 #define DO_SPRITE_COLLISIONS \
@@ -2091,18 +2095,54 @@ static void do_playfield_collisions (void)
   } \
 }
 
+/*
+ * Sprite to playfield collisions are done with bitmasks in playfield
+ * pixel order, one bit per pixel laid out like the uae_u32 words of
+ * line_data: first the pixels of each sprite pair are collected into
+ * clx_sprmask, then the words of the enabled planes are folded into one
+ * "planes match" mask per playfield and the two are ANDed a word at a time.
+ */
+#define CLX_WORDS MAX_WORDS_PER_LINE
+
+static uae_u32 clx_sprmask[4][CLX_WORDS];
+
+/* Bits of the pixels whose playfield k planes match CLXCON */
+STATIC_INLINE uae_u32 clx_plane_match (int k, int w)
+{
+  int planes = (aga_mode) ? 8 : 6;
+  uae_u32 m = 0xffffffff;
+
+  for (int l = k; m && l < planes; l += 2) {
+    if (!(clxcon_bpl_enable & (1 << l)))
+      continue;
+    uae_u32 word = 0;
+    if (l < thisline_decision.nr_planes)
+      word = ((uae_u32 *)(line_data[next_lineno] + 2 * l * MAX_WORDS_PER_LINE))[w];
+    m &= ((clxcon_bpl_match >> l) & 1) ? word : ~word;
+  }
+  return m;
+}
+
 /* Sprite-to-sprite collisions are taken care of in record_sprite.  This one does
    playfield/sprite collisions. */
 static void do_sprite_collisions (void)
 {
   int nr_sprites = curr_drawinfo[next_lineno].nr_sprites;
   int first = curr_drawinfo[next_lineno].first_sprite_entry;
-  int i;
+  int i, w, p;
   unsigned int collision_mask = clxmask[clxcon >> 12];
   int bplres = bplcon0_res;
   hwres_t ddf_left = thisline_decision.plfleft * 2 << bplres;
   hwres_t hw_diwlast = coord_window_to_diw_x (thisline_decision.diwlastword);
   hwres_t hw_diwfirst = coord_window_to_diw_x (thisline_decision.diwfirstword);
+  int wmin = CLX_WORDS, wmax = -1;
+  unsigned int pairs = 0, todo = 0;
+
+  /* sprite pairs that still have a playfield collision bit to find */
+  for (p = 0; p < 4; p++) {
+    if ((clxdat & (0x22u << p)) != (0x22u << p))
+      todo |= 1 << p;
+  }
 
   for (i = 0; i < nr_sprites; i++) {
     struct sprite_entry *e = curr_sprite_entries + first + i;
@@ -2123,43 +2163,57 @@ static void do_sprite_collisions (void)
 
     for (j = minpos; j < maxpos; j++) {
       int sprpix = spixels[e->first_pixel + j - e->pos] & collision_mask;
-      int k, offs, match = 1;
+      int offs;
 
+      if (sprpix == 0)
+        continue;
+      sprpix = (sprite_ab_merge[sprpix & 255] | (sprite_ab_merge[sprpix >> 8] << 2)) & todo;
       if (sprpix == 0)
         continue;
 
       offs = ((j << bplres) >> sprite_buffer_res) - ddf_left;
-      sprpix = sprite_ab_merge[sprpix & 255] | (sprite_ab_merge[sprpix >> 8] << 2);
-      sprpix <<= 1;
-
-			// both odd and even collision bits already set?
-			if ((clxdat & (sprpix << 0)) && (clxdat & (sprpix << 4)))
-				continue;
-
-      /* Loop over number of playfields.  */
-      for (k = 1; k >= 0; k--) {
-        int l;
-        int planes = (aga_mode) ? 8 : 6;
-        if (bplcon0 & 0x400)
-          match = 1;
-        for (l = k; match && l < planes; l += 2) {
-          int t = 0;
-          if (l < thisline_decision.nr_planes) {
-            uae_u32 *ldata = (uae_u32 *)(line_data[next_lineno] + 2 * l * MAX_WORDS_PER_LINE);
-            uae_u32 word = ldata[offs >> 5];
-            t = (word >> (31 - (offs & 31))) & 1;
-          }
-          if (clxcon_bpl_enable & (1 << l)) {
-            if (t != ((clxcon_bpl_match >> l) & 1))
-              match = 0;
-          }
-        }
-        if (match) {
-          clxdat |= sprpix << (k * 4);
-        }
+      w = offs >> 5;
+      if (w >= CLX_WORDS)
+        break;
+      uae_u32 bit = 0x80000000 >> (offs & 31);
+      for (p = 0; p < 4; p++) {
+        if (sprpix & (1 << p))
+          clx_sprmask[p][w] |= bit;
       }
+      pairs |= sprpix;
+      if (w < wmin)
+        wmin = w;
+      if (w > wmax)
+        wmax = w;
+    }
+  }
+  if (!pairs)
+    return;
+
+  /* playfield 2 (odd planes) first: without dual playfield the even planes
+   * only count where the odd planes matched as well */
+  unsigned int found[2] = { (clxdat >> 1) & 15, (clxdat >> 5) & 15 };
+  for (w = wmin; w <= wmax && (found[0] & found[1] & pairs) != pairs; w++) {
+    uae_u32 m1 = clx_plane_match (1, w);
+    uae_u32 m0 = (bplcon0 & 0x400) || m1 ? clx_plane_match (0, w) : 0;
+    if (!(bplcon0 & 0x400))
+      m0 &= m1;
+    for (p = 0; p < 4; p++) {
+      uae_u32 s = clx_sprmask[p][w];
+      if (!s)
+        continue;
+      if (s & m1)
+        found[1] |= 1 << p;
+      if (s & m0)
+        found[0] |= 1 << p;
     }
   }
+  clxdat |= (found[0] << 1) | (found[1] << 5);
+
+  for (p = 0; p < 4; p++) {
+    if (pairs & (1 << p))
+      memset (&clx_sprmask[p][wmin], 0, (wmax - wmin + 1) * sizeof (uae_u32));
+  }
 }
 
 static void record_sprite_1 (int sprxp, uae_u16 *buf, uae_u32 datab, int num, int dbl,
@@ -4067,6 +4121,72 @@ STATIC_INLINE int copper_cant_read (int hpos)
    it subtly wrong; and it would also be more expensive - we want this code
    to be fast.  */
 
+/* Most programs run the same copper list every frame, so predict_copper
+   usually walks the same instructions from the same position as it did
+   on this line one frame earlier. Its result is remembered, keyed by the
+   copper state it started from and the raw chip RAM words it read; if
+   both match, the walk is skipped. Only the lookahead is cached, the
+   copper itself still runs cycle by cycle in update_copper.
+   A hit still compares every word the walk would have read, so this only
+   pays off on short static lists; with per-line lists, or lists the CPU
+   rewrites or swaps every frame, it is slower than the walk (see
+   tests/copper). Off unless COPPER_TRACE_ENTRIES is set.  */
+
+#ifndef COPPER_TRACE_ENTRIES
+#define COPPER_TRACE_ENTRIES 0	/* power of two, 0 turns the cache off */
+#endif
+#define COPPER_TRACE_BYTES 256
+#ifndef COPPER_TRACE_STATS
+#define COPPER_TRACE_STATS 0
+#endif
+
+struct copper_trace {
+	/* key */
+	int vpos, maxhpos;
+	uaecptr ip;
+	unsigned int hpos, i1, i2;
+	enum copper_states state;
+	/* result */
+	unsigned int end_hpos, first_sync, modified, insns;
+	/* chip RAM the walk depended on */
+	uae_u32 addr;
+	int len;
+	uae_u8 data[COPPER_TRACE_BYTES];
+};
+
+#if COPPER_TRACE_ENTRIES
+static struct copper_trace copper_trace[COPPER_TRACE_ENTRIES];
+#endif
+static unsigned int copper_trace_hits, copper_trace_misses, copper_trace_skipped;
+
+static void copper_trace_flush (void)
+{
+#if COPPER_TRACE_ENTRIES
+	for (int i = 0; i < COPPER_TRACE_ENTRIES; i++)
+		copper_trace[i].len = -1;
+#endif
+}
+
+static void copper_trace_stats (void)
+{
+#if COPPER_TRACE_STATS
+	static int frames;
+	if (++frames < 250)
+		return;
+	write_log (_T("Copper trace: %u hits, %u misses, %u instructions skipped in %d frames\n"),
+		copper_trace_hits, copper_trace_misses, copper_trace_skipped, frames);
+	frames = 0;
+#endif
+	copper_trace_hits = copper_trace_misses = copper_trace_skipped = 0;
+}
+
+STATIC_INLINE uae_u32 copper_trace_word (uaecptr addr, uaecptr *hi)
+{
+	if (addr + 2 > *hi)
+		*hi = addr + 2;
+	return chipmem_wget_indirect (addr);
+}
+
 static void predict_copper (void)
 {
 	uaecptr ip = cop_state.ip;
@@ -4074,6 +4194,23 @@ static void predict_copper (void)
 	enum copper_states state = cop_state.state;
 	unsigned int w1, w2, cycle_count;
 	unsigned int modified = REGTYPE_FORCE;
+	unsigned int insns = 0;
+	uaecptr hi = ip;
+#if COPPER_TRACE_ENTRIES
+	struct copper_trace *ct;
+
+	ct = &copper_trace[(vpos * 57 + (c_hpos >> 1)) & (COPPER_TRACE_ENTRIES - 1)];
+	if (ct->len >= 0 && ct->vpos == vpos && ct->hpos == c_hpos && ct->ip == ip && ct->state == state &&
+		ct->i1 == cop_state.i1 && ct->i2 == cop_state.i2 && ct->maxhpos == maxhpos &&
+		!memcmp (ct->data, chipmem_bank.baseaddr + ct->addr, ct->len)) {
+		copper_trace_hits++;
+		copper_trace_skipped += ct->insns;
+		c_hpos = ct->end_hpos;
+		modified = ct->modified;
+		cop_state.first_sync = ct->first_sync;
+		goto schedule;
+	}
+#endif
 
 	switch (state) {
 		case COP_read1:
@@ -4081,7 +4218,7 @@ static void predict_copper (void)
 		  
 		case COP_read2:
 			w1 = cop_state.i1;
-			w2 = chipmem_wget_indirect (ip);
+			w2 = copper_trace_word (ip, &hi);
   		if (w1 & 1) {
   			if (w2 & 1)
   				return; // SKIP
@@ -4141,9 +4278,10 @@ static void predict_copper (void)
 	
 	while (c_hpos + 1 < maxhpos) {
 		if (state == COP_read1) {
-			w1 = chipmem_wget_indirect (ip);
+			w1 = copper_trace_word (ip, &hi);
+			insns++;
 			if (w1 & 1) {
-				w2 = chipmem_wget_indirect (ip + 2);
+				w2 = copper_trace_word (ip + 2, &hi);
 				if (w2 & 1)
 					break; // SKIP
 				state = COP_wait; // WAIT
@@ -4180,7 +4318,34 @@ static void predict_copper (void)
 			}
 		}
 	}
-	
+
+#if COPPER_TRACE_ENTRIES
+	copper_trace_misses++;
+	{
+		uae_u32 addr = cop_state.ip & chipmem_full_mask;
+		int len = hi - cop_state.ip;
+		if (len >= 0 && len <= COPPER_TRACE_BYTES && addr + len <= chipmem_full_mask + 1) {
+			ct->vpos = vpos;
+			ct->maxhpos = maxhpos;
+			ct->ip = cop_state.ip;
+			ct->hpos = cop_state.hpos;
+			ct->state = cop_state.state;
+			ct->i1 = cop_state.i1;
+			ct->i2 = cop_state.i2;
+			ct->end_hpos = c_hpos;
+			ct->first_sync = cop_state.first_sync;
+			ct->modified = modified;
+			ct->insns = insns;
+			ct->addr = addr;
+			ct->len = len;
+			memcpy (ct->data, chipmem_bank.baseaddr + addr, len);
+		} else {
+			ct->len = -1;
+		}
+	}
+
+schedule:
+#endif
 	cycle_count = c_hpos - cop_state.hpos;
 	if (cycle_count >= 8) {
   	cop_state.regtypes_modified = modified;
@@ -5143,6 +5308,7 @@ static void vsync_handler_pre (void)
 static void vsync_handler_post (void)
 {
 	DISK_vsync ();
+	copper_trace_stats ();
 
 	if (bplcon0 & 4) {
 		lof_store = lof_store ? 0 : 1;
@@ -5617,6 +5783,7 @@ void custom_reset (bool hardreset, bool keyboardreset)
 	write_log (_T("Reset at %08X. Chipset mask = %08X\n"), M68K_GETPC, currprefs.chipset_mask);
 
 	nr_armed = 0;
+	copper_trace_flush ();
 
   if (! savestate_state) {
 		cia_hsync = 0;
@@ -49,6 +49,14 @@
 #include "audio.h"
 #include "devices.h"
 
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+#include <arm_neon.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
 #define RENDER_SIGNAL_PARTIAL 1
 #define RENDER_SIGNAL_FRAME_DONE 2
 #define RENDER_SIGNAL_QUIT 3
@@ -514,6 +522,8 @@ static void pfield_do_linetoscr(int start, int stop)
 
 static void pfield_set_linetoscr (void)
 {
+	int vector = linetoscr_vector ();
+
 	p_acolors = colors_for_drawing.acolors;
 	p_xcolors = xcolors;
 	bpland = 0xff;
@@ -523,14 +533,14 @@ static void pfield_set_linetoscr (void)
 
 	if (currprefs.chipset_mask & CSMASK_AGA) {
 		if (res_shift == 0) {
-				pfield_do_linetoscr_normal = linetoscr_16_aga;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_aga_vec : linetoscr_16_aga;
 		} else if (res_shift == 2) {
 		} else if (res_shift == 1) {
-				pfield_do_linetoscr_normal = linetoscr_16_stretch1_aga;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_stretch1_aga_vec : linetoscr_16_stretch1_aga;
 		} else if (res_shift == -1) {
-				pfield_do_linetoscr_normal = linetoscr_16_shrink1_aga;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_shrink1_aga_vec : linetoscr_16_shrink1_aga;
 		} else if (res_shift == -2) {
-				pfield_do_linetoscr_normal = linetoscr_16_shrink2_aga;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_shrink2_aga_vec : linetoscr_16_shrink2_aga;
 		}
 	}
 
@@ -546,12 +556,12 @@ static void pfield_set_linetoscr (void)
 
 	if (!(currprefs.chipset_mask & CSMASK_AGA) && !ecsshres) {
 		if (res_shift == 0) {
-				pfield_do_linetoscr_normal = linetoscr_16;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_vec : linetoscr_16;
 		} else if (res_shift == 2) {
 		} else if (res_shift == 1) {
-				pfield_do_linetoscr_normal = linetoscr_16_stretch1;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_stretch1_vec : linetoscr_16_stretch1;
 		} else if (res_shift == -1) {
-				pfield_do_linetoscr_normal = linetoscr_16_shrink1;
+				pfield_do_linetoscr_normal = vector ? linetoscr_16_shrink1_vec : linetoscr_16_shrink1;
 		}
 	}
 }
@@ -612,6 +622,204 @@ STATIC_INLINE int DECODE_HAM6_3(int col, int pv)
 static int ham_decode_pixel;
 static uae_u16 ham_lastcolor;
 
+#define HAM_OCS6 0
+#define HAM_AGA6 1
+#define HAM_AGA8 2
+
+/* One HAM pixel, exactly as the hardware sees it. pv is the raw apixels value. */
+STATIC_INLINE uae_u16 ham_step_ref (int pv, uae_u16 col, int mode)
+{
+	if (mode == HAM_AGA8) {
+		pv ^= bplxor;
+		switch (pv & 0x3) 
+    {
+			case 0x0: col = colors_for_drawing.acolors[pv >> 2]; break;
+#ifdef ARMV6T2
+			case 0x1: col = DECODE_HAM8_1(col, pv); break;
+			case 0x2: col = DECODE_HAM8_2(col, pv); break;
+			case 0x3: col = DECODE_HAM8_3(col, pv); break;
+#else
+			case 0x1: col &= 0xFFFF03; col |= (pv & 0xFC); break;
+			case 0x2: col &= 0x03FFFF; col |= (pv & 0xFC) << 16; break;
+			case 0x3: col &= 0xFF03FF; col |= (pv & 0xFC) << 8; break;
+#endif
+		}
+	} else if (mode == HAM_AGA6) {
+		pv ^= bplxor;
+		uae_u32 pc = ((pv & 0xf) << 0) | ((pv & 0xf) << 4);
+		switch (pv & 0x30) 
+    {
+			case 0x00: col = colors_for_drawing.acolors[pv]; break;
+#ifdef ARMV6T2
+			case 0x10: col = DECODE_HAM8_1(col, pc); break;
+			case 0x20: col = DECODE_HAM8_2(col, pc); break;
+			case 0x30: col = DECODE_HAM8_3(col, pc); break;
+#else
+			case 0x10: col &= 0xFFFF00; col |= (pv & 0xF) << 4; break;
+			case 0x20: col &= 0x00FFFF; col |= (pv & 0xF) << 20; break;
+			case 0x30: col &= 0xFF00FF; col |= (pv & 0xF) << 12; break;
+#endif
+		}
+	} else {
+		switch (pv & 0x30) 
+    {
+			case 0x00: col = colors_for_drawing.acolors[pv]; break;
+#ifdef ARMV6T2
+			case 0x10: col = DECODE_HAM6_1(col, pv); break;
+			case 0x20: col = DECODE_HAM6_2(col, pv); break;
+			case 0x30: col = DECODE_HAM6_3(col, pv); break;
+#else
+#if 0
+// Looks like uae4arm use a different way for ham intermediate decoding.
+			case 0x10: col &= 0xFF0; col |= (pv & 0xF); break;
+			case 0x20: col &= 0x0FF; col |= (pv & 0xF) << 8; break;
+			case 0x30: col &= 0xF0F; col |= (pv & 0xF) << 4; break;
+#else
+			case 0x10: col &= 0xFFE1; col |= (pv & 0xF) << 1; break;
+			case 0x20: col &= 0x0FFF; col |= (pv & 0xF) << 12; break;
+			case 0x30: col &= 0xF87F; col |= (pv & 0xF) << 7; break;
+#endif
+#endif
+		}
+	}
+	return col;
+}
+
+/*
+ * HAM is decoded from tables instead of the switch above. Every pixel value
+ * either loads a palette entry or replaces one channel of the previous
+ * colour, so it can be written as col = (col & keep) | set, with the palette
+ * entry folded into set. Two such steps compose into another one:
+ *
+ *   (k2, s2) after (k1, s1) == (k1 & k2, (s1 & k2) | s2)
+ *
+ * so with NEON a group of 8 pixels is resolved with a 3 step parallel prefix
+ * and only the last colour of the group carries over to the next one. The
+ * tables are derived from ham_step_ref, which makes them exact for both the
+ * ARMV6T2 and the C channel macros. HAM_CHECK compares every decoded span
+ * against ham_step_ref.
+ */
+#ifndef HAM_CHECK
+#define HAM_CHECK 0
+#endif
+
+static uae_u16 ham_keep[256];
+static uae_u16 ham_set[256];
+static uae_u16 ham_palmask[256];
+static uae_u8 ham_palidx[256];
+static int ham_table_key = -1;
+
+STATIC_INLINE int ham_palette_index (int pv, int mode)
+{
+	if (mode == HAM_AGA8) {
+		pv ^= bplxor;
+		return (pv & 0x3) ? -1 : pv >> 2;
+	}
+	if (mode == HAM_AGA6)
+		pv ^= bplxor;
+	return (pv & 0x30) ? -1 : pv;
+}
+
+static void ham_build_tables (int mode)
+{
+	int key = mode == HAM_OCS6 ? mode : mode | (bplxor << 2);
+	if (key == ham_table_key)
+		return;
+	for (int pv = 0; pv < 256; pv++) {
+		int idx = ham_palette_index (pv, mode);
+		if (idx >= 0) {
+			ham_keep[pv] = 0;
+			ham_set[pv] = 0;
+			ham_palmask[pv] = 0xffff;
+			ham_palidx[pv] = idx;
+		} else {
+			uae_u16 s = ham_step_ref (pv, 0, mode);
+			ham_keep[pv] = ham_step_ref (pv, 0xffff, mode) & ~s;
+			ham_set[pv] = s;
+			ham_palmask[pv] = 0;
+			ham_palidx[pv] = 0;
+		}
+	}
+	ham_table_key = key;
+}
+
+STATIC_INLINE int ham_mode (void)
+{
+	if (!aga_mode)
+		return HAM_OCS6;
+	return bplplanecnt >= 7 ? HAM_AGA8 : HAM_AGA6;
+}
+
+#define HAM_SET(pv) (ham_set[pv] | (colors_for_drawing.acolors[ham_palidx[pv]] & ham_palmask[pv]))
+
+/* Decode n HAM pixels starting at ham_decode_pixel. dst may be NULL. */
+static void ham_decode_run (int n, uae_u16 *dst)
+{
+	const uae_u8 *src = pixdata.apixels + ham_decode_pixel;
+	uae_u16 col = ham_lastcolor;
+
+	ham_decode_pixel += n;
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+	if (dst) {
+		uae_u16 k[8], s[8];
+		const uint16x8_t ones = vdupq_n_u16 (0xffff);
+		const uint16x8_t zero = vdupq_n_u16 (0);
+		while (n >= 8) {
+			for (int i = 0; i < 8; i++) {
+				int pv = src[i];
+				k[i] = ham_keep[pv];
+				s[i] = HAM_SET(pv);
+			}
+			uint16x8_t K = vld1q_u16 (k);
+			uint16x8_t S = vld1q_u16 (s);
+			/* lane i picks up lane i - d, lanes below d see the identity step */
+			S = vorrq_u16 (vandq_u16 (vextq_u16 (zero, S, 7), K), S);
+			K = vandq_u16 (vextq_u16 (ones, K, 7), K);
+			S = vorrq_u16 (vandq_u16 (vextq_u16 (zero, S, 6), K), S);
+			K = vandq_u16 (vextq_u16 (ones, K, 6), K);
+			S = vorrq_u16 (vandq_u16 (vextq_u16 (zero, S, 4), K), S);
+			K = vandq_u16 (vextq_u16 (ones, K, 4), K);
+			uint16x8_t out = vorrq_u16 (vandq_u16 (vdupq_n_u16 (col), K), S);
+			vst1q_u16 (dst, out);
+			col = vgetq_lane_u16 (out, 7);
+			src += 8;
+			dst += 8;
+			n -= 8;
+		}
+	}
+#endif
+	if (dst) {
+		while (n-- > 0) {
+			int pv = *src++;
+			col = (col & ham_keep[pv]) | HAM_SET(pv);
+			*dst++ = col;
+		}
+	} else {
+		while (n-- > 0) {
+			int pv = *src++;
+			col = (col & ham_keep[pv]) | HAM_SET(pv);
+		}
+	}
+	ham_lastcolor = col;
+}
+
+#if HAM_CHECK
+static void ham_check_run (int start, int n, uae_u16 col, int mode)
+{
+	static int errors;
+
+	for (int i = start; i < start + n; i++) {
+		col = ham_step_ref (pixdata.apixels[i], col, mode);
+		if (col != ham_linebuf[i] && errors < 20) {
+			write_log (_T("HAM mismatch mode %d pixel %d pv %02x: %04x != %04x\n"),
+				mode, i, pixdata.apixels[i], ham_linebuf[i], col);
+			errors++;
+			break;
+		}
+	}
+}
+#endif
+
 /* Decode HAM in the invisible portion of the display (left of VISIBLE_LEFT_BORDER),
  * but don't draw anything in.  This is done to prepare HAM_LASTCOLOR for later,
  * when decode_ham runs.
@@ -632,68 +840,9 @@ static void init_ham_decoding (void)
 			else
 				ham_lastcolor = colors_for_drawing.acolors[pv];
 		}
-	} else if (aga_mode) {
-		if (bplplanecnt >= 7) { /* AGA mode HAM8 */
-			while (unpainted_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel++] ^ bplxor;
-				switch (pv & 0x3) 
-        {
-					case 0x0: ham_lastcolor = colors_for_drawing.acolors[pv >> 2]; break;
-#ifdef ARMV6T2
-					case 0x1: ham_lastcolor = DECODE_HAM8_1(ham_lastcolor, pv); break;
-					case 0x2: ham_lastcolor = DECODE_HAM8_2(ham_lastcolor, pv); break;
-					case 0x3: ham_lastcolor = DECODE_HAM8_3(ham_lastcolor, pv); break;
-#else
-					case 0x1: ham_lastcolor &= 0xFFFF03; ham_lastcolor |= (pv & 0xFC); break;
-					case 0x2: ham_lastcolor &= 0x03FFFF; ham_lastcolor |= (pv & 0xFC) << 16; break;
-					case 0x3: ham_lastcolor &= 0xFF03FF; ham_lastcolor |= (pv & 0xFC) << 8; break;
-#endif
-				}
-			}
-		} else { /* AGA mode HAM6 */
-			while (unpainted_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel++] ^ bplxor;
-				uae_u32 pc = ((pv & 0xf) << 0) | ((pv & 0xf) << 4);
-				switch (pv & 0x30) 
-        {
-					case 0x00: ham_lastcolor = colors_for_drawing.acolors[pv]; break;
-#ifdef ARMV6T2
-					case 0x10: ham_lastcolor = DECODE_HAM8_1(ham_lastcolor, pc); break;
-					case 0x20: ham_lastcolor = DECODE_HAM8_2(ham_lastcolor, pc); break;
-					case 0x30: ham_lastcolor = DECODE_HAM8_3(ham_lastcolor, pc); break;
-#else
-					case 0x10: ham_lastcolor &= 0xFFFF00; ham_lastcolor |= (pv & 0xF) << 4; break;
-					case 0x20: ham_lastcolor &= 0x00FFFF; ham_lastcolor |= (pv & 0xF) << 20; break;
-					case 0x30: ham_lastcolor &= 0xFF00FF; ham_lastcolor |= (pv & 0xF) << 12; break;
-#endif
-				}
-			}
-		}
-	} else {
-		/* OCS/ECS mode HAM6 */
-		while (unpainted_amiga-- > 0) {
-			int pv = pixdata.apixels[ham_decode_pixel++];
-			switch (pv & 0x30) 
-      {
-				case 0x00: ham_lastcolor = colors_for_drawing.acolors[pv]; break;
-#ifdef ARMV6T2
-				case 0x10: ham_lastcolor = DECODE_HAM6_1(ham_lastcolor, pv); break;
-				case 0x20: ham_lastcolor = DECODE_HAM6_2(ham_lastcolor, pv); break;
-				case 0x30: ham_lastcolor = DECODE_HAM6_3(ham_lastcolor, pv); break;
-#else
-#if 0
-// Looks like uae4arm use a different way for ham intermediate decoding.
-				case 0x10: ham_lastcolor &= 0xFF0; ham_lastcolor |= (pv & 0xF); break;
-				case 0x20: ham_lastcolor &= 0x0FF; ham_lastcolor |= (pv & 0xF) << 8; break;
-				case 0x30: ham_lastcolor &= 0xF0F; ham_lastcolor |= (pv & 0xF) << 4; break;
-#else
-				case 0x10: ham_lastcolor &= 0xFFE1; ham_lastcolor |= (pv & 0xF) << 1; break;
-				case 0x20: ham_lastcolor &= 0x0FFF; ham_lastcolor |= (pv & 0xF) << 12; break;
-				case 0x30: ham_lastcolor &= 0xF87F; ham_lastcolor |= (pv & 0xF) << 7; break;
-#endif
-#endif
-			}
-		}
+	} else if (unpainted_amiga > 0) {
+		ham_build_tables (ham_mode ());
+		ham_decode_run (unpainted_amiga, NULL);
 	}
 }
 
@@ -711,71 +860,17 @@ static void decode_ham (int pix, int stoppos)
 			
 			ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
 		}
-	} else if (aga_mode) {
-		if (bplplanecnt >= 7) { /* AGA mode HAM8 */
-			while (todraw_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel] ^ bplxor;
-				switch (pv & 0x3) 
-        {
-					case 0x0: ham_lastcolor = colors_for_drawing.acolors[pv >> 2]; break;
-#ifdef ARMV6T2
-					case 0x1: ham_lastcolor = DECODE_HAM8_1(ham_lastcolor, pv); break;
-					case 0x2: ham_lastcolor = DECODE_HAM8_2(ham_lastcolor, pv); break;
-					case 0x3: ham_lastcolor = DECODE_HAM8_3(ham_lastcolor, pv); break;
-#else
-					case 0x1: ham_lastcolor &= 0xFFFF03; ham_lastcolor |= (pv & 0xFC); break;
-					case 0x2: ham_lastcolor &= 0x03FFFF; ham_lastcolor |= (pv & 0xFC) << 16; break;
-					case 0x3: ham_lastcolor &= 0xFF03FF; ham_lastcolor |= (pv & 0xFC) << 8; break;
-#endif
-				}
-				ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
-			}
-		} else { /* AGA mode HAM6 */
-			while (todraw_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel] ^ bplxor;
-				uae_u32 pc = ((pv & 0xf) << 0) | ((pv & 0xf) << 4);
-				switch (pv & 0x30) 
-        {
-					case 0x00: ham_lastcolor = colors_for_drawing.acolors[pv]; break;
-#ifdef ARMV6T2
-					case 0x10: ham_lastcolor = DECODE_HAM8_1(ham_lastcolor, pc); break;
-					case 0x20: ham_lastcolor = DECODE_HAM8_2(ham_lastcolor, pc); break;
-					case 0x30: ham_lastcolor = DECODE_HAM8_3(ham_lastcolor, pc); break;
-#else
-					case 0x10: ham_lastcolor &= 0xFFFF00; ham_lastcolor |= (pv & 0xF) << 4; break;
-					case 0x20: ham_lastcolor &= 0x00FFFF; ham_lastcolor |= (pv & 0xF) << 20; break;
-					case 0x30: ham_lastcolor &= 0xFF00FF; ham_lastcolor |= (pv & 0xF) << 12; break;
-#endif
-				}
-				ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
-			}
-		}
-	} else {
-		/* OCS/ECS mode HAM6 */
-		while (todraw_amiga-- > 0) {
-			int pv = pixdata.apixels[ham_decode_pixel];
-			switch (pv & 0x30) 
-      {
-				case 0x00: ham_lastcolor = colors_for_drawing.acolors[pv]; break;
-#ifdef ARMV6T2
-				case 0x10: ham_lastcolor = DECODE_HAM6_1(ham_lastcolor, pv); break;
-				case 0x20: ham_lastcolor = DECODE_HAM6_2(ham_lastcolor, pv); break;
-				case 0x30: ham_lastcolor = DECODE_HAM6_3(ham_lastcolor, pv); break;
-#else
-#if 0
-// Looks like uae4arm use a different way for ham intermediate decoding.
-				case 0x10: ham_lastcolor &= 0xFF0; ham_lastcolor |= (pv & 0xF); break;
-				case 0x20: ham_lastcolor &= 0x0FF; ham_lastcolor |= (pv & 0xF) << 8; break;
-				case 0x30: ham_lastcolor &= 0xF0F; ham_lastcolor |= (pv & 0xF) << 4; break;
-#else
-				case 0x10: ham_lastcolor &= 0xFFE1; ham_lastcolor |= (pv & 0xF) << 1; break;
-				case 0x20: ham_lastcolor &= 0x0FFF; ham_lastcolor |= (pv & 0xF) << 12; break;
-				case 0x30: ham_lastcolor &= 0xF87F; ham_lastcolor |= (pv & 0xF) << 7; break;
+	} else if (todraw_amiga > 0) {
+		int mode = ham_mode ();
+#if HAM_CHECK
+		int start = ham_decode_pixel;
+		uae_u16 col = ham_lastcolor;
 #endif
+		ham_build_tables (mode);
+		ham_decode_run (todraw_amiga, ham_linebuf + ham_decode_pixel);
+#if HAM_CHECK
+		ham_check_run (start, todraw_amiga, col, mode);
 #endif
-			}
-			ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
-		}
 	}
 }
 
@@ -844,6 +939,34 @@ static void gen_pfield_tables (void)
   }
 }
 
+/* Most of a sprite line is transparent. The drawing loops skip runs of
+   empty sprite pixels four buffer entries at a time and only go through
+   the per-pixel priority and attach logic for the rest. Set
+   SPRITE_SPAN_SKIP to 0 for the plain per-pixel reference loops.  */
+#ifndef SPRITE_SPAN_SKIP
+#define SPRITE_SPAN_SKIP 1
+#endif
+
+STATIC_INLINE bool sprite_span_empty (const uae_u16 *p)
+{
+  uae_u64 v;
+  memcpy (&v, p, sizeof v);
+  return v == 0;
+}
+
+#if SPRITE_SPAN_SKIP
+/* STEP is the buffer stride of the loop, ADV the window_pos increment per pixel */
+#define SPRITE_SKIP_EMPTY(MAX, STEP, ADV) \
+  while (pos + 4 <= (MAX) && sprite_span_empty (buf + pos)) { \
+    pos += 4; \
+    window_pos += (4 / (STEP)) * (ADV); \
+  } \
+  if (pos >= (MAX)) \
+    break;
+#else
+#define SPRITE_SKIP_EMPTY(MAX, STEP, ADV)
+#endif
+
 static void draw_sprites_normal_sp_lo_nat(struct sprite_entry *e)
 {
    uae_u16 *buf = spixels + e->first_pixel;
@@ -855,6 +978,7 @@ static void draw_sprites_normal_sp_lo_nat(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 1);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -879,6 +1003,7 @@ static void draw_sprites_normal_ham_lo_nat(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 1);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -905,6 +1030,7 @@ static void draw_sprites_normal_dp_lo_nat(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 1);
       int maskshift, plfmask;
       unsigned int v = buf[pos];
 
@@ -933,6 +1059,7 @@ static void draw_sprites_normal_sp_lo_at(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 1);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -965,6 +1092,7 @@ static void draw_sprites_normal_ham_lo_at(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 1);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -998,6 +1126,7 @@ static void draw_sprites_normal_dp_lo_at(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 1);
       int maskshift, plfmask;
       unsigned int v = buf[pos];
 
@@ -1031,6 +1160,7 @@ static void draw_sprites_normal_sp_hi_nat(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos ++) {
+      SPRITE_SKIP_EMPTY (max, 1, 2);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -1056,6 +1186,7 @@ static void draw_sprites_normal_ham_hi_nat(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos ++) {
+      SPRITE_SKIP_EMPTY (max, 1, 2);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -1084,6 +1215,7 @@ static void draw_sprites_normal_dp_hi_nat(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos ++) {
+      SPRITE_SKIP_EMPTY (max, 1, 2);
       int maskshift, plfmask;
       unsigned int v = buf[pos];
 
@@ -1113,6 +1245,7 @@ static void draw_sprites_normal_sp_hi_at(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 2);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -1146,6 +1279,7 @@ static void draw_sprites_normal_ham_hi_at(struct sprite_entry *e)
    window_pos += pixels_offset;
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 2);
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -1182,6 +1316,7 @@ static void draw_sprites_normal_dp_hi_at(struct sprite_entry *e)
 
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos++) {
+      SPRITE_SKIP_EMPTY (max, 1, 2);
       int maskshift, plfmask;
       unsigned int v = buf[pos];
 
@@ -1219,6 +1354,7 @@ static void draw_sprites_normal_sp_shi_nat(struct sprite_entry *e)
 
    unsigned max=e->max;
    for (pos = e->pos; pos < max; pos ++) {
+      SPRITE_SKIP_EMPTY (max, 1, (1 << (2 - sprite_buffer_res)));
       unsigned int v = buf[pos];
 
       if(pixdata.apixels[window_pos])
@@ -1277,6 +1413,7 @@ STATIC_INLINE void draw_sprites_aga_ham (struct sprite_entry *e, const int doubl
   window_pos += pixels_offset;
 
   for (pos = e->pos; pos < e->max; pos += 1 << skip) {
+    SPRITE_SKIP_EMPTY (e->max, 1 << skip, 1 << doubling);
     unsigned int v = buf[pos];
 
     if(v) {
@@ -1326,6 +1463,7 @@ STATIC_INLINE void draw_sprites_aga_dp (struct sprite_entry *e, const int doubli
 	  sprite_first_x = window_pos;
 
   for (pos = e->pos; pos < e->max; pos += 1 << skip) {
+    SPRITE_SKIP_EMPTY (e->max, 1 << skip, 1 << doubling);
     int maskshift, plfmask;
     unsigned int v = buf[pos];
 
@@ -1379,6 +1517,7 @@ STATIC_INLINE void draw_sprites_aga_sp (struct sprite_entry *e, const int doubli
   window_pos += pixels_offset;
 
   for (pos = e->pos; pos < e->max; pos += 1 << skip) {
+    SPRITE_SKIP_EMPTY (e->max, 1 << skip, 1 << doubling);
     unsigned int v = buf[pos];
 
     if(v) {
@@ -1000,7 +1000,7 @@ typedef struct exallkey {
 
 #define EXKEYS 128
 #define EXALLKEYS 100
-#define MAX_AINO_HASH 128
+#define AINO_HASH_MIN 1024
 #define NOTIFY_HASH_SIZE 127
 
 /* handler state info */
@@ -1042,9 +1042,20 @@ typedef struct _unit {
 
   a_inode rootnode;
 	unsigned int aino_cache_size;
-  a_inode *aino_hash[MAX_AINO_HASH];
+	/* uniq -> a_inode, and per-directory name lookups. Both grow as needed. */
+	a_inode **aino_hash;
+	unsigned int aino_hash_size;
+	unsigned int aino_hash_count;
+	a_inode **aname_hash;
+	a_inode **nname_hash;
+	unsigned int name_hash_size;
+	unsigned int name_hash_count;
 	unsigned int nr_cache_hits;
 	unsigned int nr_cache_lookups;
+	unsigned int nr_tree_walks;
+	unsigned int nr_child_lookups;
+	unsigned int nr_child_hits;
+	unsigned int nr_rehash;
 
   struct notify *notifyhash[NOTIFY_HASH_SIZE];
 
@@ -1405,6 +1416,7 @@ static void set_volume_name (Unit *unit, struct mytimeval *tv)
 		put_long (unit->volume + 24, ticks);
 	}
 	xfree (s);
+	fsdb_free_index (&unit->rootnode);
   unit->rootnode.aname = unit->ui.volname;
   unit->rootnode.nname = unit->ui.rootdir;
   unit->rootnode.mountcount = unit->mountcount;
@@ -1864,17 +1876,176 @@ static void de_recycle_aino (Unit *unit, a_inode *aino)
   unit->aino_cache_size--;
 }
 
+/* The hashed name of a child is its last path component, which is what
+ * lookup_child_aino and lookup_child_aino_for_exnext compare against.  */
+static uae_u32 aino_name_hash (a_inode *parent, const TCHAR *name, TCHAR sep, bool nocase)
+{
+  const TCHAR *p = _tcsrchr (name, sep);
+  uae_u32 h = 2166136261u ^ (uae_u32)(uintptr_t)parent;
+
+  for (p = p ? p + 1 : name; *p; p++) {
+    h ^= nocase ? (uae_u8)tolower ((uae_u8)*p) : (uae_u8)*p;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static a_inode **aino_aname_bucket (Unit *unit, a_inode *parent, const TCHAR *name)
+{
+  return &unit->aname_hash[aino_name_hash (parent, name, '/', true) & (unit->name_hash_size - 1)];
+}
+
+static a_inode **aino_nname_bucket (Unit *unit, a_inode *parent, const TCHAR *name)
+{
+  return &unit->nname_hash[aino_name_hash (parent, name, FSDB_DIR_SEPARATOR, false) & (unit->name_hash_size - 1)];
+}
+
+static void aino_hash_resize (Unit *unit, unsigned int size)
+{
+  a_inode **old = unit->aino_hash;
+  unsigned int oldsize = unit->aino_hash_size;
+
+  unit->aino_hash = xcalloc (a_inode*, size);
+  unit->aino_hash_size = size;
+  for (unsigned int i = 0; i < oldsize; i++) {
+    a_inode *a = old[i];
+    while (a) {
+      a_inode *next = a->uniq_next;
+      a_inode **b = &unit->aino_hash[a->uniq & (size - 1)];
+      a->uniq_next = *b;
+      *b = a;
+      a = next;
+    }
+  }
+  xfree (old);
+  unit->nr_rehash++;
+}
+
+static void name_hash_resize (Unit *unit, unsigned int size)
+{
+  a_inode **olda = unit->aname_hash, **oldn = unit->nname_hash;
+  unsigned int oldsize = unit->name_hash_size;
+
+  unit->aname_hash = xcalloc (a_inode*, size);
+  unit->nname_hash = xcalloc (a_inode*, size);
+  unit->name_hash_size = size;
+  for (unsigned int i = 0; i < oldsize; i++) {
+    a_inode *a = olda[i];
+    while (a) {
+      a_inode *next = a->aname_next;
+      a_inode **b = aino_aname_bucket (unit, a->parent, a->aname);
+      a->aname_next = *b;
+      *b = a;
+      a = next;
+    }
+    a = oldn[i];
+    while (a) {
+      a_inode *next = a->nname_next;
+      a_inode **b = aino_nname_bucket (unit, a->parent, a->nname);
+      a->nname_next = *b;
+      *b = a;
+      a = next;
+    }
+  }
+  xfree (olda);
+  xfree (oldn);
+  unit->nr_rehash++;
+}
+
+static void aino_hash_insert (Unit *unit, a_inode *aino)
+{
+  a_inode **b;
+
+  if (unit->aino_hash_count >= unit->aino_hash_size)
+    aino_hash_resize (unit, unit->aino_hash_size ? unit->aino_hash_size * 2 : AINO_HASH_MIN);
+  b = &unit->aino_hash[aino->uniq & (unit->aino_hash_size - 1)];
+  aino->uniq_next = *b;
+  *b = aino;
+  unit->aino_hash_count++;
+}
+
+static void aino_hash_remove (Unit *unit, a_inode *aino)
+{
+  a_inode **b;
+
+  if (!unit->aino_hash_size)
+    return;
+  for (b = &unit->aino_hash[aino->uniq & (unit->aino_hash_size - 1)]; *b; b = &(*b)->uniq_next) {
+    if (*b == aino) {
+      *b = aino->uniq_next;
+      aino->uniq_next = 0;
+      unit->aino_hash_count--;
+      return;
+    }
+  }
+}
+
+/* Names and parent must not change while an a_inode is linked.  */
+static void aino_link_names (Unit *unit, a_inode *aino)
+{
+  a_inode **b;
+
+  if (unit->name_hash_count >= unit->name_hash_size)
+    name_hash_resize (unit, unit->name_hash_size ? unit->name_hash_size * 2 : AINO_HASH_MIN);
+  b = aino_aname_bucket (unit, aino->parent, aino->aname);
+  aino->aname_next = *b;
+  *b = aino;
+  b = aino_nname_bucket (unit, aino->parent, aino->nname);
+  aino->nname_next = *b;
+  *b = aino;
+  unit->name_hash_count++;
+}
+
+static void aino_unlink_names (Unit *unit, a_inode *aino)
+{
+  a_inode **b;
+
+  if (!unit->name_hash_size)
+    return;
+  for (b = aino_aname_bucket (unit, aino->parent, aino->aname); *b; b = &(*b)->aname_next) {
+    if (*b == aino) {
+      *b = aino->aname_next;
+      break;
+    }
+  }
+  for (b = aino_nname_bucket (unit, aino->parent, aino->nname); *b; b = &(*b)->nname_next) {
+    if (*b == aino) {
+      *b = aino->nname_next;
+      unit->name_hash_count--;
+      break;
+    }
+  }
+  aino->aname_next = aino->nname_next = 0;
+}
+
+static void aino_hash_free (Unit *unit)
+{
+  if (unit->nr_cache_lookups || unit->nr_child_lookups)
+    write_log (_T("FILESYS: unit %d: %u/%u uniq lookups hashed, %u tree walks, %u/%u child lookups hashed, %u rehashes, %u/%u buckets used\n"),
+      unit->unit, unit->nr_cache_hits, unit->nr_cache_lookups, unit->nr_tree_walks,
+      unit->nr_child_hits, unit->nr_child_lookups, unit->nr_rehash,
+      unit->aino_hash_count, unit->aino_hash_size);
+  xfree (unit->aino_hash);
+  xfree (unit->aname_hash);
+  xfree (unit->nname_hash);
+  unit->aino_hash = unit->aname_hash = unit->nname_hash = 0;
+  unit->aino_hash_size = unit->aino_hash_count = 0;
+  unit->name_hash_size = unit->name_hash_count = 0;
+  unit->nr_cache_hits = unit->nr_cache_lookups = unit->nr_tree_walks = 0;
+  unit->nr_child_lookups = unit->nr_child_hits = unit->nr_rehash = 0;
+}
+
 static void dispose_aino (Unit *unit, a_inode **aip, a_inode *aino)
 {
-  int hash = aino->uniq % MAX_AINO_HASH;
-  if (unit->aino_hash[hash] == aino)
-  	unit->aino_hash[hash] = 0;
+  aino_hash_remove (unit, aino);
+  aino_unlink_names (unit, aino);
 
   if (aino->dirty && aino->parent)
   	fsdb_dir_writeback (aino->parent);
 
   *aip = aino->sibling;
 
+	fsdb_free_index (aino);
   xfree (aino->aname);
 	xfree (aino->comment);
   xfree (aino->nname);
@@ -1982,6 +2153,7 @@ static void update_child_names (Unit *unit, a_inode *a, a_inode *parent)
 	  TCHAR *new_name;
 	  TCHAR dirsep[2] = { FSDB_DIR_SEPARATOR, '\0' };
 	  
+  	aino_unlink_names (unit, a);
   	a->parent = parent;
   	name_start = _tcsrchr (a->nname, FSDB_DIR_SEPARATOR);
   	if (name_start == 0) {
@@ -1994,6 +2166,7 @@ static void update_child_names (Unit *unit, a_inode *a, a_inode *parent)
 	  _tcscat (new_name, name_start);
 	  xfree (a->nname);
 	  a->nname = new_name;
+  	aino_link_names (unit, a);
 	  if (a->child)
 	    update_child_names (unit, a->child, a);
   	a = a->sibling;
@@ -2081,19 +2254,22 @@ static a_inode *lookup_sub (a_inode *dir, uae_u32 uniq)
 
 static a_inode *lookup_aino (Unit *unit, uae_u32 uniq)
 {
-  a_inode *a;
-  int hash = uniq % MAX_AINO_HASH;
+  a_inode *a = 0;
 
   if (uniq == 0)
   	return &unit->rootnode;
-  a = unit->aino_hash[hash];
-  if (a == 0 || a->uniq != uniq)
-  	a = lookup_sub (&unit->rootnode, uniq);
-  else
-  	unit->nr_cache_hits++;
   unit->nr_cache_lookups++;
-  unit->aino_hash[hash] = a;
-  return a;
+  if (unit->aino_hash_size) {
+    for (a = unit->aino_hash[uniq & (unit->aino_hash_size - 1)]; a; a = a->uniq_next) {
+      if (a->uniq == uniq) {
+        unit->nr_cache_hits++;
+        return a;
+      }
+    }
+  }
+  /* every linked a_inode is hashed, this only finds stale uniqs */
+  unit->nr_tree_walks++;
+  return lookup_sub (&unit->rootnode, uniq);
 }
 static a_inode *aino_from_lock (TrapContext *ctx, Unit *unit, uaecptr lock)
 {
@@ -2219,6 +2395,8 @@ static void init_child_aino_tree(Unit *unit, a_inode *base, a_inode *aino)
   base->child = aino;
   aino->next = aino->prev = 0;
   aino->volflags = unit->volflags;
+  aino_hash_insert (unit, aino);
+  aino_link_names (unit, aino);
 }
 
 static void init_child_aino (Unit *unit, a_inode *base, a_inode *aino)
@@ -2314,7 +2492,7 @@ static a_inode *create_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int is
 
 static a_inode *lookup_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int *err)
 {
-  a_inode *c = base->child;
+  a_inode *c = 0;
   int l0 = _tcslen (rel);
 
   if (base->dir == 0) {
@@ -2322,15 +2500,20 @@ static a_inode *lookup_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int *e
     return 0;
   }
    
+  unit->nr_child_lookups++;
+  if (unit->name_hash_size)
+    c = *aino_aname_bucket (unit, base, rel);
   while (c != 0) {
 	  int l1 = _tcslen (c->aname);
-    if (l0 <= l1 && same_aname (rel, c->aname + l1 - l0)
+    if (c->parent == base && l0 <= l1 && same_aname (rel, c->aname + l1 - l0)
 	    && (l0 == l1 || c->aname[l1-l0-1] == '/') && c->mountcount == unit->mountcount)
       break;
-    c = c->sibling;
+    c = c->aname_next;
   }
-  if (c != 0)
+  if (c != 0) {
+    unit->nr_child_hits++;
     return c;
+  }
   c = new_child_aino (unit, base, rel);
   if (c == 0)
     *err = ERROR_OBJECT_NOT_AROUND;
@@ -2340,21 +2523,26 @@ static a_inode *lookup_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int *e
 /* Different version because for this one, REL is an nname.  */
 static a_inode *lookup_child_aino_for_exnext (Unit *unit, a_inode *base, TCHAR *rel, uae_u32 *err, uae_u64 uniq_external, struct virtualfilesysobject *vfso)
 {
-  a_inode *c = base->child;
+  a_inode *c = 0;
   int l0 = _tcslen (rel);
   int isvirtual = unit->volflags & MYVOLUMEINFO_ARCHIVE;
 
   *err = 0;
+  unit->nr_child_lookups++;
+  if (unit->name_hash_size)
+    c = *aino_nname_bucket (unit, base, rel);
   while (c != 0) {
   	int l1 = _tcslen (c->nname);
   	/* Note: using _tcscmp here.  */
-  	if (l0 <= l1 && _tcscmp (rel, c->nname + l1 - l0) == 0
+  	if (c->parent == base && l0 <= l1 && _tcscmp (rel, c->nname + l1 - l0) == 0
 	    && (l0 == l1 || c->nname[l1-l0-1] == FSDB_DIR_SEPARATOR) && c->mountcount == unit->mountcount)
 	    break;
-  	c = c->sibling;
+  	c = c->nname_next;
   }
-  if (c != 0)
+  if (c != 0) {
+    unit->nr_child_hits++;
   	return c;
+  }
 	if (!isvirtual && !vfso)
     c = fsdb_lookup_aino_nname (base, rel);
   if (c == 0) {
@@ -2542,8 +2730,6 @@ static Unit *startup_create_unit (TrapContext *ctx, UnitInfo *uinfo, int num)
   unit->rootnode.has_dbentry = 0;
   unit->rootnode.volflags = uinfo->volflags;
   unit->aino_cache_size = 0;
-  for (i = 0; i < MAX_AINO_HASH; i++)
-  	unit->aino_hash[i] = 0;
   return unit;
 }
 
@@ -5225,6 +5411,7 @@ static void	action_rename_object(TrapContext *ctx, Unit *unit, dpacket *packet)
   a2->comment = a1->comment;
   a1->comment = 0;
   a2->amigaos_mode = a1->amigaos_mode;
+  aino_hash_remove (unit, a2);
   a2->uniq = a1->uniq;
   a2->elock = a1->elock;
   a2->shlock = a1->shlock;
@@ -5235,6 +5422,7 @@ static void	action_rename_object(TrapContext *ctx, Unit *unit, dpacket *packet)
   move_exkeys (unit, a1, a2);
   move_aino_children (unit, a1, a2);
   delete_aino (unit, a1);
+  aino_hash_insert (unit, a2);
   a2->dirty = 1;
   if (a2->parent)
   	fsdb_dir_writeback (a2->parent);
@@ -6207,6 +6395,8 @@ void filesys_free_handles(void)
 		}
 		u->waitingrecords = NULL;
   	free_all_ainos (u, &u->rootnode);
+		fsdb_free_index (&u->rootnode);
+		aino_hash_free (u);
   	u->rootnode.next = u->rootnode.prev = &u->rootnode;
   	u->aino_cache_size = 0;
   	xfree(u->newrootdir);
@@ -2333,10 +2333,168 @@ static void fpuop_arithmetic2 (uae_u32 opcode, uae_u16 extra)
 	fpu_noinst (opcode, pc);
 }
 
+/*
+ * Fast FPU mode (fpu_fast). The basic arithmetic instructions (the ones
+ * the 68040/68060 implement in hardware) with an FP register, Dn or
+ * (An)/(An)+/-(An)/(d16,An) source are decoded here directly, without
+ * get_fp_value, the unimplemented instruction checks and fp_arithmetic.
+ * Results and FPSR come out as on the normal path. Everything else
+ * returns false before touching any state and takes the normal path:
+ * FMOVECR, the other opcodes, extended/packed or PC relative operands,
+ * a pending exception, exceptions enabled in FPCR, or no FPU.
+ */
+static bool fpuop_arithmetic_fast (uae_u32 opcode, uae_u16 extra)
+{
+	static const int sz1[8] = { 4, 4, 12, 12, 2, 8, 1, 0 };
+	uaecptr pc = m68k_getpc () - 4;
+	int mode = (opcode >> 3) & 7;
+	int reg = opcode & 7;
+	int size = (extra >> 10) & 7;
+	int prec;
+	uaecptr ad;
+	fpdata src, dst;
+
+	if ((extra & 0xa000) || (regs.fpcr & 0xff00) || regs.fp_unimp_pend || if_no_fpu ())
+		return false;
+	/* FSxxx/FDxxx are F-line on 6888x */
+	if ((extra & 0x40) && (currprefs.fpu_model == 68881 || currprefs.fpu_model == 68882))
+		return false;
+	switch (extra & 0x7f)
+	{
+		case 0x00: case 0x04: case 0x18: case 0x1a:
+		case 0x20: case 0x22: case 0x23: case 0x28:
+			prec = fpu_prec;
+			break;
+		case 0x40: case 0x41: case 0x58: case 0x5a:
+		case 0x60: case 0x62: case 0x63: case 0x68:
+			prec = 32;
+			break;
+		case 0x44: case 0x45: case 0x5c: case 0x5e:
+		case 0x64: case 0x66: case 0x67: case 0x6c:
+			prec = 64;
+			break;
+		case 0x38: /* FCMP */
+		case 0x3a: /* FTST */
+			prec = 0;
+			break;
+		default:
+			return false;
+	}
+
+	if (!(extra & 0x4000)) {
+		src = regs.fp[size];
+	} else if (mode == 0) {
+		switch (size)
+		{
+			case 0:
+				fpset(&src, (uae_s32) m68k_dreg (regs, reg));
+				break;
+			case 1:
+				fpp_to_single (&src, m68k_dreg (regs, reg));
+				break;
+			case 4:
+				fpset(&src, (uae_s16) m68k_dreg (regs, reg));
+				break;
+			case 6:
+				fpset(&src, (uae_s8) m68k_dreg (regs, reg));
+				break;
+			default:
+				return false;
+		}
+	} else {
+		if (size == 2 || size == 3 || size == 7 || mode < 2 || mode > 5)
+			return false;
+		switch (mode)
+		{
+			case 2:
+				ad = m68k_areg (regs, reg);
+				break;
+			case 3:
+				ad = m68k_areg (regs, reg);
+				m68k_areg (regs, reg) += reg == 7 && size == 6 ? 2 : sz1[size];
+				break;
+			case 4:
+				m68k_areg (regs, reg) -= reg == 7 && size == 6 ? 2 : sz1[size];
+				ad = m68k_areg (regs, reg);
+				break;
+			default:
+				ad = m68k_areg (regs, reg) + (uae_s32) (uae_s16) x_cp_next_iword ();
+				break;
+		}
+		switch (size)
+		{
+			case 0:
+				fpset(&src, (uae_s32) x_cp_get_long (ad));
+				break;
+			case 1:
+				fpp_to_single (&src, x_cp_get_long (ad));
+				break;
+			case 4:
+				fpset(&src, (uae_s16) x_cp_get_word (ad));
+				break;
+			case 5:
+				{
+					uae_u32 wrd1 = x_cp_get_long (ad);
+					uae_u32 wrd2 = x_cp_get_long (ad + 4);
+					fpp_to_double (&src, wrd1, wrd2);
+				}
+				break;
+			default:
+				fpset(&src, (uae_s8) x_cp_get_byte (ad));
+				break;
+		}
+	}
+
+	regs.fpiar = pc;
+	fpsr_clear_status();
+	reg = (extra >> 7) & 7;
+	dst = regs.fp[reg];
+	switch (extra & 0x7f)
+	{
+		case 0x00: case 0x40: case 0x44:
+			fpp_move(&dst, &src, prec);
+			break;
+		case 0x04: case 0x41: case 0x45:
+			fpp_sqrt(&dst, &src, prec);
+			break;
+		case 0x18: case 0x58: case 0x5c:
+			fpp_abs(&dst, &src, prec);
+			break;
+		case 0x1a: case 0x5a: case 0x5e:
+			fpp_neg(&dst, &src, prec);
+			break;
+		case 0x20: case 0x60: case 0x64:
+			fpp_div(&dst, &src, prec);
+			break;
+		case 0x22: case 0x62: case 0x66:
+			fpp_add(&dst, &src, prec);
+			break;
+		case 0x23: case 0x63: case 0x67:
+			fpp_mul(&dst, &src, prec);
+			break;
+		case 0x28: case 0x68: case 0x6c:
+			fpp_sub(&dst, &src, prec);
+			break;
+		case 0x38: /* FCMP */
+			fpp_cmp(&dst, &src);
+			break;
+		case 0x3a: /* FTST */
+			fpp_tst(&dst, &src);
+			break;
+	}
+	fpsr_set_result(&dst);
+	fpsr_make_status();
+	if (prec)
+		regs.fp[reg] = dst;
+	return true;
+}
+
 void fpuop_arithmetic (uae_u32 opcode, uae_u16 extra)
 {
 	regs.fpu_state = 1;
 	regs.fp_exception = false;
+	if (currprefs.fpu_fast && fpuop_arithmetic_fast (opcode, extra))
+		return;
 	fpuop_arithmetic2 (opcode, extra);
 }
 
@@ -22,6 +22,10 @@
 #include "fsdb.h"
 #include "uae/io.h"
 
+#include <vector>
+#include <string>
+#include <unordered_map>
+
 /* The on-disk format is as follows:
  * Offset 0, 1 byte, valid
  * Offset 1, 4 bytes, mode
@@ -30,6 +34,21 @@
  * Offset 519, 81 bytes, comment
  */
 
+#define FSDB_RECSIZE (1 + 4 + 257 + 257 + 81)
+
+/* Each directory's database is read once and kept in memory, indexed by
+ * Amiga name (case-insensitive, like same_aname) and by native name.  The
+ * file itself is only written, one record at a time, by fsdb_dir_writeback.
+ * Lookups return the first matching record, as a linear scan would.  */
+struct fsdb_index {
+  std::vector<uae_u8> data;
+  std::unordered_map<std::string, int> aname;
+  std::unordered_map<std::string, int> nname;
+  /* exact Amiga name of every record, deleted ones included: writeback
+   * reuses the slot of an earlier entry with the same name */
+  std::unordered_map<std::string, int> slot;
+};
+
 #define TRACING_ENABLED 0
 #if TRACING_ENABLED
 #define TRACE(x) do { write_log x; } while(0)
@@ -94,6 +113,7 @@ static void kill_fsdb (a_inode *dir)
   TCHAR *n = build_nname (dir->nname, FSDB_FILE);
   _wunlink (n);
   xfree (n);
+	fsdb_free_index (dir);
 }
 
 static void fsdb_fixup (FILE *f, uae_u8 *buf, int size, a_inode *base)
@@ -120,7 +140,7 @@ static void fsdb_fixup (FILE *f, uae_u8 *buf, int size, a_inode *base)
 /* Prune the db file the first time this directory is opened in a session.  */
 void fsdb_clean_dir (a_inode *dir)
 {
-	uae_u8 buf[1 + 4 + 257 + 257 + 81];
+	uae_u8 buf[FSDB_RECSIZE];
   TCHAR *n;
   FILE *f;
   off_t pos1 = 0, pos2;
@@ -154,6 +174,7 @@ void fsdb_clean_dir (a_inode *dir)
     my_truncate (n, pos1);
 	}
   xfree (n);
+	fsdb_free_index (dir);
 }
 
 static a_inode *aino_from_buf (a_inode *base, uae_u8 *buf, long off)
@@ -179,83 +200,158 @@ static a_inode *aino_from_buf (a_inode *base, uae_u8 *buf, long off)
   return aino;
 }
 
-a_inode *fsdb_lookup_aino_aname (a_inode *base, const TCHAR *aname)
+enum { FSDB_KEY_SLOT, FSDB_KEY_ANAME, FSDB_KEY_NNAME };
+
+static std::unordered_map<std::string, int> &index_map (struct fsdb_index *idx, int which)
+{
+	if (which == FSDB_KEY_ANAME)
+		return idx->aname;
+	if (which == FSDB_KEY_NNAME)
+		return idx->nname;
+	return idx->slot;
+}
+
+static std::string aname_key (const char *s)
+{
+	std::string k (s);
+	for (size_t i = 0; i < k.size (); i++)
+		k[i] = tolower ((unsigned char)k[i]);
+	return k;
+}
+
+static bool record_key (const uae_u8 *buf, int which, std::string &key)
+{
+	if (which == FSDB_KEY_SLOT) {
+		key = (const char*)buf + 5;
+		return true;
+	}
+	if (buf[0] == 0)
+		return false;
+	if (which == FSDB_KEY_ANAME)
+		key = aname_key ((const char*)buf + 5);
+	else
+		key = (const char*)buf + 5 + 257;
+	return true;
+}
+
+static int index_count (struct fsdb_index *idx)
+{
+	return idx->data.size () / FSDB_RECSIZE;
+}
+
+static uae_u8 *index_record (struct fsdb_index *idx, int i)
+{
+	return &idx->data[i * FSDB_RECSIZE];
+}
+
+static void index_add_keys (struct fsdb_index *idx, int i)
+{
+	std::string key;
+
+	for (int which = FSDB_KEY_SLOT; which <= FSDB_KEY_NNAME; which++) {
+		if (!record_key (index_record (idx, i), which, key))
+			continue;
+		std::unordered_map<std::string, int> &m = index_map (idx, which);
+		std::unordered_map<std::string, int>::iterator it = m.find (key);
+		if (it == m.end ())
+			m[key] = i;
+		else if (it->second > i)
+			it->second = i;
+	}
+}
+
+/* Record i is about to change: forget its keys, letting a later record
+ * with the same name take over.  */
+static void index_drop_keys (struct fsdb_index *idx, int i)
 {
+	std::string key, other;
+
+	for (int which = FSDB_KEY_SLOT; which <= FSDB_KEY_NNAME; which++) {
+		if (!record_key (index_record (idx, i), which, key))
+			continue;
+		std::unordered_map<std::string, int> &m = index_map (idx, which);
+		std::unordered_map<std::string, int>::iterator it = m.find (key);
+		if (it == m.end () || it->second != i)
+			continue;
+		m.erase (it);
+		for (int j = i + 1; j < index_count (idx); j++) {
+			if (record_key (index_record (idx, j), which, other) && other == key) {
+				m[key] = j;
+				break;
+			}
+		}
+	}
+}
+
+static void index_store (struct fsdb_index *idx, int i, const uae_u8 *buf)
+{
+	if (i >= index_count (idx))
+		idx->data.resize ((i + 1) * FSDB_RECSIZE, 0);
+	else
+		index_drop_keys (idx, i);
+	memcpy (index_record (idx, i), buf, FSDB_RECSIZE);
+	index_add_keys (idx, i);
+}
+
+static struct fsdb_index *get_index (a_inode *dir)
+{
+	struct fsdb_index *idx = dir->fsdb_index;
   FILE *f;
 
-  f = get_fsdb (base, _T("r+b"));
-  if (f == 0) {
-    return 0;
-  }
-  for (;;) {
-  	uae_u8 buf[1 + 4 + 257 + 257 + 81];
-		TCHAR *s;
-  	if (fread (buf, 1, sizeof buf, f) < sizeof buf)
-	    break;
-		s = au ((char*)buf + 5);
-		if (buf[0] != 0 && same_aname (s, aname)) {
-	    long pos = ftell (f) - sizeof buf;
-	    fclose (f);
-			xfree (s);
-	    return aino_from_buf (base, buf, pos);
-  	}
-		xfree (s);
-  }
-  fclose (f);
-  return 0;
+	if (idx)
+		return idx;
+	idx = new fsdb_index;
+	f = get_fsdb (dir, _T("rb"));
+	if (f) {
+		fseek (f, 0, SEEK_END);
+		long size = ftell (f);
+		fseek (f, 0, SEEK_SET);
+		size -= size % FSDB_RECSIZE;
+		if (size > 0) {
+			idx->data.resize (size);
+			if (fread (&idx->data[0], 1, size, f) != size)
+				idx->data.clear ();
+		}
+		fclose (f);
+	}
+	for (int i = 0; i < index_count (idx); i++)
+		index_add_keys (idx, i);
+	TRACE ((_T("fsdb index '%s': %d records\n"), dir->nname, index_count (idx)));
+	dir->fsdb_index = idx;
+	return idx;
+}
+
+void fsdb_free_index (a_inode *dir)
+{
+	delete dir->fsdb_index;
+	dir->fsdb_index = NULL;
+}
+
+a_inode *fsdb_lookup_aino_aname (a_inode *base, const TCHAR *aname)
+{
+	struct fsdb_index *idx = get_index (base);
+	std::unordered_map<std::string, int>::iterator it = idx->aname.find (aname_key (aname));
+
+	if (it == idx->aname.end ())
+		return 0;
+	return aino_from_buf (base, index_record (idx, it->second), it->second * FSDB_RECSIZE);
 }
 
 a_inode *fsdb_lookup_aino_nname (a_inode *base, const TCHAR *nname)
 {
-  FILE *f;
-	char *s;
+	struct fsdb_index *idx = get_index (base);
+	std::unordered_map<std::string, int>::iterator it = idx->nname.find (nname);
 
-  f = get_fsdb (base, _T("r+b"));
-  if (f == 0) {
-  	return 0;
-  }
-	s = ua (nname);
-  for (;;) {
-  	uae_u8 buf[1 + 4 + 257 + 257 + 81];
-  	if (fread (buf, 1, sizeof buf, f) < sizeof buf)
-	    break;
-		if (buf[0] != 0 && strcmp ((char*)buf + 5 + 257, s) == 0) {
-	    long pos = ftell (f) - sizeof buf;
-	    fclose (f);
-			xfree (s);
-	    return aino_from_buf (base, buf, pos);
-  	}
-  }
-	xfree (s);
-  fclose (f);
-  return 0;
+	if (it == idx->nname.end ())
+		return 0;
+	return aino_from_buf (base, index_record (idx, it->second), it->second * FSDB_RECSIZE);
 }
 
 int fsdb_used_as_nname (a_inode *base, const TCHAR *nname)
 {
-  FILE *f;
-  uae_u8 buf[1 + 4 + 257 + 257 + 81];
+	struct fsdb_index *idx = get_index (base);
 
-	f = get_fsdb (base, _T("r+b"));
-  if (f == 0) {
-    return 0;
-  }
-  for (;;) {
-		TCHAR *s;
-  	if (fread (buf, 1, sizeof buf, f) < sizeof buf)
-	    break;
-  	if (buf[0] == 0)
-	    continue;
-		s = au ((char*)buf + 5 + 257);
-		if (_tcscmp (s, nname) == 0) {
-			xfree (s);
-	    fclose (f);
-	    return 1;
-  	}
-		xfree (s);
-  }
-  fclose (f);
-  return 0;
+	return idx->nname.find (nname) != idx->nname.end ();
 }
 
 static int needs_dbentry (a_inode *aino)
@@ -272,9 +368,9 @@ static int needs_dbentry (a_inode *aino)
   return _tcscmp (nn_begin, aino->aname) != 0;
 }
 
-static void write_aino (FILE *f, a_inode *aino)
+static void write_aino (FILE *f, struct fsdb_index *idx, a_inode *aino)
 {
-  uae_u8 buf[1 + 4 + 257 + 257 + 81] = { 0 };
+  uae_u8 buf[FSDB_RECSIZE] = { 0 };
 
 	buf[0] = aino->needs_dbentry ? 1 : 0;
   do_put_mem_long ((uae_u32 *)(buf + 1), aino->amigaos_mode);
@@ -284,8 +380,9 @@ static void write_aino (FILE *f, a_inode *aino)
   buf[5 + 257 + 256] = '\0';
 	ua_copy ((char*)buf + 5 + 2 * 257, 80, aino->comment ? aino->comment : _T(""));
   buf[5 + 2 * 257 + 80] = '\0';
-  aino->db_offset = ftell (f);
+  fseek (f, aino->db_offset, SEEK_SET);
   fwrite (buf, 1, sizeof buf, f);
+	index_store (idx, aino->db_offset / FSDB_RECSIZE, buf);
   aino->has_dbentry = aino->needs_dbentry;
 	TRACE ((_T("%d '%s' '%s' written\n"), aino->db_offset, aino->aname, aino->nname));
 }
@@ -298,8 +395,7 @@ void fsdb_dir_writeback (a_inode *dir)
   int changes_needed = 0;
   int entries_needed = 0;
   a_inode *aino;
-  uae_u8 *tmpbuf;
-  int size, i;
+	struct fsdb_index *idx;
 
 	TRACE ((_T("fsdb writeback %s\n"), dir->aname));
   /* First pass: clear dirty bits where unnecessary, and see if any work
@@ -332,6 +428,7 @@ void fsdb_dir_writeback (a_inode *dir)
     return;
   }
 
+	idx = get_index (dir);
 	f = get_fsdb (dir, _T("r+b"));
   if (f == 0) {
   	f = get_fsdb (dir, _T("w+b"));
@@ -341,41 +438,27 @@ void fsdb_dir_writeback (a_inode *dir)
 	    return;
     }
   }
-  fseek (f, 0, SEEK_END);
-  size = ftell (f);
-  fseek (f, 0, SEEK_SET);
-  tmpbuf = 0;
-  if (size > 0) {
-  	tmpbuf = (uae_u8 *)malloc (size);
-  	fread (tmpbuf, 1, size, f);
-  }
-	TRACE ((_T("**** updating '%s' %d\n"), dir->aname, size));
+	TRACE ((_T("**** updating '%s' %d\n"), dir->aname, index_count (idx)));
 
   for (aino = dir->child; aino; aino = aino->sibling) {
   	if (! aino->dirty)
 	    continue;
   	aino->dirty = 0;
 
-  	i = 0;
-  	while (!aino->has_dbentry && i < size) {
-			TCHAR *s = au ((char*)tmpbuf + i +  5);
-			if (!_tcscmp (s, aino->aname)) {
+		if (!aino->has_dbentry) {
+			std::unordered_map<std::string, int>::iterator it = idx->slot.find (aino->aname);
+			if (it != idx->slot.end ()) {
     		aino->has_dbentry = 1;
-    		aino->db_offset = i;
+    		aino->db_offset = it->second * FSDB_RECSIZE;
 	    }
-			xfree (s);
-	    i += 1 + 4 + 257 + 257 + 81;
 	  }
 
 	  if (! aino->has_dbentry) {
-	    fseek (f, 0, SEEK_END);
+	    aino->db_offset = index_count (idx) * FSDB_RECSIZE;
 	    aino->has_dbentry = 1;
-	  } else {
-	    fseek (f, aino->db_offset, SEEK_SET);
-    }
-	  write_aino (f, aino);
+	  }
+	  write_aino (f, idx, aino);
   }
 	TRACE ((_T("end\n")));
   fclose (f);
-  xfree (tmpbuf);
 }
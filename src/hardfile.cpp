@@ -425,14 +425,341 @@ int hdf_hd_open (struct hd_hardfiledata *hfd)
 static int hdf_write2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 static int hdf_read2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 
+/*
+ * Block cache shared by all hardfile units (uaehf.device, IDE and SCSI all
+ * end up in hdf_cache_read/hdf_cache_write). Blocks are keyed by hardfile
+ * and block number. Replacement is a segmented LRU: new blocks enter the
+ * probation list and only move to the protected list on a second hit, so a
+ * long sequential scan can not push out frequently used metadata blocks.
+ * Writes go through to the file and update blocks that are already cached.
+ */
+
+#define HDC_BLOCK_SHIFT 14
+#define HDC_BLOCK_SIZE (1 << HDC_BLOCK_SHIFT)
+#define HDC_PROTECTED_PERCENT 80
+#define HDC_NONE -1
+
+struct hdc_block {
+	struct hardfiledata *hfd;
+	uae_u64 block;
+	int hash_next;
+	int prev, next;
+	int list;
+};
+
+#define HDC_LIST_FREE 0
+#define HDC_LIST_PROBATION 1
+#define HDC_LIST_PROTECTED 2
+
+struct hdc_list {
+	int head, tail;
+	int count;
+};
+
+static struct hdc_block *hdc_blocks;
+static uae_u8 *hdc_data;
+static int *hdc_hash;
+static int hdc_hashmask;
+static int hdc_numblocks;
+static int hdc_size_mb;
+static struct hdc_list hdc_lists[3];
+static uae_sem_t hdc_sem = 0;
+static uae_u64 hdc_hits, hdc_misses, hdc_evictions, hdc_bypass;
+static unsigned int hdc_gen;	/* bumped whenever cached file data may change */
+
+static void hdc_unlink (int i)
+{
+	struct hdc_block *b = &hdc_blocks[i];
+	struct hdc_list *l = &hdc_lists[b->list];
+
+	if (b->prev != HDC_NONE)
+		hdc_blocks[b->prev].next = b->next;
+	else
+		l->head = b->next;
+	if (b->next != HDC_NONE)
+		hdc_blocks[b->next].prev = b->prev;
+	else
+		l->tail = b->prev;
+	l->count--;
+}
+
+static void hdc_push_head (int i, int list)
+{
+	struct hdc_block *b = &hdc_blocks[i];
+	struct hdc_list *l = &hdc_lists[list];
+
+	b->list = list;
+	b->prev = HDC_NONE;
+	b->next = l->head;
+	if (l->head != HDC_NONE)
+		hdc_blocks[l->head].prev = i;
+	l->head = i;
+	if (l->tail == HDC_NONE)
+		l->tail = i;
+	l->count++;
+}
+
+static int hdc_hashidx (struct hardfiledata *hfd, uae_u64 block)
+{
+	uae_u32 v = (uae_u32)block ^ (uae_u32)(block >> 32) ^ (uae_u32)(uintptr_t)hfd;
+	v ^= v >> 16;
+	v *= 0x45d9f3b;
+	v ^= v >> 16;
+	return v & hdc_hashmask;
+}
+
+static void hdc_hash_remove (int i)
+{
+	struct hdc_block *b = &hdc_blocks[i];
+	int *pp = &hdc_hash[hdc_hashidx (b->hfd, b->block)];
+
+	while (*pp != HDC_NONE) {
+		if (*pp == i) {
+			*pp = b->hash_next;
+			break;
+		}
+		pp = &hdc_blocks[*pp].hash_next;
+	}
+	b->hfd = NULL;
+}
+
+static int hdc_find (struct hardfiledata *hfd, uae_u64 block)
+{
+	int i = hdc_hash[hdc_hashidx (hfd, block)];
+
+	while (i != HDC_NONE) {
+		if (hdc_blocks[i].hfd == hfd && hdc_blocks[i].block == block)
+			return i;
+		i = hdc_blocks[i].hash_next;
+	}
+	return HDC_NONE;
+}
+
+static void hdc_touch (int i)
+{
+	hdc_unlink (i);
+	hdc_push_head (i, HDC_LIST_PROTECTED);
+	if (hdc_lists[HDC_LIST_PROTECTED].count > hdc_numblocks * HDC_PROTECTED_PERCENT / 100) {
+		int old = hdc_lists[HDC_LIST_PROTECTED].tail;
+		hdc_unlink (old);
+		hdc_push_head (old, HDC_LIST_PROBATION);
+	}
+}
+
+static int hdc_alloc (struct hardfiledata *hfd, uae_u64 block)
+{
+	int i = hdc_lists[HDC_LIST_FREE].head;
+	int h;
+
+	if (i == HDC_NONE) {
+		i = hdc_lists[HDC_LIST_PROBATION].tail;
+		if (i == HDC_NONE)
+			i = hdc_lists[HDC_LIST_PROTECTED].tail;
+		hdc_hash_remove (i);
+		hdc_evictions++;
+	}
+	hdc_unlink (i);
+	hdc_push_head (i, HDC_LIST_PROBATION);
+	h = hdc_hashidx (hfd, block);
+	hdc_blocks[i].hfd = hfd;
+	hdc_blocks[i].block = block;
+	hdc_blocks[i].hash_next = hdc_hash[h];
+	hdc_hash[h] = i;
+	return i;
+}
+
+static void hdc_log_stats (void)
+{
+	uae_u64 total = hdc_hits + hdc_misses;
+
+	if (!total)
+		return;
+	write_log (_T("HDF cache: %d KB, %llu hits, %llu misses (%d%%), %llu evictions, %llu bypassed\n"),
+		hdc_numblocks * (HDC_BLOCK_SIZE / 1024), hdc_hits, hdc_misses, (int)(hdc_hits * 100 / total),
+		hdc_evictions, hdc_bypass);
+}
+
+static void hdc_free (void)
+{
+	hdc_log_stats ();
+	xfree (hdc_blocks);
+	xfree (hdc_data);
+	xfree (hdc_hash);
+	hdc_blocks = NULL;
+	hdc_data = NULL;
+	hdc_hash = NULL;
+	hdc_numblocks = 0;
+	hdc_size_mb = 0;
+	hdc_hits = hdc_misses = hdc_evictions = hdc_bypass = 0;
+}
+
+/* Size the cache from the config, only while no unit is open */
+static void hdc_init (void)
+{
+	int i, hashsize;
+
+	if (hdc_sem == 0)
+		uae_sem_init (&hdc_sem, 0, 1);
+	if (hdc_size_mb == currprefs.harddrive_cache_size)
+		return;
+	uae_sem_wait (&hdc_sem);
+	hdc_free ();
+	if (currprefs.harddrive_cache_size > 0) {
+		hdc_numblocks = currprefs.harddrive_cache_size * ((1024 * 1024) / HDC_BLOCK_SIZE);
+		for (hashsize = 1; hashsize < hdc_numblocks * 2; hashsize <<= 1);
+		hdc_blocks = xcalloc (struct hdc_block, hdc_numblocks);
+		hdc_data = xmalloc (uae_u8, hdc_numblocks * HDC_BLOCK_SIZE);
+		hdc_hash = xmalloc (int, hashsize);
+		if (!hdc_blocks || !hdc_data || !hdc_hash) {
+			write_log (_T("HDF cache: failed to allocate %d MB\n"), currprefs.harddrive_cache_size);
+			hdc_free ();
+		} else {
+			hdc_hashmask = hashsize - 1;
+			for (i = 0; i < hashsize; i++)
+				hdc_hash[i] = HDC_NONE;
+			for (i = 0; i < 3; i++) {
+				hdc_lists[i].head = hdc_lists[i].tail = HDC_NONE;
+				hdc_lists[i].count = 0;
+			}
+			for (i = 0; i < hdc_numblocks; i++)
+				hdc_push_head (i, HDC_LIST_FREE);
+			hdc_size_mb = currprefs.harddrive_cache_size;
+		}
+	}
+	uae_sem_post (&hdc_sem);
+}
+
+/* Drop all blocks of one hardfile (open, close, media change) */
+static void hdc_invalidate (struct hardfiledata *hfd)
+{
+	int i;
+
+	if (!hdc_numblocks)
+		return;
+	uae_sem_wait (&hdc_sem);
+	hdc_gen++;
+	for (i = 0; i < hdc_numblocks; i++) {
+		if (hdc_blocks[i].list != HDC_LIST_FREE && hdc_blocks[i].hfd == hfd) {
+			hdc_hash_remove (i);
+			hdc_unlink (i);
+			hdc_push_head (i, HDC_LIST_FREE);
+		}
+	}
+	uae_sem_post (&hdc_sem);
+}
+
+static bool hdc_usable (struct hardfiledata *hfd, uae_u64 offset, int len)
+{
+	if (!hdc_numblocks || len <= 0 || hfd->drive_empty)
+		return false;
+	/* mapped hardfiles already copy straight from the page cache */
+	if (hdf_map_target (hfd, offset, len, false))
+		return false;
+	return true;
+}
+
 static int hdf_cache_read (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	return hdf_read2 (hfd, buffer, offset, len);
+	uae_u8 *p = (uae_u8*)buffer;
+	uae_u64 end = offset + len;
+	uae_u64 block, lastblock, missfirst;
+	unsigned int gen;
+	uae_u8 *tmp;
+
+	if (!hdc_usable (hfd, offset, len))
+		return hdf_read2 (hfd, buffer, offset, len);
+	lastblock = (end - 1) >> HDC_BLOCK_SHIFT;
+	/* only whole blocks inside the hardfile are cached */
+	if (((lastblock + 1) << HDC_BLOCK_SHIFT) > hfd->virtsize) {
+		uae_sem_wait (&hdc_sem);
+		hdc_bypass++;
+		uae_sem_post (&hdc_sem);
+		return hdf_read2 (hfd, buffer, offset, len);
+	}
+	block = offset >> HDC_BLOCK_SHIFT;
+	while (block <= lastblock) {
+		uae_sem_wait (&hdc_sem);
+		for (;;) {
+			int i = block <= lastblock ? hdc_find (hfd, block) : HDC_NONE;
+			if (i == HDC_NONE)
+				break;
+			uae_u64 bstart = block << HDC_BLOCK_SHIFT;
+			uae_u64 from = bstart > offset ? bstart : offset;
+			uae_u64 to = bstart + HDC_BLOCK_SIZE < end ? bstart + HDC_BLOCK_SIZE : end;
+			hdc_touch (i);
+			memcpy (p + (from - offset), hdc_data + (uae_u64)i * HDC_BLOCK_SIZE + (from - bstart), to - from);
+			hdc_hits++;
+			block++;
+		}
+		if (block > lastblock) {
+			uae_sem_post (&hdc_sem);
+			break;
+		}
+		/* coalesce the run of missing blocks into one target read */
+		missfirst = block;
+		while (block <= lastblock && hdc_find (hfd, block) == HDC_NONE)
+			block++;
+		gen = hdc_gen;
+		uae_sem_post (&hdc_sem);
+
+		/* Read without the lock, other units keep using the cache meanwhile */
+		int runlen = (int)((block - missfirst) << HDC_BLOCK_SHIFT);
+		tmp = xmalloc (uae_u8, runlen);
+		if (!tmp || hdf_read2 (hfd, tmp, missfirst << HDC_BLOCK_SHIFT, runlen) != runlen) {
+			xfree (tmp);
+			return hdf_read2 (hfd, buffer, offset, len);
+		}
+		uae_sem_wait (&hdc_sem);
+		for (uae_u64 b = missfirst; b < block; b++) {
+			uae_u8 *src = tmp + ((b - missfirst) << HDC_BLOCK_SHIFT);
+			uae_u64 bstart = b << HDC_BLOCK_SHIFT;
+			uae_u64 from = bstart > offset ? bstart : offset;
+			uae_u64 to = bstart + HDC_BLOCK_SIZE < end ? bstart + HDC_BLOCK_SIZE : end;
+			memcpy (p + (from - offset), src + (from - bstart), to - from);
+			hdc_misses++;
+			/* A write or invalidate in between may have made tmp stale,
+			   and another reader may have cached the block already. */
+			if (gen != hdc_gen || hdc_find (hfd, b) != HDC_NONE)
+				continue;
+			int i = hdc_alloc (hfd, b);
+			memcpy (hdc_data + (uae_u64)i * HDC_BLOCK_SIZE, src, HDC_BLOCK_SIZE);
+		}
+		uae_sem_post (&hdc_sem);
+		xfree (tmp);
+	}
+	return len;
 }
 
 static int hdf_cache_write (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	return hdf_write2 (hfd, buffer, offset, len);
+	uae_u8 *p = (uae_u8*)buffer;
+	uae_u64 end = offset + len;
+	uae_u64 block;
+	int v;
+
+	v = hdf_write2 (hfd, buffer, offset, len);
+	if (!hdc_numblocks || len <= 0)
+		return v;
+	uae_sem_wait (&hdc_sem);
+	hdc_gen++;
+	for (block = offset >> HDC_BLOCK_SHIFT; (block << HDC_BLOCK_SHIFT) < end; block++) {
+		int i = hdc_find (hfd, block);
+		if (i == HDC_NONE)
+			continue;
+		if (v != len) {
+			/* partial write: the file content is unknown, forget the block */
+			hdc_hash_remove (i);
+			hdc_unlink (i);
+			hdc_push_head (i, HDC_LIST_FREE);
+			continue;
+		}
+		uae_u64 bstart = block << HDC_BLOCK_SHIFT;
+		uae_u64 from = bstart > offset ? bstart : offset;
+		uae_u64 to = bstart + HDC_BLOCK_SIZE < end ? bstart + HDC_BLOCK_SIZE : end;
+		memcpy (hdc_data + (uae_u64)i * HDC_BLOCK_SIZE + (from - bstart), p + (from - offset), to - from);
+	}
+	uae_sem_post (&hdc_sem);
+	return v;
 }
 
 int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
@@ -446,6 +773,7 @@ int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
 	hfd->hfd_type = 0;
 	if (!pname)
 		pname = hfd->ci.rootdir;
+	hdc_invalidate (hfd);
 	ret = hdf_open_target (hfd, pname);
 	if (ret <= 0)
 		return ret;
@@ -459,6 +787,7 @@ int hdf_open (struct hardfiledata *hfd)
 
 void hdf_close (struct hardfiledata *hfd)
 {
+	hdc_invalidate (hfd);
 	hdf_close_target (hfd);
 	hfd->hfd_type = 0;
 }
@@ -573,6 +902,14 @@ int hdf_write (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 	return v;
 }
 
+/* Mapped hardfile data can go straight to/from Amiga memory unless it needs decoding */
+static uae_u8 *hdf_map (struct hardfiledata *hfd, uae_u64 offset, uae_u64 len, bool write)
+{
+	if (hfd->adide || hfd->byteswap)
+		return NULL;
+	return hdf_map_target (hfd, offset, (int)len, write);
+}
+
 static uae_u64 cmd_readx (struct hardfiledata *hfd, uae_u8 *dataptr, uae_u64 offset, uae_u64 len)
 {
 	gui_flicker_led (LED_HD, hfd->unitnum, 1);
@@ -589,6 +926,12 @@ static uae_u64 cmd_read(TrapContext *ctx, struct hardfiledata *hfd, uaecptr data
     uae_u8 *buffer = bank_data->xlateaddr (dataptr);
     return cmd_readx (hfd, buffer, offset, len);
 	}
+	uae_u8 *mapped = hdf_map (hfd, offset, len, false);
+	if (mapped) {
+		gui_flicker_led (LED_HD, hfd->unitnum, 1);
+		trap_put_bytes(ctx, mapped, dataptr, len);
+		return len;
+	}
 	int total = 0;
 	while (len > 0) {
 		uae_u8 buf[RTAREA_TRAP_DATA_EXTRA_SIZE];
@@ -621,6 +964,13 @@ static uae_u64 cmd_write(TrapContext *ctx, struct hardfiledata *hfd, uaecptr dat
     uae_u8 *buffer = bank_data->xlateaddr (dataptr);
     return cmd_writex (hfd, buffer, offset, len);
 	}
+	uae_u8 *mapped = hdf_map (hfd, offset, len, true);
+	if (mapped) {
+		gui_flicker_led (LED_HD, hfd->unitnum, 2);
+		trap_get_bytes(ctx, mapped, dataptr, len);
+		hdf_flush_target (hfd, offset, len, false);
+		return len;
+	}
 	int total = 0;
 	while (len > 0) {
 		uae_u8 buf[RTAREA_TRAP_DATA_EXTRA_SIZE];
@@ -1807,8 +2157,11 @@ static uae_u32 hardfile_do_io (TrapContext *ctx, struct hardfiledata *hfd, struc
     actual = hfd->drive_empty ? 1 :0;
   	break;
 
-	  /* Some commands that just do nothing and return zero */
 	case CMD_UPDATE:
+		hdf_flush_target (hfd, 0, 0, true);
+		break;
+
+	  /* Some commands that just do nothing and return zero */
 	case CMD_CLEAR:
 	case CMD_MOTOR:
 	case CMD_SEEK:
@@ -2044,6 +2397,7 @@ void hardfile_reset (void)
 
 	  memset (hfpd, 0, sizeof (struct hardfileprivdata));
   }
+	hdc_log_stats ();
 }
 
 void hardfile_install (void)
@@ -2057,6 +2411,7 @@ void hardfile_install (void)
     change_sem = 0;
   }
   uae_sem_init (&change_sem, 0, 1);
+	hdc_init ();
 
   ROM_hardfile_resname = ds (_T("uaehf.device"));
 	ROM_hardfile_resid = ds (_T("UAE hardfile.device 0.4"));
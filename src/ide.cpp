@@ -426,6 +426,7 @@ static void reset_device (struct ide_hdf *ide, bool both)
 
 void ide_reset_device(struct ide_hdf *ide)
 {
+	ide->pio_words = 0;
 	reset_device(ide, true);
 }
 
@@ -611,6 +612,67 @@ static void setbsy (struct ide_hdf *ide)
 	ide->regs.ide_status &= ~IDE_STATUS_DRQ;
 }
 
+/*
+ * Data port fast path. Once a word has gone through ide_get_data_2 or
+ * ide_put_data_2, the words up to the next block (or multiple block)
+ * boundary and the end of the transfer only move the buffer position, so
+ * ide_get_data and ide_put_data serve them straight from secbuf. The
+ * window is tied to data_offset: every transfer start resets it to 0,
+ * which ends the window. The last word before a boundary always takes
+ * the slow path, where the boundary work happens.
+ */
+#ifndef IDE_PIO_STATS
+#define IDE_PIO_STATS 0
+#endif
+
+#if IDE_PIO_STATS
+static uae_u32 pio_fast_words, pio_slow_words;
+static frame_time_t pio_start_time;
+#endif
+
+static void ide_pio_window(struct ide_hdf *ide, bool write)
+{
+	int chunk, lim;
+
+	ide->pio_words = 0;
+	if (IDE_LOG > 4 || ide->packet_state || ide->data_size <= 0 || ide->data_offset <= 0)
+		return;
+	chunk = ide->blocksize * ide->data_multi;
+	if (chunk <= 0)
+		return;
+	lim = chunk - ide->data_offset % chunk;
+	if (lim > ide->data_size)
+		lim = ide->data_size;
+	if (lim < 4)
+		return;
+	if (write)
+		ide_grow_buffer(ide, ide->packet_data_offset + ide->data_offset + lim);
+	ide->pio_words = lim / 2 - 1;
+	ide->pio_offset = ide->data_offset;
+	ide->pio_write = write;
+}
+
+static void ide_pio_start(struct ide_hdf *ide)
+{
+	ide->pio_words = 0;
+#if IDE_PIO_STATS
+	pio_fast_words = pio_slow_words = 0;
+	pio_start_time = read_processor_time ();
+#endif
+}
+
+static void ide_pio_done(struct ide_hdf *ide)
+{
+#if IDE_PIO_STATS
+	frame_time_t t = read_processor_time () - pio_start_time;
+	uae_u32 bytes = (pio_fast_words + pio_slow_words) * 2;
+	write_log (_T("IDE%d PIO %s %d bytes, %d%% fast path, %d us, %d KB/s\n"), ide->num,
+		ide->direction ? _T("write") : _T("read"), bytes,
+		bytes ? (int)((uae_u64)pio_fast_words * 200 / bytes) : 0, (int)t,
+		t > 0 ? (int)((uae_u64)bytes * 1000 / 1024 * 1000 / t) : 0);
+#endif
+}
+
 static void process_rw_command (struct ide_hdf *ide)
 {
 	setbsy (ide);
@@ -850,6 +912,7 @@ static void ide_read_sectors (struct ide_hdf *ide, int flags)
 	ide->data_size = nsec * ide->blocksize;
 	ide->direction = 0;
 	ide->buffer_offset = 0;
+	ide_pio_start(ide);
 	// read start: preload sector(s), then trigger interrupt.
 	process_rw_command (ide);
 }
@@ -888,6 +951,7 @@ static void ide_write_sectors (struct ide_hdf *ide, int flags)
 	ide->data_size = nsec * ide->blocksize;
 	ide->direction = 1;
 	ide->buffer_offset = 0;
+	ide_pio_start(ide);
 	// write start: set DRQ and clear BSY. No interrupt.
 	ide->regs.ide_status |= IDE_STATUS_DRQ;
 	ide->regs.ide_status &= ~IDE_STATUS_BSY;
@@ -982,6 +1046,10 @@ static uae_u16 ide_get_data_2(struct ide_hdf *ide, int bussize)
 	uae_u16 v;
 	int inc = bussize ? 2 : 1;
 
+	ide->pio_words = 0;
+#if IDE_PIO_STATS
+	pio_slow_words++;
+#endif
 	if (ide->data_size == 0) {
 		if (IDE_LOG > 0)
 			write_log (_T("IDE%d DATA but no data left!? %02X PC=%08X\n"), ide->num, ide->regs.ide_status, m68k_getpc ());
@@ -1042,6 +1110,9 @@ static uae_u16 ide_get_data_2(struct ide_hdf *ide, int bussize)
 			ide->regs.ide_status &= ~IDE_STATUS_DRQ;
 			if (IDE_LOG > 1)
 				write_log (_T("IDE%d read finished\n"), ide->num);
+			ide_pio_done(ide);
+		} else if (bussize) {
+			ide_pio_window(ide, false);
 		}
 	}
 	if (irq)
@@ -1051,6 +1122,17 @@ static uae_u16 ide_get_data_2(struct ide_hdf *ide, int bussize)
 
 uae_u16 ide_get_data(struct ide_hdf *ide)
 {
+	if (ide->pio_words > 0 && ide->data_offset == ide->pio_offset && !ide->pio_write) {
+		uae_u8 *p = ide->secbuf + ide->buffer_offset + ide->data_offset;
+		ide->pio_words--;
+		ide->pio_offset += 2;
+		ide->data_offset += 2;
+		ide->data_size -= 2;
+#if IDE_PIO_STATS
+		pio_fast_words++;
+#endif
+		return p[1] | (p[0] << 8);
+	}
 	return ide_get_data_2(ide, 1);
 }
 uae_u8 ide_get_data_8bit(struct ide_hdf *ide)
@@ -1061,6 +1143,11 @@ uae_u8 ide_get_data_8bit(struct ide_hdf *ide)
 static void ide_put_data_2(struct ide_hdf *ide, uae_u16 v, int bussize)
 {
 	int inc = bussize ? 2 : 1;
+
+	ide->pio_words = 0;
+#if IDE_PIO_STATS
+	pio_slow_words++;
+#endif
 	if (IDE_LOG > 4)
 		write_log (_T("IDE%d DATA write %04x %d/%d\n"), ide->num, v, ide->data_offset, ide->data_size);
 	if (ide->data_size == 0) {
@@ -1096,17 +1183,33 @@ static void ide_put_data_2(struct ide_hdf *ide, uae_u16 v, int bussize)
 		}
 	} else {
 		if (ide->data_size == 0) {
+			ide_pio_done(ide);
 			process_rw_command (ide);
 		} else if (((ide->data_offset % ide->blocksize) == 0) && ((ide->data_offset / ide->blocksize) % ide->data_multi) == 0) {
 			int off = ide->data_offset;
 			do_process_rw_command(ide);
 			ide->buffer_offset += off;
+		} else if (bussize) {
+			ide_pio_window(ide, true);
 		}
 	}
 }
 
 void ide_put_data(struct ide_hdf *ide, uae_u16 v)
 {
+	if (ide->pio_words > 0 && ide->data_offset == ide->pio_offset && ide->pio_write) {
+		uae_u8 *p = ide->secbuf + ide->buffer_offset + ide->data_offset;
+		p[0] = v >> 8;
+		p[1] = v & 0xff;
+		ide->pio_words--;
+		ide->pio_offset += 2;
+		ide->data_offset += 2;
+		ide->data_size -= 2;
+#if IDE_PIO_STATS
+		pio_fast_words++;
+#endif
+		return;
+	}
 	ide_put_data_2(ide, v, 1);
 }
 void ide_put_data_8bit(struct ide_hdf *ide, uae_u8 v)
@@ -1221,6 +1324,7 @@ void ide_write_reg (struct ide_hdf *ide, int ide_reg, uae_u32 val)
 	
 	ide->regs1->ide_devcon &= ~0x80; /* clear HOB */
 	ide->regs0->ide_devcon &= ~0x80; /* clear HOB */
+	ide->pio_words = 0;
 	if (IDE_LOG > 2 && ide_reg > 0 && (1 || ide->num > 0))
 		write_log (_T("IDE%d PUT register %d=%02X (%08X)\n"), ide->num, ide_reg, (uae_u32)val & 0xff, m68k_getpc ());
 
@@ -80,6 +80,8 @@ struct socketbase {
     uae_sem_t sem;		/* semaphore to notify the socket thread of work */
     uae_thread_id thread;	/* socket thread */
     int  sockabort[2];		/* pipe used to tell the thread to abort a select */
+    int epfd;			/* epoll set used by WaitSelect() */
+    struct bsd_epollset *epset;	/* sockets currently registered in epfd */
     int action;
     int s;			/* for accept */
     uae_u32 name;		/* For gethostbyname */
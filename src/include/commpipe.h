@@ -21,39 +21,55 @@ typedef union {
  * time, but it wouldn't be hard to use a "normal" pipe as an extension once the
  * user-level one gets full.
  * We queue up to chunks pieces of data before signalling the other thread to
- * avoid overhead. */
+ * avoid overhead.
+ *
+ * The ring is lock-free for any number of writers and one reader: each
+ * slot carries a sequence number which tells whether it is free for the
+ * writer claiming position n (seq == n) or holds data for the reader at
+ * position n (seq == n + 1). The semaphores are only used to park a
+ * reader on an empty pipe or a writer on a full one, after a short spin. */
+
+#define COMM_PIPE_SPIN 64
+
+typedef struct {
+  volatile uae_u32 seq;
+  uae_pt data;
+} smp_comm_slot;
 
 typedef struct {
-  uae_sem_t lock;
   uae_sem_t reader_wait;
   uae_sem_t writer_wait;
-  uae_pt *data;
+  smp_comm_slot *data;
   int size, chunks;
-  volatile int rdp, wrp;
+  uae_u32 mask;
+  volatile uae_u32 rdp, wrp;
   volatile int writer_waiting;
   volatile int reader_waiting;
 } smp_comm_pipe;
 
 STATIC_INLINE void init_comm_pipe (smp_comm_pipe *p, int size, int chunks)
 {
+  int i;
+
   memset (p, 0, sizeof (*p));
-  p->data = (uae_pt *)malloc (size*sizeof (uae_pt));
-  p->size = size;
+  /* Round up to a power of two so the free-running positions can wrap */
+  for (p->size = 2; p->size < size; p->size <<= 1);
+  p->mask = p->size - 1;
+  p->data = (smp_comm_slot *)malloc (p->size * sizeof (smp_comm_slot));
+  for (i = 0; i < p->size; i++)
+    p->data[i].seq = i;
   p->chunks = chunks;
   p->rdp = p->wrp = 0;
   p->reader_waiting = 0;
   p->writer_waiting = 0;
-  uae_sem_init (&p->lock, 0, 1);
   uae_sem_init (&p->reader_wait, 0, 0);
   uae_sem_init (&p->writer_wait, 0, 0);
 }
 
 STATIC_INLINE void destroy_comm_pipe (smp_comm_pipe *p)
 {
-  uae_sem_destroy (&p->lock);
   uae_sem_destroy (&p->reader_wait);
   uae_sem_destroy (&p->writer_wait);
-  p->lock = 0;
   p->reader_wait = 0;
   p->writer_wait = 0;
   if(p->size > 0 && p->data != NULL)
@@ -66,69 +82,92 @@ STATIC_INLINE void destroy_comm_pipe (smp_comm_pipe *p)
 
 STATIC_INLINE void maybe_wake_reader (smp_comm_pipe *p, int no_buffer)
 {
-  if (p->reader_waiting	&& (no_buffer || ((p->wrp - p->rdp + p->size) % p->size) >= p->chunks)) {
-    p->reader_waiting = 0;
-    uae_sem_post (&p->reader_wait);
+  __sync_synchronize ();
+  if (p->reader_waiting && (no_buffer || (int)(p->wrp - p->rdp) >= p->chunks)) {
+    if (__sync_bool_compare_and_swap (&p->reader_waiting, 1, 0))
+      uae_sem_post (&p->reader_wait);
   }
 }
 
 STATIC_INLINE void write_comm_pipe_pt (smp_comm_pipe *p, uae_pt data, int no_buffer)
 {
-  int nxwrp = (p->wrp + 1) % p->size;
-
-  if (p->reader_waiting) {
-	  /* No need to do all the locking */
-	  p->data[p->wrp] = data;
-	  p->wrp = nxwrp;
-	  maybe_wake_reader (p, no_buffer);
-	  return;
-  }
-    
-  uae_sem_wait (&p->lock);
-  if (nxwrp == p->rdp) {
-	  /* Pipe full! */
-	  p->writer_waiting = 1;
-	  uae_sem_post (&p->lock);
-	  /* Note that the reader could get in between here and do a
-	   * sem_post on writer_wait before we wait on it. That's harmless.
-	   * There's a similar case in read_comm_pipe_int_blocking. */
-	  uae_sem_wait (&p->writer_wait);
-	  uae_sem_wait (&p->lock);
+  smp_comm_slot *slot;
+  uae_u32 pos;
+  int spin = 0;
+
+  for (;;) {
+    pos = p->wrp;
+    slot = &p->data[pos & p->mask];
+    int diff = (int)(slot->seq - pos);
+    if (diff == 0) {
+      if (__sync_bool_compare_and_swap (&p->wrp, pos, pos + 1))
+        break;
+    } else if (diff < 0) {
+      /* Pipe full! */
+      if (spin++ < COMM_PIPE_SPIN)
+        continue;
+      __sync_fetch_and_add (&p->writer_waiting, 1);
+      __sync_synchronize ();
+      if ((int)(p->data[p->wrp & p->mask].seq - p->wrp) < 0) {
+        /* Any wakeup is only a hint, the loop checks again. */
+        uae_sem_wait (&p->writer_wait);
+      } else {
+        /* Reader freed a slot meanwhile; take our count back unless
+         * the reader already did (then there's a stray post, harmless) */
+        int w;
+        while ((w = p->writer_waiting) > 0 && !__sync_bool_compare_and_swap (&p->writer_waiting, w, w - 1));
+      }
+      spin = 0;
+    }
   }
-  p->data[p->wrp] = data;
-  p->wrp = nxwrp;
+  slot->data = data;
+  __sync_synchronize ();
+  slot->seq = pos + 1;
   maybe_wake_reader (p, no_buffer);
-  uae_sem_post (&p->lock);
+}
+
+STATIC_INLINE int comm_pipe_has_data (smp_comm_pipe *p)
+{
+  return p->data[p->rdp & p->mask].seq == p->rdp + 1;
 }
 
 STATIC_INLINE uae_pt read_comm_pipe_pt_blocking (smp_comm_pipe *p)
 {
   uae_pt data;
-
-  uae_sem_wait (&p->lock);
-  if (p->rdp == p->wrp) {
-	  p->reader_waiting = 1;
-	  uae_sem_post (&p->lock);
-	  uae_sem_wait (&p->reader_wait);
-	  uae_sem_wait (&p->lock);
+  smp_comm_slot *slot;
+  int spin = 0;
+
+  while (!comm_pipe_has_data (p)) {
+    if (spin++ < COMM_PIPE_SPIN)
+      continue;
+    p->reader_waiting = 1;
+    __sync_synchronize ();
+    if (comm_pipe_has_data (p)) {
+      p->reader_waiting = 0;
+      break;
+    }
+    /* A writer may post once more after we've left; that only
+     * costs a spurious pass through this loop later. */
+    uae_sem_wait (&p->reader_wait);
+    spin = 0;
   }
-  data = p->data[p->rdp];
-  p->rdp = (p->rdp + 1) % p->size;
+  __sync_synchronize ();
+  slot = &p->data[p->rdp & p->mask];
+  data = slot->data;
+  __sync_synchronize ();
+  slot->seq = p->rdp + p->size;
+  p->rdp++;
 
   /* We ignore chunks here. If this is a problem, make the size bigger in the init call. */
+  __sync_synchronize ();
   if (p->writer_waiting) {
-	  p->writer_waiting = 0;
-	  uae_sem_post (&p->writer_wait);
+    int w = p->writer_waiting;
+    if (w > 0 && __sync_bool_compare_and_swap (&p->writer_waiting, w, w - 1))
+      uae_sem_post (&p->writer_wait);
   }
-  uae_sem_post (&p->lock);
   return data;
 }
 
-STATIC_INLINE int comm_pipe_has_data (smp_comm_pipe *p)
-{
-  return p->rdp != p->wrp;
-}
-
 STATIC_INLINE int read_comm_pipe_int_blocking (smp_comm_pipe *p)
 {
   uae_pt foo = read_comm_pipe_pt_blocking (p);
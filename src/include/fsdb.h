@@ -111,6 +111,10 @@ typedef struct a_inode_struct {
   unsigned int mountcount;
 	uae_u64 uniq_external;
 	struct virtualfilesysobject *vfso;
+  /* Hash chains: by uniq, and by (parent, Amiga name) / (parent, host name).  */
+  struct a_inode_struct *uniq_next, *aname_next, *nname_next;
+  /* In-memory copy of this directory's database, see fsdb.cpp.  */
+	struct fsdb_index *fsdb_index;
 } a_inode;
 
 extern TCHAR *nname_begin (TCHAR *);
@@ -122,6 +126,7 @@ extern TCHAR *build_aname (const TCHAR *d, const TCHAR *n);
 extern void fsdb_clean_dir (a_inode *);
 extern TCHAR *fsdb_search_dir (const TCHAR *dirname, TCHAR *rel);
 extern void fsdb_dir_writeback (a_inode *);
+extern void fsdb_free_index (a_inode *);
 extern int fsdb_used_as_nname (a_inode *base, const TCHAR *);
 extern a_inode *fsdb_lookup_aino_aname (a_inode *base, const TCHAR *);
 extern a_inode *fsdb_lookup_aino_nname (a_inode *base, const TCHAR *);
@@ -97,6 +97,10 @@ struct ide_hdf
 	int packet_data_offset;
 	int packet_transfer_size;
 	struct scsi_data *scsi;
+
+	int pio_words; // data port words that can skip ide_get/put_data_2
+	int pio_offset; // data_offset the window continues from
+	bool pio_write;
 };
 
 struct ide_thread_state
@@ -382,6 +382,14 @@ extern addrbank *mem_banks[MEMORY_BANKS];
 
 #define get_mem_bank(addr) (*mem_banks[bankindex(addr)])
 
+/* Host address of each 64k segment that is plain RAM (read and write) or
+ * ROM (read only), NULL where the bank handlers have to be called. The
+ * tables follow mem_banks[] and are rebuilt by map_banks(). */
+extern uae_u8 *mem_read_direct[MEMORY_BANKS];
+extern uae_u8 *mem_write_direct[MEMORY_BANKS];
+
+extern void memory_direct_update (addrbank *bank);
+
 extern void memory_init (void);
 extern void memory_cleanup (void);
 extern void map_banks (addrbank *bank, int first, int count, int realsize);
@@ -408,18 +416,30 @@ extern bool read_kickstart_version(struct uae_prefs *p);
 
 STATIC_INLINE uae_u32 get_long(uaecptr addr)
 {
+  uae_u8 *m = mem_read_direct[bankindex(addr)];
+  if (m)
+    return do_get_mem_long ((uae_u32 *)(m + (addr & 0xffff)));
   return longget(addr);
 }
 STATIC_INLINE uae_u32 get_word(uaecptr addr)
 {
+  uae_u8 *m = mem_read_direct[bankindex(addr)];
+  if (m)
+    return do_get_mem_word ((uae_u16 *)(m + (addr & 0xffff)));
   return wordget(addr);
 }
 STATIC_INLINE uae_u32 get_byte(uaecptr addr)
 {
+  uae_u8 *m = mem_read_direct[bankindex(addr)];
+  if (m)
+    return m[addr & 0xffff];
   return byteget(addr);
 }
 STATIC_INLINE uae_u32 get_wordi(uaecptr addr)
 {
+  uae_u8 *m = mem_read_direct[bankindex(addr)];
+  if (m)
+    return do_get_mem_word ((uae_u16 *)(m + (addr & 0xffff)));
   return wordgeti(addr);
 }
 
@@ -480,14 +500,26 @@ STATIC_INLINE void *get_pointer (uaecptr addr)
 
 STATIC_INLINE void put_long(uaecptr addr, uae_u32 l)
 {
+  uae_u8 *m = mem_write_direct[bankindex(addr)];
+  if (m)
+    do_put_mem_long ((uae_u32 *)(m + (addr & 0xffff)), l);
+  else
     longput(addr, l);
 }
 STATIC_INLINE void put_word(uaecptr addr, uae_u32 w)
 {
+  uae_u8 *m = mem_write_direct[bankindex(addr)];
+  if (m)
+    do_put_mem_word ((uae_u16 *)(m + (addr & 0xffff)), w);
+  else
     wordput(addr, w);
 }
 STATIC_INLINE void put_byte(uaecptr addr, uae_u32 b)
 {
+  uae_u8 *m = mem_write_direct[bankindex(addr)];
+  if (m)
+    m[addr & 0xffff] = b;
+  else
     byteput(addr, b);
 }
 
@@ -364,6 +364,7 @@ struct uae_prefs {
   int fpu_model;
   bool cpu_compatible;
 	bool fpu_no_unimplemented;
+	bool fpu_fast;
   bool address_space_24;
   int picasso96_modeflags;
 
@@ -390,6 +391,9 @@ struct uae_prefs {
   struct floppyslot floppyslots[4];
 	bool floppy_read_only;
 	bool harddrive_read_only;
+	bool harddrive_mmap;
+	int harddrive_cache_size;
+	int harddrive_writeback;
 
   /* Target specific options */
   int pandora_vertical_offset;
@@ -2,6 +2,7 @@
 #define UAE_ROMMGR_H
 
 extern int decode_cloanto_rom_do (uae_u8 *mem, int size, int real_size);
+extern int decode_cloanto_rom_key (uae_u8 *mem, int size, int real_size, bool *cloanto);
 
 #define ROMTYPE_SUB_MASK    0x000000ff
 #define ROMTYPE_GROUP_MASK  0x003fff00
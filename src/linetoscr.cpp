@@ -3,6 +3,7 @@
  *    p_acolors contains 16-bit color information in both words
  */
 
+#ifdef CPU_arm
 STATIC_INLINE uae_u32 merge_words(uae_u32 val, uae_u32 val2)
 {
   __asm__ (
@@ -18,6 +19,17 @@ STATIC_INLINE uae_u32 double_word(uae_u32 val)
       : [o] "+r" (val) );
   return val;
 }
+#else
+STATIC_INLINE uae_u32 merge_words(uae_u32 val, uae_u32 val2)
+{
+  return (val & 0xffff) | (val2 << 16);
+}
+
+STATIC_INLINE uae_u32 double_word(uae_u32 val)
+{
+  return (val & 0xffff) | (val << 16);
+}
+#endif
  
 static int NOINLINE linetoscr_16 (int spix, int dpix, int dpix_end)
 {
@@ -1003,3 +1015,220 @@ static int NOINLINE linetoscr_16_shrink2_aga (int spix, int dpix, int dpix_end)
     return spix;
 }
 #endif
+
+/*
+ * Block converters. A span of the line is looked up into lts_line first
+ * (plain scalar gathers, none of our targets has a useful table gather),
+ * then narrowed, doubled or decimated into xlinebuffer with wide shuffles
+ * and stores. HAM spans skip the lookup and are shuffled straight out of
+ * ham_linebuf. The output is identical to the per-pixel converters above,
+ * which stay in use on CPUs without NEON (see linetoscr_vector).
+ */
+#define LTS_CHUNK 256
+
+static uae_u32 lts_line[LTS_CHUNK];
+
+STATIC_INLINE void lts_gather (uae_u32 *out, int spix, int step, int n, int aga, int stretch)
+{
+    int i;
+
+    if (!aga) {
+        if (bpldualpf) {
+            int *lookup = bpldualpfpri ? dblpf_ind2 : dblpf_ind1;
+            for (i = 0; i < n; i++, spix += step)
+                out[i] = p_acolors[lookup[pixdata.apixels[spix]]];
+        } else if (bplehb) {
+            for (i = 0; i < n; i++, spix += step) {
+                uae_u32 spix_val = pixdata.apixels[spix];
+                if (spix_val <= 31)
+                    out[i] = p_acolors[spix_val];
+                else
+                    out[i] = p_xcolors[(colors_for_drawing.color_regs_ecs[spix_val - 32] >> 1) & 0x777];
+            }
+        } else {
+            for (i = 0; i < n; i++, spix += step)
+                out[i] = p_acolors[pixdata.apixels[spix]];
+        }
+        return;
+    }
+#ifdef AGA
+    uae_u8 xor_val = bplxor;
+    uae_u8 and_val = bpland;
+    if (bpldualpf) {
+        int *lookup    = bpldualpfpri ? dblpf_ind2_aga : dblpf_ind1_aga;
+        int *lookup_no = bpldualpfpri ? dblpf_2nd2     : dblpf_2nd1;
+        uae_u8 ofs = dblpfofs[bpldualpf2of];
+        for (i = 0; i < n; i++, spix += step) {
+            if (spritepixels[spix]) {
+                out[i] = p_acolors[spritepixels[spix]];
+            } else {
+                uae_u32 spix_val = pixdata.apixels[spix];
+                uae_u8 val = lookup[spix_val];
+                if (lookup_no[spix_val])
+                    val += ofs;
+                val ^= xor_val;
+                out[i] = p_acolors[val];
+            }
+        }
+    } else if (bplehb) {
+        for (i = 0; i < n; i++, spix += step) {
+            uae_u32 spix_val = (pixdata.apixels[spix] ^ xor_val) & and_val;
+            if (spix_val >= 32 && spix_val < 64) {
+                unsigned int c = (colors_for_drawing.color_regs_aga[spix_val - 32] >> 1) & 0x7F7F7F;
+                out[i] = stretch ? CONVERT_RGB (c) : CONVERT_RGB_16 (c);
+            } else
+                out[i] = p_acolors[spix_val];
+        }
+    } else {
+        for (i = 0; i < n; i++, spix += step)
+            out[i] = p_acolors[(pixdata.apixels[spix] ^ xor_val) & and_val];
+    }
+#endif
+}
+
+/* dst[i] = low word of src[i] */
+STATIC_INLINE void lts_store16 (uae_u16 *dst, const uae_u32 *src, int n)
+{
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+        vst1q_u16 (dst, vcombine_u16 (vmovn_u32 (vld1q_u32 (src)), vmovn_u32 (vld1q_u32 (src + 4))));
+#endif
+    while (n-- > 0)
+        *dst++ = *src++;
+}
+
+/* dst[i] = src[i * step] */
+STATIC_INLINE void lts_ham_shrink (uae_u16 *dst, const uae_u16 *src, int step, int n)
+{
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+    /* n > 8 keeps the wide loads inside what the scalar loop reads */
+    if (step == 2) {
+        for (; n > 8; n -= 8, src += 16, dst += 8)
+            vst1q_u16 (dst, vld2q_u16 (src).val[0]);
+    } else if (step == 4) {
+        for (; n > 8; n -= 8, src += 32, dst += 8)
+            vst1q_u16 (dst, vld4q_u16 (src).val[0]);
+    }
+#endif
+    for (; n > 0; n--, src += step)
+        *dst++ = *src;
+}
+
+/* every HAM pixel twice */
+STATIC_INLINE void lts_ham_stretch (uae_u16 *dst, const uae_u16 *src, int n)
+{
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+    for (; n >= 8; n -= 8, src += 8, dst += 16) {
+        uint16x8_t v = vld1q_u16 (src);
+        uint16x8x2_t d = vzipq_u16 (v, v);
+        vst1q_u16 (dst, d.val[0]);
+        vst1q_u16 (dst + 8, d.val[1]);
+    }
+#endif
+    while (n-- > 0) {
+        *((uae_u32 *)dst) = double_word (*src++);
+        dst += 2;
+    }
+}
+
+/* res_shift 0 and the shrinking modes: one source pixel out of step per output pixel */
+STATIC_INLINE int lts_block (int spix, int dpix, int dpix_end, int step, int aga)
+{
+    uae_u16 *buf = (uae_u16 *) xlinebuffer;
+    int n = dpix_end - dpix;
+
+    /* the per-pixel versions always do their alignment pixel */
+    if (n <= 0)
+        n = (((uintptr_t)&buf[dpix]) & 2) ? 1 : 0;
+    if (bplham) {
+        if (step == 1)
+            memcpy (&buf[dpix], &ham_linebuf[spix], n * sizeof (uae_u16));
+        else
+            lts_ham_shrink (&buf[dpix], &ham_linebuf[spix], step, n);
+        return spix + n * step;
+    }
+    while (n > 0) {
+        int cnt = n > LTS_CHUNK ? LTS_CHUNK : n;
+        lts_gather (lts_line, spix, step, cnt, aga, 0);
+        lts_store16 (&buf[dpix], lts_line, cnt);
+        spix += cnt * step;
+        dpix += cnt;
+        n -= cnt;
+    }
+    return spix;
+}
+
+/* res_shift 1: every source pixel is written as one 32-bit pair */
+STATIC_INLINE int lts_block_stretch (int spix, int dpix, int dpix_end, int aga)
+{
+    uae_u16 *buf = (uae_u16 *) xlinebuffer;
+    int n = dpix < dpix_end ? (dpix_end - dpix + 1) / 2 : 0;
+
+    if (bplham) {
+        lts_ham_stretch (&buf[dpix], &ham_linebuf[spix], n);
+        return spix + n;
+    }
+    while (n > 0) {
+        int cnt = n > LTS_CHUNK ? LTS_CHUNK : n;
+        lts_gather (lts_line, spix, 1, cnt, aga, 1);
+        memcpy (&buf[dpix], lts_line, cnt * sizeof (uae_u32));
+        spix += cnt;
+        dpix += cnt * 2;
+        n -= cnt;
+    }
+    return spix;
+}
+
+static int NOINLINE linetoscr_16_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block (spix, dpix, dpix_end, 1, 0);
+}
+static int NOINLINE linetoscr_16_stretch1_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block_stretch (spix, dpix, dpix_end, 0);
+}
+static int NOINLINE linetoscr_16_shrink1_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block (spix, dpix, dpix_end, 2, 0);
+}
+#ifdef AGA
+static int NOINLINE linetoscr_16_aga_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block (spix, dpix, dpix_end, 1, 1);
+}
+static int NOINLINE linetoscr_16_stretch1_aga_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block_stretch (spix, dpix, dpix_end, 1);
+}
+static int NOINLINE linetoscr_16_shrink1_aga_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block (spix, dpix, dpix_end, 2, 1);
+}
+static int NOINLINE linetoscr_16_shrink2_aga_vec (int spix, int dpix, int dpix_end)
+{
+    return lts_block (spix, dpix, dpix_end, 4, 1);
+}
+#endif
+
+/* Use the block converters? Decided once from the CPU we run on. */
+static int linetoscr_vector (void)
+{
+    static int vector = -1;
+
+    if (vector < 0) {
+#if defined(USE_ARMNEON) && defined(__ARM_NEON__)
+#ifdef HWCAP_NEON
+        vector = (getauxval (AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+        vector = 1;
+#endif
+#elif defined(CPU_arm)
+        /* without NEON the pkhbt loops above are as good as it gets */
+        vector = 0;
+#else
+        vector = 1;
+#endif
+        write_log (_T("Line to screen: %s converters\n"), vector ? _T("block") : _T("per-pixel"));
+    }
+    return vector;
+}
@@ -45,6 +45,8 @@ static bool need_hardreset;
 static bool last_address_space_24;
 
 addrbank *mem_banks[MEMORY_BANKS];
+uae_u8 *mem_read_direct[MEMORY_BANKS];
+uae_u8 *mem_write_direct[MEMORY_BANKS];
 
 int addr_valid(const TCHAR *txt, uaecptr addr, uae_u32 len)
 {
@@ -885,6 +887,8 @@ void init_mem_banks (void)
 	// unsigned so i << 16 won't overflow to negative when i >= 32768
   for (unsigned int i = 0; i < MEMORY_BANKS; i++)
     mem_banks[i] = &dummy_bank;
+	memset (mem_read_direct, 0, sizeof mem_read_direct);
+	memset (mem_write_direct, 0, sizeof mem_write_direct);
 }
 
 static bool singlebit (uae_u32 v)
@@ -1341,6 +1345,8 @@ void memory_reset (void)
 	if (mem_hardreset) {
 		memory_clear ();
 	}
+	/* Banks may have been reallocated or resized after they were mapped */
+	memory_direct_update (NULL);
   write_log (_T("memory init end\n"));
 }
 
@@ -1398,6 +1404,7 @@ void memory_cleanup (void)
   chipmem_bank.baseaddr = NULL;
 	custmem1_bank.baseaddr = NULL;
 	custmem2_bank.baseaddr = NULL;
+	memory_direct_update (NULL);
   
 #ifdef ACTION_REPLAY
 	action_replay_cleanup();
@@ -1428,6 +1435,41 @@ void map_banks_cond (addrbank *bank, int start, int size, int realsize)
 	map_banks (bank, start, size, realsize);
 }
 
+/*
+ * Fill the direct access entries of one 64k segment. Only the plain
+ * memory banks qualify (their handlers do nothing but mask the address
+ * and access baseaddr), and only if the whole segment is backed by host
+ * memory, so the pointer gives exactly what the handler would.
+ */
+static void memory_direct_set (int bnr)
+{
+	addrbank *ab = mem_banks[bnr];
+	uae_u8 *m = NULL;
+
+	mem_read_direct[bnr] = mem_write_direct[bnr] = NULL;
+	if (!(ab->flags & ABFLAG_THREADSAFE) || !(ab->flags & (ABFLAG_RAM | ABFLAG_ROM)))
+		return;
+	if (ab->sub_banks || !ab->baseaddr || (ab->start & 0xffff) || (ab->mask & 0xffff) != 0xffff)
+		return;
+	uae_u32 offset = (((uae_u32)bnr << 16) - ab->start) & ab->mask;
+	if (offset + 0x10000 > ab->allocated_size)
+		return;
+	m = ab->baseaddr + offset;
+	mem_read_direct[bnr] = m;
+	/* ROM writes are ignored, Action Replay hooks chip writes */
+	if ((ab->flags & ABFLAG_RAM) && (ab != &chipmem_bank || chipmem_bank.lput == chipmem_lput))
+		mem_write_direct[bnr] = m;
+}
+
+/* Rebuild the direct access tables for bank, or for everything if NULL */
+void memory_direct_update (addrbank *bank)
+{
+  for (unsigned int i = 0; i < MEMORY_BANKS; i++) {
+		if (!bank || mem_banks[i] == bank)
+			memory_direct_set (i);
+	}
+}
+
 static void map_banks2 (addrbank *bank, int start, int size, int realsize, int quick)
 {
   int bnr;
@@ -1448,6 +1490,7 @@ static void map_banks2 (addrbank *bank, int start, int size, int realsize, int q
   if (start >= 0x100) {
     for (bnr = start; bnr < start + size; bnr++) {
       mem_banks[bnr] = bank;
+      memory_direct_set (bnr);
     }
     return;
   }
@@ -1460,6 +1503,7 @@ static void map_banks2 (addrbank *bank, int start, int size, int realsize, int q
   for (hioffs = 0; hioffs < endhioffs; hioffs += 0x100) {
     for (bnr = start; bnr < start + size; bnr++) {
       mem_banks[bnr + hioffs] = bank;
+      memory_direct_set (bnr + hioffs);
     }
   }
 }
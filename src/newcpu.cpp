@@ -415,6 +415,7 @@ static void prefs_changed_cpu (void)
 	}
   currprefs.address_space_24 = changed_prefs.address_space_24;
 	currprefs.fpu_no_unimplemented = changed_prefs.fpu_no_unimplemented;
+	currprefs.fpu_fast = changed_prefs.fpu_fast;
 }
 
 static int check_prefs_changed_cpu2(void)
@@ -428,6 +429,7 @@ static int check_prefs_changed_cpu2(void)
 	|| currprefs.cpu_model != changed_prefs.cpu_model
 	|| currprefs.fpu_model != changed_prefs.fpu_model
 	|| currprefs.fpu_no_unimplemented != changed_prefs.fpu_no_unimplemented
+	|| currprefs.fpu_fast != changed_prefs.fpu_fast
 	|| currprefs.cpu_compatible != changed_prefs.cpu_compatible) {
 			cpu_prefs_changed_flag |= 1;
   }
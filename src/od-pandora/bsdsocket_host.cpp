@@ -48,6 +48,8 @@ void bsdsock_fake_int_handler(void)
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #ifdef HAVE_SYS_FILIO_H
 # include <sys/filio.h>
@@ -60,6 +62,11 @@ void bsdsock_fake_int_handler(void)
 #include <signal.h>
 #include <arpa/inet.h>
 
+#include <map>
+#include <vector>
+#include <deque>
+#include <string>
+
 #define DEBUG_BSDSOCKET
 #ifdef DEBUG_BSDSOCKET
 #define DEBUG_LOG write_log
@@ -468,26 +475,6 @@ STATIC_INLINE void fd_zero (TrapContext *ctx, uae_u32 fdset, uae_u32 nfds)
   	trap_put_long(ctx, fdset, 0);
 }
 
-STATIC_INLINE int bsd_amigaside_FD_ISSET (TrapContext *ctx, int n, uae_u32 set)
-{
-  uae_u32 foo = trap_get_long(ctx, set + (n / 32));
-  if (foo & (1 << (n % 32)))
-		return 1;
-  return 0;
-}
-
-STATIC_INLINE void bsd_amigaside_FD_ZERO (TrapContext *ctx, uae_u32 set)
-{
-  trap_put_long(ctx, set, 0);
-  trap_put_long(ctx, set + 4, 0);
-}
-
-STATIC_INLINE void bsd_amigaside_FD_SET (TrapContext *ctx, int n, uae_u32 set)
-{
-  set = set + (n / 32);
-  trap_put_long(ctx, set, trap_get_long(ctx, set) | (1 << (n % 32)));
-}
-
 #ifdef DEBUG_BSDSOCKET
 static void printSockAddr (struct sockaddr_in *in)
 {
@@ -637,89 +624,210 @@ static void copyProtoent (TrapContext *ctx, SB, const struct protoent *p)
 
 
 
-uae_u32 bsdthr_WaitSelect (SB)
-{
-  fd_set sets [3];
-  int i, s, set, a_s, max;
-  uae_u32 a_set;
-  struct timeval tv;
-  int r;
-
-  DEBUG_LOG ("WaitSelect: %d 0x%x 0x%x 0x%x 0x%x 0x%x\n", sb->nfds, sb->sets [0], sb->sets [1], sb->sets [2], sb->timeout, sb->sigmp);
+/*
+ * WaitSelect() is backed by one epoll instance per socketbase. Descriptors
+ * stay registered between calls, so the usual loop of WaitSelect() on the
+ * same sockets only costs an epoll_wait() - the interest set is updated
+ * for descriptors whose mask changed, and there is no FD_SETSIZE limit.
+ * Registration is level-triggered because WaitSelect() has to report
+ * readiness that already existed before the call.
+ */
+struct bsd_epollset {
+  std::map<int, uae_u32> registered;	/* native socket -> epoll events */
+};
 
-  if (sb->timeout)
-  	DEBUG_LOG ("WaitSelect: timeout %d %d\n", trap_get_long (sb->context, sb->timeout), trap_get_long (sb->context, sb->timeout + 4));
+struct bsd_wsentry {
+  int sd;
+  int s;
+  uae_u32 events;
+};
 
-  FD_ZERO (&sets [0]);
-  FD_ZERO (&sets [1]);
-  FD_ZERO (&sets [2]);
+/* Must be called before s is closed, or the map outlives the descriptor */
+static void bsd_epoll_forget (SB, int s)
+{
+  if (sb->epset && sb->epset->registered.erase (s))
+    epoll_ctl (sb->epfd, EPOLL_CTL_DEL, s, NULL);
+}
 
-  /* Set up the abort socket */
-  FD_SET (sb->sockabort[0], &sets[0]);
-  FD_SET (sb->sockabort[0], &sets[2]);
-  max = sb->sockabort[0];
+/*
+ * Register s for the given events. The map can be out of date when a
+ * descriptor was closed behind our back and its number reused, so a MOD
+ * that finds nothing falls back to ADD and the other way round.
+ */
+static int bsd_epoll_set (SB, int s, uae_u32 events, bool known)
+{
+  struct epoll_event ev;
+
+  memset (&ev, 0, sizeof ev);
+  ev.events = events;
+  ev.data.fd = s;
+  if (known) {
+    if (epoll_ctl (sb->epfd, EPOLL_CTL_MOD, s, &ev) == 0)
+      return 0;
+    if (errno != ENOENT)
+      return -1;
+    return epoll_ctl (sb->epfd, EPOLL_CTL_ADD, s, &ev);
+  }
+  if (epoll_ctl (sb->epfd, EPOLL_CTL_ADD, s, &ev) == 0)
+    return 0;
+  if (errno != EEXIST)
+    return -1;
+  return epoll_ctl (sb->epfd, EPOLL_CTL_MOD, s, &ev);
+}
 
-  for (set = 0; set < 3; set++) {
-		if (sb->sets [set] != 0) {
-	    a_set = sb->sets [set];
-	    for (i = 0; i < sb->nfds; i++) {
-  			if (bsd_amigaside_FD_ISSET (sb->context, i, a_set)) {
-			    s = getsock (sb->context, sb, i + 1);
-			    DEBUG_LOG ("WaitSelect: AmigaSide %d set. NativeSide %d.\n", i, s);
-			    if (s == -1) {
-	  				write_log ("BSDSOCK: WaitSelect() called with invalid descriptor %d in set %d.\n", i, set);
-			    } else {
-		  			FD_SET (s, &sets [set]);
-			  		if (max < s) max = s;
-			    }
-			  }
-	    }
-		}
+static void bsd_epoll_sync (SB, std::map<int, uae_u32> &wanted)
+{
+  std::map<int, uae_u32> &reg = sb->epset->registered;
+  std::map<int, uae_u32>::iterator it;
+
+  for (it = reg.begin (); it != reg.end (); ) {
+    if (wanted.find (it->first) == wanted.end ()) {
+      /* ENOENT and EBADF only mean the socket is gone already */
+      if (epoll_ctl (sb->epfd, EPOLL_CTL_DEL, it->first, NULL) < 0 && errno != ENOENT && errno != EBADF)
+        write_log ("BSDSOCK: epoll DEL of %d failed, error %d.\n", it->first, errno);
+      reg.erase (it++);
+    } else
+      ++it;
+  }
+  for (it = wanted.begin (); it != wanted.end (); ++it) {
+    std::map<int, uae_u32>::iterator r = reg.find (it->first);
+    if (r != reg.end () && r->second == it->second)
+      continue;
+    if (bsd_epoll_set (sb, it->first, it->second, r != reg.end ()) < 0) {
+      /* Not watched, so try again on the next call */
+      write_log ("BSDSOCK: WaitSelect() can't watch socket %d, error %d.\n", it->first, errno);
+      if (r != reg.end ())
+        reg.erase (r);
+      continue;
+    }
+    reg[it->first] = it->second;
   }
+}
 
-  max++;
+uae_u32 bsdthr_WaitSelect (SB)
+{
+  static const uae_u32 set_events[3] = { EPOLLIN, EPOLLOUT, EPOLLPRI };
+  int nwords = (sb->nfds + 31) / 32;
+  std::vector<uae_u32> sets[3];
+  std::vector<bsd_wsentry> entries;
+  std::map<int, uae_u32> wanted;
+  std::vector<struct epoll_event> events;
+  int i, set, r, timeout = -1;
+  frame_time_t deadline = 0;
+
+  DEBUG_LOG ("WaitSelect: %d 0x%x 0x%x 0x%x 0x%x 0x%x\n", sb->nfds, sb->sets [0], sb->sets [1], sb->sets [2], sb->timeout, sb->sigmp);
 
   if (sb->timeout) {
-		tv.tv_sec  = trap_get_long (sb->context, sb->timeout);
-		tv.tv_usec = trap_get_long (sb->context, sb->timeout + 4);
+    uae_u32 secs = trap_get_long (sb->context, sb->timeout);
+    uae_u32 usecs = trap_get_long (sb->context, sb->timeout + 4);
+  	DEBUG_LOG ("WaitSelect: timeout %d %d\n", secs, usecs);
+    uae_u64 ms = (uae_u64)secs * 1000 + ((uae_u64)usecs + 999) / 1000;
+    timeout = ms > INT_MAX ? INT_MAX : (int)ms;
+    deadline = read_processor_time () + (frame_time_t)secs * 1000000 + usecs;
   }
 
-  DEBUG_LOG("Select going to select\n");
-  r = select (max, &sets [0], &sets [1], &sets [2], (sb->timeout == 0) ? NULL : &tv);
-  DEBUG_LOG("Select returns %d, errno is %d\n", r, errno);
-  if( r > 0 ) {
-		/* Socket told us to abort */
-		if (FD_ISSET (sb->sockabort[0], &sets[0])) {
-	    /* read from the pipe to reset it */
+  /* Fetch the Amiga side sets a longword at a time */
+  for (set = 0; set < 3; set++) {
+    sets [set].assign (nwords, 0);
+    if (sb->sets [set] != 0) {
+      for (i = 0; i < nwords; i++)
+        sets [set][i] = trap_get_long (sb->context, sb->sets [set] + i * 4);
+    }
+  }
+
+  for (i = 0; i < sb->nfds; i++) {
+    uae_u32 ev = 0;
+    for (set = 0; set < 3; set++) {
+      if (sets [set][i / 32] & (1 << (i % 32)))
+        ev |= set_events [set];
+    }
+    if (!ev)
+      continue;
+    int s = getsock (sb->context, sb, i + 1);
+    DEBUG_LOG ("WaitSelect: AmigaSide %d set. NativeSide %d.\n", i, s);
+    if (s == -1) {
+			write_log ("BSDSOCK: WaitSelect() called with invalid descriptor %d.\n", i);
+      continue;
+    }
+    bsd_wsentry e = { i, s, ev };
+    entries.push_back (e);
+    wanted[s] |= ev;
+  }
+  bsd_epoll_sync (sb, wanted);
+  events.resize (wanted.size () + 1);
+
+  for (set = 0; set < 3; set++)
+    sets [set].assign (nwords, 0);
+
+  for (;;) {
+    int abort = 0, n;
+    std::map<int, uae_u32> ready;
+
+    DEBUG_LOG("Select going to epoll_wait\n");
+    n = epoll_wait (sb->epfd, &events [0], events.size (), timeout);
+    DEBUG_LOG("epoll_wait returns %d, errno is %d\n", n, errno);
+    if (n < 0) {
+      r = -1;
+      break;
+    }
+    for (i = 0; i < n; i++) {
+      if (events [i].data.fd == sb->sockabort[0])
+        abort = 1;
+      else
+        ready[events [i].data.fd] |= events [i].events;
+    }
+    if (abort) {
+      /* Socket told us to abort */
 	    DEBUG_LOG ("WaitSelect aborted from signal\n");
-	    r = 0;
-	    for (set = 0; set < 3; set++)
-		    if (sb->sets [set] != 0)
-    			bsd_amigaside_FD_ZERO (sb->context, sb->sets [set]);
 	    clearsockabort (sb);
-		}
-  	else
-  		/* This is perhaps slightly inefficient, but I don't care.. */
-  		for (set = 0; set < 3; set++) {
-		    a_set = sb->sets [set];
-		    if (a_set != 0) {
-  				bsd_amigaside_FD_ZERO (sb->context, a_set);
-	  			for (i = 0; i < sb->nfds; i++) {
-				    a_s = getsock (sb->context, sb, i + 1);
-				    if (a_s != -1) {
-		  				if (FD_ISSET (a_s, &sets [set])) {
-			  				DEBUG_LOG ("WaitSelect: NativeSide %d set. AmigaSide %d.\n", a_s, i);
-
-				  			bsd_amigaside_FD_SET (sb->context, i, a_set);
-					    }
-					  }
-				  }
-			  }
-		  }
-  } else if (r == 0) {         /* Timeout. I think we're supposed to clear the sets.. */
-		for (set = 0; set < 3; set++)
-	    if (sb->sets [set] != 0)
-    		bsd_amigaside_FD_ZERO (sb->context, sb->sets [set]);
+      r = 0;
+      break;
+    }
+
+    r = 0;
+    for (i = 0; i < entries.size (); i++) {
+      std::map<int, uae_u32>::iterator it = ready.find (entries [i].s);
+      if (it == ready.end ())
+        continue;
+      uae_u32 got = it->second;
+      /* select() reports errors and hangups as readable/writable */
+      if (got & (EPOLLERR | EPOLLHUP))
+        got |= EPOLLIN | EPOLLOUT;
+      for (set = 0; set < 3; set++) {
+        if ((entries [i].events & set_events [set]) && (got & set_events [set])) {
+          DEBUG_LOG ("WaitSelect: NativeSide %d set. AmigaSide %d.\n", entries [i].s, entries [i].sd);
+          sets [set][entries [i].sd / 32] |= 1 << (entries [i].sd % 32);
+          it->second |= 0x80000000;
+          r++;
+        }
+      }
+    }
+    if (r > 0 || n == 0)
+      break;
+    /* Only events nobody asked for (a hangup on a socket that is only
+     * in the exception set). Stop watching those sockets for the rest
+     * of this call, so a level-triggered hangup can't spin us, and wait
+     * for the remaining timeout. */
+    for (std::map<int, uae_u32>::iterator it = ready.begin (); it != ready.end (); ++it) {
+      if (!(it->second & 0x80000000))
+        bsd_epoll_forget (sb, it->first);
+    }
+    if (sb->timeout) {
+      frame_time_t now = read_processor_time ();
+      if ((long)(deadline - now) <= 0)
+        break;
+      timeout = (deadline - now + 999) / 1000;
+    }
+  }
+
+  /* Write back the results; on timeout or abort this clears the sets */
+  if (r >= 0) {
+    for (set = 0; set < 3; set++) {
+      if (sb->sets [set] != 0) {
+        for (i = 0; i < nwords; i++)
+          trap_put_long (sb->context, sb->sets [set] + i * 4, sets [set][i]);
+      }
+    }
   }
   DEBUG_LOG ("WaitSelect: r=%d errno=%d\n", r, errno);
   return r;
@@ -832,31 +940,31 @@ uae_u32 bsdthr_blockingstuff (uae_u32 (*tryfunc)(SB), SB)
 	  foo = tryfunc (sb);
 	  if (foo < 0 && !nonblock) {
 	    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINPROGRESS)) {
-    		fd_set readset, writeset, exceptset;
-    		int maxfd = (sb->s > sb->sockabort[0]) ? sb->s : sb->sockabort[0];
+    		struct pollfd fds[2];
     		int num;
-    
-    		FD_ZERO (&readset);
-    		FD_ZERO (&writeset);
-    		FD_ZERO (&exceptset);
 
+    		fds[0].fd = sb->s;
+    		fds[0].events = 0;
+    		fds[0].revents = 0;
     		if (sb->action == 3 || sb->action == 6)
-		      FD_SET (sb->s, &readset);
+		      fds[0].events |= POLLIN;
 		    if (sb->action == 2 || sb->action == 1 || sb->action == 4)
-		      FD_SET (sb->s, &writeset);
-		    FD_SET (sb->sockabort[0], &readset);
+		      fds[0].events |= POLLOUT;
+    		fds[1].fd = sb->sockabort[0];
+    		fds[1].events = POLLIN;
+    		fds[1].revents = 0;
 
-    		num = select (maxfd + 1, &readset, &writeset, &exceptset, NULL);
+    		num = poll (fds, 2, -1);
 		    if (num == -1) {
-		      DEBUG_LOG ("Blocking select(%d) returns -1,errno is %d\n", sb->sockabort[0],errno);
+		      DEBUG_LOG ("Blocking poll(%d) returns -1,errno is %d\n", sb->sockabort[0],errno);
 		      fcntl (sb->s, F_SETFL, flags);
 		      return -1;
     		}
 
-    		if (FD_ISSET (sb->sockabort[0], &readset) || FD_ISSET (sb->sockabort[0], &writeset)) {
+    		if (fds[1].revents) {
 		      /* reset sock abort pipe */
 		      /* read from the pipe to reset it */
-		      DEBUG_LOG ("select aborted from signal\n");
+		      DEBUG_LOG ("poll aborted from signal\n");
 
   		    clearsockabort (sb);
 	  	    DEBUG_LOG ("Done read\n");
@@ -874,6 +982,260 @@ uae_u32 bsdthr_blockingstuff (uae_u32 (*tryfunc)(SB), SB)
 }
 
 
+/*
+ * Host name resolution runs on a small pool of resolver threads, so the
+ * socket thread can keep watching its abort pipe and give up after
+ * BSD_RESOLVE_TIMEOUT instead of sitting in gethostbyname() for as long
+ * as the host resolver likes. Answers (including failures) are kept in a
+ * small cache for a while. The lookups use the reentrant glibc calls, so
+ * they honour /etc/hosts and nsswitch.conf like gethostbyname() did.
+ */
+#define BSD_RESOLVE_THREADS 2
+#define BSD_RESOLVE_TIMEOUT 10000	/* ms until the guest gets TRY_AGAIN */
+#define BSD_RESOLVE_TTL 300		/* seconds to keep a positive answer */
+#define BSD_RESOLVE_NEG_TTL 30		/* seconds to keep a negative answer */
+#define BSD_RESOLVE_CACHE_SIZE 64
+
+struct bsd_hostent {
+  std::string name;
+  std::vector<std::string> aliases;
+  std::vector<std::string> addrs;
+  int addrtype;
+  int length;
+};
+
+struct bsd_resolve_job {
+  std::string key;
+  std::string query;	/* name, or raw address for reverse lookups */
+  int addrtype;		/* -1 for a name lookup */
+  int refcnt;
+  int done;
+  int herrno;
+  bsd_hostent result;
+  int pipe[2];		/* written once the job is done */
+};
+
+struct bsd_resolve_cacheent {
+  int herrno;
+  bsd_hostent he;
+  time_t expires;
+};
+
+static uae_sem_t resolve_lock = 0;
+static uae_sem_t resolve_queue_sem;
+static std::deque<bsd_resolve_job*> resolve_queue;
+static std::map<std::string, bsd_resolve_cacheent> resolve_cache;
+static int resolve_threads;
+
+static void bsd_hostent_copy (bsd_hostent *dst, const struct hostent *src)
+{
+  int i;
+
+  dst->name = src->h_name ? src->h_name : "";
+  dst->addrtype = src->h_addrtype;
+  dst->length = src->h_length;
+  dst->aliases.clear ();
+  dst->addrs.clear ();
+  for (i = 0; src->h_aliases && src->h_aliases[i]; i++)
+    dst->aliases.push_back (src->h_aliases[i]);
+  for (i = 0; src->h_addr_list && src->h_addr_list[i]; i++)
+    dst->addrs.push_back (std::string (src->h_addr_list[i], src->h_length));
+}
+
+/* Must be called with resolve_lock held */
+static void bsd_resolve_release (bsd_resolve_job *job)
+{
+  if (--job->refcnt == 0) {
+    close (job->pipe[0]);
+    close (job->pipe[1]);
+    delete job;
+  }
+}
+
+/* Must be called with resolve_lock held */
+static void bsd_resolve_cache_put (const std::string &key, int herrno, const bsd_hostent &he)
+{
+  time_t now = time (NULL);
+  std::map<std::string, bsd_resolve_cacheent>::iterator it, oldest;
+
+  if (resolve_cache.size () >= BSD_RESOLVE_CACHE_SIZE && resolve_cache.find (key) == resolve_cache.end ()) {
+    oldest = resolve_cache.begin ();
+    for (it = resolve_cache.begin (); it != resolve_cache.end (); ) {
+      if (it->second.expires <= now) {
+        resolve_cache.erase (it++);
+        continue;
+      }
+      if (it->second.expires < oldest->second.expires)
+        oldest = it;
+      ++it;
+    }
+    if (resolve_cache.size () >= BSD_RESOLVE_CACHE_SIZE)
+      resolve_cache.erase (oldest);
+  }
+  bsd_resolve_cacheent &e = resolve_cache[key];
+  e.herrno = herrno;
+  e.he = he;
+  e.expires = now + (herrno ? BSD_RESOLVE_NEG_TTL : BSD_RESOLVE_TTL);
+}
+
+static void *bsd_resolve_thread (void *arg)
+{
+  for (;;) {
+    struct hostent hbuf, *res = NULL;
+    std::vector<char> buf (1024);
+    bsd_resolve_job *job;
+    int err, herr = 0;
+
+    uae_sem_wait (&resolve_queue_sem);
+    uae_sem_wait (&resolve_lock);
+    job = resolve_queue.front ();
+    resolve_queue.pop_front ();
+    uae_sem_post (&resolve_lock);
+
+    for (;;) {
+      if (job->addrtype == -1)
+        err = gethostbyname_r (job->query.c_str (), &hbuf, &buf[0], buf.size (), &res, &herr);
+      else
+        err = gethostbyaddr_r (job->query.data (), job->query.size (), job->addrtype, &hbuf, &buf[0], buf.size (), &res, &herr);
+      if (err != ERANGE || buf.size () >= 65536)
+        break;
+      buf.resize (buf.size () * 2);
+    }
+
+    uae_sem_wait (&resolve_lock);
+    if (res) {
+      bsd_hostent_copy (&job->result, res);
+      job->herrno = 0;
+    } else {
+      job->herrno = herr ? herr : NO_RECOVERY;
+    }
+    /* Don't remember transient failures */
+    if (job->herrno != TRY_AGAIN)
+      bsd_resolve_cache_put (job->key, job->herrno, job->result);
+    job->done = 1;
+    write (job->pipe[1], "", 1);
+    bsd_resolve_release (job);
+    uae_sem_post (&resolve_lock);
+  }
+  return NULL;
+}
+
+/*
+ * Resolve on behalf of the socket thread. Returns the h_errno value and
+ * fills in *he on success.
+ */
+static int bsd_resolve (SB, const std::string &query, int addrtype, bsd_hostent *he)
+{
+  std::string key;
+  bsd_resolve_job *job;
+  struct pollfd fds[2];
+  int herrno, r;
+
+  if (addrtype == -1) {
+    key = "N";
+    for (int i = 0; i < query.size (); i++)
+      key += tolower (query[i]);
+  } else {
+    char tmp[8];
+    key = "A";
+    sprintf (tmp, "%d:", addrtype);
+    key += tmp;
+    key += query;
+  }
+
+  uae_sem_wait (&resolve_lock);
+  std::map<std::string, bsd_resolve_cacheent>::iterator it = resolve_cache.find (key);
+  if (it != resolve_cache.end ()) {
+    if (it->second.expires > time (NULL)) {
+      herrno = it->second.herrno;
+      *he = it->second.he;
+      uae_sem_post (&resolve_lock);
+      DEBUG_LOG ("Resolver: cached answer for '%s'\n", addrtype == -1 ? query.c_str () : "<addr>");
+      return herrno;
+    }
+    resolve_cache.erase (it);
+  }
+
+  job = new bsd_resolve_job;
+  if (pipe (job->pipe) < 0) {
+    uae_sem_post (&resolve_lock);
+    delete job;
+    return NO_RECOVERY;
+  }
+  job->key = key;
+  job->query = query;
+  job->addrtype = addrtype;
+  job->refcnt = 2;
+  job->done = 0;
+  job->herrno = 0;
+  if (resolve_threads < BSD_RESOLVE_THREADS && resolve_queue.size () >= resolve_threads) {
+    if (uae_start_thread ("bsdresolve", bsd_resolve_thread, NULL, NULL) != BAD_THREAD)
+      resolve_threads++;
+  }
+  resolve_queue.push_back (job);
+  uae_sem_post (&resolve_lock);
+  uae_sem_post (&resolve_queue_sem);
+
+  fds[0].fd = job->pipe[0];
+  fds[0].events = POLLIN;
+  fds[1].fd = sb->sockabort[0];
+  fds[1].events = POLLIN;
+  do {
+    fds[0].revents = fds[1].revents = 0;
+    r = poll (fds, 2, BSD_RESOLVE_TIMEOUT);
+  } while (r < 0 && errno == EINTR);
+
+  uae_sem_wait (&resolve_lock);
+  if (job->done) {
+    herrno = job->herrno;
+    *he = job->result;
+  } else {
+    /* Timed out or aborted; the resolver thread finishes the job
+     * on its own and the answer still lands in the cache. */
+    if (fds[1].revents)
+      clearsockabort (sb);
+    write_log ("BSDSOCK: host lookup %s\n", r == 0 ? "timed out" : "aborted");
+    herrno = TRY_AGAIN;
+  }
+  bsd_resolve_release (job);
+  uae_sem_post (&resolve_lock);
+  return herrno;
+}
+
+static void bsdthr_gethost (SB)
+{
+  bsd_hostent he;
+  std::string query;
+  int herrno;
+
+  if (sb->action == 4)
+    query = reinterpret_cast<char *>(get_real_address (sb->name));
+  else
+    query.assign (reinterpret_cast<const char *>(get_real_address (sb->name)), sb->a_addrlen);
+  herrno = bsd_resolve (sb, query, sb->action == 4 ? -1 : sb->flags, &he);
+
+  if (herrno == 0) {
+    struct hostent h;
+    std::vector<char*> aliases, addrs;
+    for (int i = 0; i < he.aliases.size (); i++)
+      aliases.push_back (const_cast<char*>(he.aliases[i].c_str ()));
+    aliases.push_back (NULL);
+    for (int i = 0; i < he.addrs.size (); i++)
+      addrs.push_back (const_cast<char*>(he.addrs[i].data ()));
+    addrs.push_back (NULL);
+    h.h_name = const_cast<char*>(he.name.c_str ());
+    h.h_aliases = &aliases[0];
+    h.h_addrtype = he.addrtype;
+    h.h_length = he.length;
+    h.h_addr_list = &addrs[0];
+    copyHostent (&h, sb);
+    bsdsocklib_setherrno (sb->context, sb, 0);
+  } else {
+    bsdsocklib_setherrno (sb->context, sb, herrno);
+  }
+}
+
+
 static void *bsdlib_threadfunc (void *arg)
 {
   struct socketbase *sb = static_cast<struct socketbase *>(arg);
@@ -906,16 +1268,9 @@ static void *bsdlib_threadfunc (void *arg)
 		    break;
 
 	    case 4:       /* Gethostbyname */
-        {
-    		  struct hostent *tmphostent = gethostbyname (reinterpret_cast<char *>(get_real_address(sb->name)));
-    		  if (tmphostent) {
-  		      copyHostent (tmphostent, sb);
-  		      bsdsocklib_setherrno (ctx, sb, 0);
-    		  } else
-  		      SETHERRNO;
-
-    		  break;
-	      }
+	    case 7:       /* Gethostbyaddr */
+    		bsdthr_gethost (sb);
+    		break;
 
 	    case 5:       /* WaitSelect */
     		sb->resultval = bsdthr_WaitSelect (sb);
@@ -924,19 +1279,6 @@ static void *bsdlib_threadfunc (void *arg)
 	    case 6:       /* Accept */
     		sb->resultval = bsdthr_SendRecvAcceptConnect (bsdthr_Accept_2, sb);
 		    break;
-
-	    case 7: 
-        {
-      		struct hostent *tmphostent = gethostbyaddr (reinterpret_cast<const char*>(get_real_address(sb->name)), sb->a_addrlen, sb->flags);
-
-		      if (tmphostent) {
-		        copyHostent (tmphostent, sb);
-		        bsdsocklib_setherrno (ctx, sb, 0);
-		      } else
-		        SETHERRNO;
-
-      		break;
-	      }
   	}
 	  SETERRNO;
 	  SETSIGNAL;
@@ -1424,10 +1766,29 @@ int host_sbinit (TrapContext *ctx, SB)
     write_log ("Set nonblock failed %d\n", errno);
   }
 
+  sb->epfd = epoll_create (16);
+  if (sb->epfd < 0) {
+		write_log ("BSDSOCK: Failed to create epoll set %d.\n", errno);
+		close (sb->sockabort[0]);
+		close (sb->sockabort[1]);
+		return 0;
+  } else {
+    /* The abort pipe stays in the set for the socketbase's lifetime */
+    struct epoll_event ev;
+    memset (&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = sb->sockabort[0];
+    epoll_ctl (sb->epfd, EPOLL_CTL_ADD, sb->sockabort[0], &ev);
+  }
+  sb->epset = new bsd_epollset;
+
   if (uae_sem_init (&sb->sem, 0, 0)) {
 		write_log ("BSDSOCK: Failed to create semaphore.\n");
 		close (sb->sockabort[0]);
 		close (sb->sockabort[1]);
+		close (sb->epfd);
+		delete sb->epset;
+		sb->epset = NULL;
 		return 0;
   }
 
@@ -1441,6 +1802,9 @@ int host_sbinit (TrapContext *ctx, SB)
 		uae_sem_destroy (&sb->sem);
 		close (sb->sockabort[0]);
 		close (sb->sockabort[1]);
+		close (sb->epfd);
+		delete sb->epset;
+		sb->epset = NULL;
 		return 0;
   }
   return 1;
@@ -1472,6 +1836,13 @@ void host_sbcleanup (SB)
    * pthreads, it always creates joinable threads - and we can't do anything
    * about that. */
   uae_wait_thread (thread);
+
+  /* The dtable sockets were closed above while the thread could still be
+   * in WaitSelect(), so they were not forgotten one by one; the epoll set
+   * and its map go away as a whole instead. */
+  close (sb->epfd);
+  delete sb->epset;
+  sb->epset = NULL;
 }
 
 void host_sbreset (void)
@@ -1556,6 +1927,7 @@ int host_dup2socket (TrapContext *ctx, SB, int fd1, int fd2)
 	    fd2++;
 	    s2 = getsock (ctx, sb, fd2);
 	    if (s2 != -1) {
+				bsd_epoll_forget (sb, s2);
 				close (s2);
 	    }
 	    setsd (ctx, sb, fd2, dup (s1));
@@ -1699,6 +2071,7 @@ int host_CloseSocket (TrapContext *ctx, SB, int sd)
   }
   */
   DEBUG_LOG ("CloseSocket Amiga: %d, NativeSide %d\n", sd, s);
+  bsd_epoll_forget (sb, s);
   retval = close (s);
   SETERRNO;
   releasesock (ctx, sb, sd + 1);
@@ -1739,6 +2112,11 @@ int init_socket_layer(void)
   		DEBUG_LOG("Can't create sem %d\n", errno);
   		return 0;
     }
+    /* The resolver threads outlive a reset, so are their locks */
+    if (resolve_lock == 0) {
+      uae_sem_init (&resolve_lock, 0, 1);
+      uae_sem_init (&resolve_queue_sem, 0, 0);
+    }
     result = 1;
   }
 
@@ -33,6 +33,7 @@ static gcn::UaeRadioButton* optFPU68882;
 static gcn::UaeRadioButton* optFPUinternal;
 static gcn::UaeCheckBox* chkFPUstrict;
 static gcn::UaeCheckBox* chkFPUJIT;
+static gcn::UaeCheckBox* chkFPUfast;
 static gcn::Window *grpCPUSpeed;
 static gcn::UaeRadioButton* opt7Mhz;
 static gcn::UaeRadioButton* opt14Mhz;
@@ -200,6 +201,8 @@ class FPUActionListener : public gcn::ActionListener
     {
       if (actionEvent.getSource() == chkFPUstrict) {
         changed_prefs.fpu_strict = chkFPUstrict->isSelected();
+      } else if (actionEvent.getSource() == chkFPUfast) {
+        changed_prefs.fpu_fast = chkFPUfast->isSelected();
       }
       RefreshPanelCPU();
     }
@@ -277,6 +280,10 @@ void InitPanelCPU(const struct _ConfigCategory& category)
 	chkFPUJIT->setId("FPUJIT");
   chkFPUJIT->addActionListener(jitActionListener);
 
+	chkFPUfast = new gcn::UaeCheckBox("Fast FPU", true);
+	chkFPUfast->setId("FPUfast");
+  chkFPUfast->addActionListener(fpuActionListener);
+
 	grpFPU = new gcn::Window("FPU");
 	grpFPU->setPosition(DISTANCE_BORDER + grpCPU->getWidth() + DISTANCE_NEXT_X, DISTANCE_BORDER);
 	grpFPU->add(optFPUnone,  5, 10);
@@ -285,8 +292,9 @@ void InitPanelCPU(const struct _ConfigCategory& category)
 	grpFPU->add(optFPUinternal, 5, 100);
 	grpFPU->add(chkFPUstrict, 5, 140);
 	grpFPU->add(chkFPUJIT, 5, 170);
+	grpFPU->add(chkFPUfast, 5, 200);
 	grpFPU->setMovable(false);
-	grpFPU->setSize(180, 215);
+	grpFPU->setSize(180, 245);
   grpFPU->setBaseColor(gui_baseCol);
   
   category.panel->add(grpFPU);
@@ -343,6 +351,7 @@ void ExitPanelCPU(void)
   delete optFPUinternal;
   delete chkFPUstrict;
   delete chkFPUJIT;
+  delete chkFPUfast;
   delete grpFPU;
   delete fpuButtonActionListener;
   delete fpuActionListener;
@@ -395,6 +404,7 @@ void RefreshPanelCPU(void)
   optFPUinternal->setEnabled(changed_prefs.cpu_model == 68040);
   
   chkFPUstrict->setSelected(changed_prefs.fpu_strict);
+  chkFPUfast->setSelected(changed_prefs.fpu_fast);
 #ifdef USE_JIT_FPU
   chkFPUJIT->setSelected(changed_prefs.compfpu);
   chkFPUJIT->setEnabled(changed_prefs.cachesize > 0);
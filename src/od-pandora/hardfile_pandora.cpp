@@ -7,12 +7,21 @@
 #include "zfile.h"
 #include "uae.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 struct hardfilehandle
 {
 	int zfile;
 	struct zfile *zf;
-	FILE *f;
+	int fd;
+	/* read-ahead state: window grows while the guest reads sequentially */
+	uae_u64 ra_next;
+	int ra_size;
+	/* harddrive_mmap: whole file mapped, transfers are plain copies */
+	uae_u8 *map;
+	uae_u64 mapsize;
 };
 
 struct uae_driveinfo {
@@ -36,13 +45,38 @@ struct uae_driveinfo {
 #define HDF_HANDLE_UNKNOWN 3
 
 #define CACHE_SIZE 16384
+#define CACHE_MAX_SIZE (256 * 1024)
 #define CACHE_FLUSH_TIME 5
 
+#define HDF_WRITEBACK_LAZY  0
+#define HDF_WRITEBACK_ASYNC 1
+#define HDF_WRITEBACK_SYNC  2
+
 static TCHAR *hdz[] = { _T("hdz"), _T("zip"), NULL };
 
+static void hdf_map (struct hardfiledata *hfd, const TCHAR *name)
+{
+	struct hardfilehandle *h = hfd->handle;
+	uae_u64 size = hfd->physsize;
+	void *p;
+
+	if (size != (size_t)size) {
+		write_log (_T("HDF '%s' too large to map, using file mode\n"), name);
+		return;
+	}
+	p = mmap (NULL, (size_t)size, PROT_READ | (hfd->ci.readonly ? 0 : PROT_WRITE), MAP_SHARED, h->fd, 0);
+	if (p == MAP_FAILED) {
+		write_log (_T("HDF '%s' mmap failed (%d), using file mode\n"), name, errno);
+		return;
+	}
+	h->map = (uae_u8*)p;
+	h->mapsize = size;
+	write_log (_T("HDF '%s' mapped, writeback=%d\n"), name, currprefs.harddrive_writeback);
+}
+
 int hdf_open_target (struct hardfiledata *hfd, const TCHAR *pname)
 {
-	FILE *f = 0;
+	int fd = -1;
 	int i;
 	TCHAR *name = my_strdup (pname);
   TCHAR *ext;
@@ -51,16 +85,17 @@ int hdf_open_target (struct hardfiledata *hfd, const TCHAR *pname)
 	hfd->flags = 0;
 	hfd->drive_empty = 0;
 	hdf_close (hfd);
-	hfd->cache = (uae_u8*)malloc (CACHE_SIZE);
+	hfd->cache = (uae_u8*)malloc (CACHE_MAX_SIZE);
 	hfd->cache_valid = 0;
 	hfd->virtual_size = 0;
 	hfd->virtual_rdb = NULL;
 	if (!hfd->cache) {
-		write_log (_T("malloc(%d) failed in hdf_open_target\n"), CACHE_SIZE);
+		write_log (_T("malloc(%d) failed in hdf_open_target\n"), CACHE_MAX_SIZE);
 		goto end;
 	}
 	hfd->handle = xcalloc (struct hardfilehandle, 1);
-	hfd->handle->f = 0;
+	hfd->handle->fd = -1;
+	hfd->handle->ra_size = CACHE_SIZE;
 	write_log (_T("hfd attempting to open: '%s'\n"), name);
 
 	ext = _tcsrchr (name, '.');
@@ -71,13 +106,13 @@ int hdf_open_target (struct hardfiledata *hfd, const TCHAR *pname)
 				zmode = 1;
 		}
 	}
-	f = fopen(name, (hfd->ci.readonly ? "rb" : "r+b"));
-  if (f == NULL && !hfd->ci.readonly) {
-    f = fopen(name, "rb");
-    if(f != NULL)
+	fd = open64 (name, hfd->ci.readonly ? O_RDONLY : O_RDWR);
+  if (fd < 0 && !hfd->ci.readonly) {
+    fd = open64 (name, O_RDONLY);
+    if (fd >= 0)
       hfd->ci.readonly = true;
   }
-	hfd->handle->f = f;
+	hfd->handle->fd = fd;
 	i = _tcslen (name) - 1;
 	while (i >= 0) {
 		if ((i > 0 && (name[i - 1] == '/' || name[i - 1] == '\\')) || i == 0) {
@@ -88,11 +123,8 @@ int hdf_open_target (struct hardfiledata *hfd, const TCHAR *pname)
 	}
   _tcscpy (hfd->vendor_id, _T("UAE"));
   _tcscpy (hfd->product_rev, _T("0.4"));
-	if (f != NULL) {
-    uae_s64 pos = ftell(f);
-    fseek(f, 0, SEEK_END);
-    uae_s64 size = ftell(f);
-    fseek(f, pos, SEEK_SET);
+	if (fd >= 0) {
+    uae_s64 size = lseek64 (fd, 0, SEEK_END);
 
 		size &= ~(hfd->ci.blocksize - 1);
 		hfd->physsize = hfd->virtsize = size;
@@ -103,8 +135,8 @@ int hdf_open_target (struct hardfiledata *hfd, const TCHAR *pname)
 		hfd->handle_valid = HDF_HANDLE_FILE;
 		if (hfd->physsize < 64 * 1024 * 1024 && zmode) {
 			write_log (_T("HDF '%s' re-opened in zfile-mode\n"), name);
-			fclose (f);
-			hfd->handle->f = 0;
+			close (fd);
+			hfd->handle->fd = -1;
 			hfd->handle->zf = zfile_fopen (name, _T("rb"), ZFD_NORMAL);
 			hfd->handle->zfile = 1;
 			if (!hfd->handle->zf)
@@ -113,6 +145,8 @@ int hdf_open_target (struct hardfiledata *hfd, const TCHAR *pname)
 			hfd->physsize = hfd->virtsize = zfile_ftell (hfd->handle->zf);
 			zfile_fseek (hfd->handle->zf, 0, SEEK_SET);
 			hfd->handle_valid = HDF_HANDLE_ZFILE;
+		} else if (currprefs.harddrive_mmap) {
+			hdf_map (hfd, name);
 		}
 	} else {
 		write_log (_T("HDF '%s' failed to open.\n"), name);
@@ -132,12 +166,18 @@ static void freehandle (struct hardfilehandle *h)
 {
 	if (!h)
 		return;
-	if (!h->zfile && h->f != 0)
-		fclose (h->f);
+	if (h->map) {
+		msync (h->map, h->mapsize, MS_SYNC);
+		munmap (h->map, h->mapsize);
+		h->map = NULL;
+		h->mapsize = 0;
+	}
+	if (!h->zfile && h->fd >= 0)
+		close (h->fd);
 	if (h->zfile && h->zf)
 		zfile_fclose (h->zf);
 	h->zf = NULL;
-	h->f = 0;
+	h->fd = -1;
 	h->zfile = 0;
 }
 
@@ -160,17 +200,22 @@ void hdf_close_target (struct hardfiledata *hfd)
 	hfd->dangerous = 0;
 }
 
-static int hdf_seek (struct hardfiledata *hfd, uae_u64 offset)
+/* Validate a transfer and return the absolute file position, or -1 */
+static uae_s64 hdf_checkpos (struct hardfiledata *hfd, uae_u64 offset, int len)
 {
-	int ret;
-
 	if (hfd->handle_valid == 0) {
     target_startup_msg(_T("Internal error"), _T("hd: hdf handle is not valid."));
     uae_restart(1, NULL);
     return -1;
 	}
-	if (offset >= hfd->physsize - hfd->virtual_size) {
-		write_log (_T("hd: tried to seek out of bounds! (%I64X >= %I64X - %I64X)\n"), offset, hfd->physsize, hfd->virtual_size);
+	if (len < 0) {
+		write_log (_T("hd: poscheck failed, negative length! (%d)"), len);
+    target_startup_msg(_T("Internal error"), _T("hd: poscheck failed, negative length."));
+    uae_restart(1, NULL);
+    return -1;
+	}
+	if (offset >= hfd->physsize - hfd->virtual_size || offset + len > hfd->physsize - hfd->virtual_size) {
+		write_log (_T("hd: tried to seek out of bounds! (%I64X >= %I64X - %I64X, LEN=%d)\n"), offset, hfd->physsize, hfd->virtual_size, len);
     target_startup_msg(_T("Internal error"), _T("hd: tried to seek out of bounds."));
     uae_restart(1, NULL);
     return -1;
@@ -183,91 +228,120 @@ static int hdf_seek (struct hardfiledata *hfd, uae_u64 offset)
     uae_restart(1, NULL);
     return -1;
 	}
-	if (hfd->handle_valid == HDF_HANDLE_FILE) {
-		ret = fseek (hfd->handle->f, offset, SEEK_SET);
-		if (ret != 0)
-			return -1;
-	} else if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
-		zfile_fseek (hfd->handle->zf, (long)offset, SEEK_SET);
-	}
-	return 0;
+	return offset;
 }
 
-static void poscheck (struct hardfiledata *hfd, int len)
+/* Positional read/write: no shared file position, so no seek per request */
+static int hdf_pread (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	uae_u64 pos;
-
-	if (hfd->handle_valid == HDF_HANDLE_FILE) {
-		pos = ftell (hfd->handle->f);
-		if (pos == -1) {
-			write_log (_T("hd: poscheck failed. seek failure"));
-      target_startup_msg(_T("Internal error"), _T("hd: poscheck failed. seek failure."));
-      uae_restart(1, NULL);
-      return;
-		}
-	} else if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
-		pos = zfile_ftell (hfd->handle->zf);
+	uae_s64 pos = hdf_checkpos (hfd, offset, len);
+	int got = 0;
+
+	if (pos < 0)
+		return 0;
+	if (hfd->handle->map) {
+		memcpy (buffer, hfd->handle->map + pos, len);
+		return len;
 	}
-	if (len < 0) {
-		write_log (_T("hd: poscheck failed, negative length! (%d)"), len);
-    target_startup_msg(_T("Internal error"), _T("hd: poscheck failed, negative length."));
-    uae_restart(1, NULL);
-    return;
+	if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
+		zfile_fseek (hfd->handle->zf, (long)pos, SEEK_SET);
+		return zfile_fread (buffer, 1, len, hfd->handle->zf);
 	}
-	if (pos < hfd->offset) {
-		write_log (_T("hd: poscheck failed, offset out of bounds! (%I64d < %I64d)"), pos, hfd->offset);
-    target_startup_msg(_T("Internal error"), _T("hd: hd: poscheck failed, offset out of bounds."));
-    uae_restart(1, NULL);
-    return;
+	while (got < len) {
+		ssize_t ret = pread64 (hfd->handle->fd, (uae_u8*)buffer + got, len - got, pos + got);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+		got += ret;
 	}
-	if (pos >= hfd->offset + hfd->physsize - hfd->virtual_size || pos >= hfd->offset + hfd->physsize + len - hfd->virtual_size) {
-		write_log (_T("hd: poscheck failed, offset out of bounds! (%I64d >= %I64d, LEN=%d)"), pos, hfd->offset + hfd->physsize, len);
-    target_startup_msg(_T("Internal error"), _T("hd: hd: poscheck failed, offset out of bounds."));
-    uae_restart(1, NULL);
-    return;
+	return got;
+}
+
+static int hdf_pwrite (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
+{
+	uae_s64 pos = hdf_checkpos (hfd, offset, len);
+	int done = 0;
+
+	if (pos < 0)
+		return 0;
+	if (hfd->handle->map) {
+		memcpy (hfd->handle->map + pos, buffer, len);
+		hdf_flush_target (hfd, offset + hfd->virtual_size, len, false);
+		return len;
 	}
-	if (pos & (hfd->ci.blocksize - 1)) {
-		write_log (_T("hd: poscheck failed, offset not aligned to blocksize! (%I64X & %04X = %04X\n"), pos, hfd->ci.blocksize, pos & hfd->ci.blocksize);
-    target_startup_msg(_T("Internal error"), _T("hd: poscheck failed, offset not aligned to blocksize."));
-    uae_restart(1, NULL);
-    return;
+	if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
+		zfile_fseek (hfd->handle->zf, (long)pos, SEEK_SET);
+		return zfile_fwrite (buffer, 1, len, hfd->handle->zf);
+	}
+	while (done < len) {
+		ssize_t ret = pwrite64 (hfd->handle->fd, (uae_u8*)buffer + done, len - done, pos + done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+		done += ret;
 	}
+	return done;
 }
 
 static int isincache (struct hardfiledata *hfd, uae_u64 offset, int len)
 {
 	if (!hfd->cache_valid)
 		return -1;
-	if (offset >= hfd->cache_offset && offset + len <= hfd->cache_offset + CACHE_SIZE)
+	if (offset >= hfd->cache_offset && offset + len <= hfd->cache_offset + hfd->cache_valid)
 		return (int)(offset - hfd->cache_offset);
 	return -1;
 }
 
+/*
+ * Size the next fill of the cache window. Misses that continue where the
+ * previous transfer ended double the window (up to CACHE_MAX_SIZE), so a
+ * stream of adjacent CMD_READs is served by a few large preads. Any random
+ * access drops back to CACHE_SIZE.
+ */
+static int hdf_readahead_size (struct hardfiledata *hfd, uae_u64 offset)
+{
+	struct hardfilehandle *h = hfd->handle;
+
+	if (offset == h->ra_next) {
+		if (h->ra_size < CACHE_MAX_SIZE)
+			h->ra_size *= 2;
+	} else {
+		h->ra_size = CACHE_SIZE;
+	}
+	return h->ra_size;
+}
+
 static int hdf_read_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
 	int outlen = 0;
 	int coffset;
+	int size;
+	uae_u64 end = hfd->physsize - hfd->virtual_size;
 
 	if (offset == 0)
 		hfd->cache_valid = 0;
 	coffset = isincache (hfd, offset, len);
 	if (coffset >= 0) {
 		memcpy (buffer, hfd->cache + coffset, len);
+		hfd->handle->ra_next = offset + len;
 		return len;
 	}
+	size = hdf_readahead_size (hfd, offset);
+	hfd->handle->ra_next = offset + len;
+	if (len >= size) {
+		/* large transfer: bypass the window and read straight into the buffer */
+		return hdf_pread (hfd, buffer, offset, len);
+	}
 	hfd->cache_offset = offset;
-	if (offset + CACHE_SIZE > hfd->offset + (hfd->physsize - hfd->virtual_size))
-		hfd->cache_offset = hfd->offset + (hfd->physsize - hfd->virtual_size) - CACHE_SIZE;
-	hdf_seek (hfd, hfd->cache_offset);
-	poscheck (hfd, CACHE_SIZE);
-	if (hfd->handle_valid == HDF_HANDLE_FILE)
-		outlen = fread(hfd->cache, 1, CACHE_SIZE, hfd->handle->f);
-	else if (hfd->handle_valid == HDF_HANDLE_ZFILE)
-		outlen = zfile_fread (hfd->cache, 1, CACHE_SIZE, hfd->handle->zf);
+	if (offset + size > end)
+		size = (int)(end - offset);
 	hfd->cache_valid = 0;
-	if (outlen != CACHE_SIZE)
+	outlen = hdf_pread (hfd, hfd->cache, hfd->cache_offset, size);
+	if (outlen < len)
 		return 0;
-	hfd->cache_valid = 1;
+	hfd->cache_valid = outlen;
 	coffset = isincache (hfd, offset, len);
 	if (coffset >= 0) {
 		memcpy (buffer, hfd->cache + coffset, len);
@@ -280,9 +354,6 @@ static int hdf_read_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, i
 
 int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	int got = 0;
-	uae_u8 *p = (uae_u8*)buffer;
-
 	if (hfd->drive_empty)
 		return 0;
 	if (offset < hfd->virtual_size) {
@@ -293,32 +364,11 @@ int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int
 		return len2;
 	}
 	offset -= hfd->virtual_size;
-	while (len > 0) {
-		int maxlen;
-		int ret;
-		if (hfd->physsize < CACHE_SIZE) {
-			hfd->cache_valid = 0;
-			hdf_seek (hfd, offset);
-			poscheck (hfd, len);
-			if (hfd->handle_valid == HDF_HANDLE_FILE) {
-				ret = fread (hfd->cache, 1, len, hfd->handle->f);
-				memcpy (buffer, hfd->cache, ret);
-			} else if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
-				ret = zfile_fread (buffer, 1, len, hfd->handle->zf);
-			}
-			maxlen = len;
-		} else {
-			maxlen = len > CACHE_SIZE ? CACHE_SIZE : len;
-			ret = hdf_read_2 (hfd, p, offset, maxlen);
-		}
-		got += ret;
-		if (ret != maxlen)
-			return got;
-		offset += maxlen;
-		p += maxlen;
-		len -= maxlen;
+	if (hfd->physsize < CACHE_SIZE || hfd->handle->map) {
+		hfd->cache_valid = 0;
+		return hdf_pread (hfd, buffer, offset, len);
 	}
-	return got;
+	return hdf_read_2 (hfd, buffer, offset, len);
 }
 
 static int hdf_write_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
@@ -329,54 +379,90 @@ static int hdf_write_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset,
 		return 0;
 	if (hfd->dangerous)
 		return 0;
-	hfd->cache_valid = 0;
-	hdf_seek (hfd, offset);
-	poscheck (hfd, len);
-	memcpy (hfd->cache, buffer, len);
-	if (hfd->handle_valid == HDF_HANDLE_FILE) {
+	if (hfd->cache_valid && offset < hfd->cache_offset + hfd->cache_valid && offset + len > hfd->cache_offset)
+		hfd->cache_valid = 0;
+	outlen = hdf_pwrite (hfd, buffer, offset, len);
+	if (hfd->handle_valid == HDF_HANDLE_FILE && offset == 0) {
 		TCHAR *name = hfd->emptyname == NULL ? (char *) _T("<unknown>") : hfd->emptyname;
-		outlen = fwrite (hfd->cache, 1, len, hfd->handle->f);
-		if (offset == 0) {
-			int outlen2;
-			uae_u8 *tmp;
-			int tmplen = 512;
-			tmp = (uae_u8*)malloc (tmplen);
-			if (tmp) {
-				memset (tmp, 0xa1, tmplen);
-				hdf_seek (hfd, offset);
-				outlen2 = fread (tmp, 1, tmplen, hfd->handle->f);
-				if (memcmp (hfd->cache, tmp, tmplen) != 0 || outlen != len)
-					gui_message (_T("\"%s\"\n\nblock zero write failed!"), name);
-				free (tmp);
-			}
+		int outlen2;
+		uae_u8 *tmp;
+		int tmplen = 512;
+		tmp = (uae_u8*)malloc (tmplen);
+		if (tmp) {
+			memset (tmp, 0xa1, tmplen);
+			outlen2 = hdf_pread (hfd, tmp, offset, tmplen);
+			if (memcmp (buffer, tmp, tmplen) != 0 || outlen != len)
+				gui_message (_T("\"%s\"\n\nblock zero write failed!"), name);
+			free (tmp);
 		}
-	} else if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
-		outlen = zfile_fwrite (hfd->cache, 1, len, hfd->handle->zf);
 	}
 	return outlen;
 }
 
 int hdf_write_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	int got = 0;
-	uae_u8 *p = (uae_u8*)buffer;
-
 	if (hfd->drive_empty)
 		return 0;
 	if (offset < hfd->virtual_size)
 		return len;
 	offset -= hfd->virtual_size;
-	while (len > 0) {
-		int maxlen = len > CACHE_SIZE ? CACHE_SIZE : len;
-		int ret = hdf_write_2 (hfd, p, offset, maxlen);
-		if (ret < 0)
-			return ret;
-		got += ret;
-		if (ret != maxlen)
-			return got;
-		offset += maxlen;
-		p += maxlen;
-		len -= maxlen;
+	return hdf_write_2 (hfd, buffer, offset, len);
+}
+
+/*
+ * Direct pointer into the mapping for a transfer that lies completely in
+ * the physical part of a mapped hardfile, or NULL if the caller has to use
+ * hdf_read_target/hdf_write_target.
+ */
+uae_u8 *hdf_map_target (struct hardfiledata *hfd, uae_u64 offset, int len, bool write)
+{
+	struct hardfilehandle *h = hfd->handle;
+
+	if (hfd->drive_empty || !h || !h->map)
+		return NULL;
+	if (offset < hfd->virtual_size || len <= 0)
+		return NULL;
+	if (write && (hfd->ci.readonly || hfd->dangerous))
+		return NULL;
+	offset -= hfd->virtual_size;
+	if (offset + len > hfd->physsize - hfd->virtual_size)
+		return NULL;
+	offset += hfd->offset;
+	if (offset + len > h->mapsize)
+		return NULL;
+	return h->map + offset;
+}
+
+/*
+ * Write back dirty pages of a mapped hardfile. len == 0 means the whole
+ * file. With wait set the data is on disk on return (CMD_UPDATE, close),
+ * otherwise harddrive_writeback decides.
+ */
+void hdf_flush_target (struct hardfiledata *hfd, uae_u64 offset, uae_u64 len, bool wait)
+{
+	struct hardfilehandle *h = hfd->handle;
+	uae_u64 start, end;
+	int flags;
+
+	if (!h || !h->map)
+		return;
+	if (wait || currprefs.harddrive_writeback == HDF_WRITEBACK_SYNC)
+		flags = MS_SYNC;
+	else if (currprefs.harddrive_writeback == HDF_WRITEBACK_ASYNC)
+		flags = MS_ASYNC;
+	else
+		return;
+	if (len == 0) {
+		start = 0;
+		end = h->mapsize;
+	} else {
+		if (offset < hfd->virtual_size)
+			return;
+		start = offset - hfd->virtual_size + hfd->offset;
+		end = start + len;
+		if (end > h->mapsize)
+			end = h->mapsize;
+		start &= ~(uae_u64)(getpagesize () - 1);
 	}
-	return got;
+	msync (h->map + start, end - start, flags);
 }
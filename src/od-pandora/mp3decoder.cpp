@@ -30,10 +30,96 @@ static int mp3_samplesperframe[] = {
 
 mp3decoder::~mp3decoder() 
 {
+  close();
 }
 
 mp3decoder::mp3decoder() 
 {
+  g_mp3stream = NULL;
+}
+
+static ssize_t mp3_read_handle (void *handle, void *buf, size_t size)
+{
+  return zfile_fread(buf, 1, size, (struct zfile*)handle);
+}
+
+static off_t mp3_seek_handle (void *handle, off_t offset, int whence)
+{
+  struct zfile *zf = (struct zfile*)handle;
+  if (zfile_fseek(zf, offset, whence) < 0)
+    return -1;
+  return zfile_ftell(zf);
+}
+
+bool mp3decoder::open (struct zfile *zf)
+{
+  close();
+  if(mpg123_init() != MPG123_OK) {
+    write_log("MP3: failed to init mpeg123\n");
+    return false;
+  }
+  mpg123_handle *mh = mpg123_new(NULL, NULL);
+  if(mh == NULL) {
+    write_log("MP3: failed to init default decoder\n");
+    mpg123_exit();
+    return false;
+  }
+  /* CD audio layout, whatever the file says */
+  mpg123_format_none(mh);
+  mpg123_format(mh, 44100, MPG123_STEREO, MPG123_ENC_SIGNED_16);
+  mpg123_replace_reader_handle(mh, mp3_read_handle, mp3_seek_handle, NULL);
+  zfile_fseek(zf, 0, SEEK_SET);
+  if(mpg123_open_handle(mh, zf) != MPG123_OK) {
+    write_log("MP3: can't open '%s'\n", zfile_getname(zf));
+    mpg123_delete(mh);
+    mpg123_exit();
+    return false;
+  }
+  g_mp3stream = mh;
+  return true;
+}
+
+/* Returns bytes decoded, 0 at the end of the stream or -1 on error */
+int mp3decoder::read (uae_u8 *buf, int size)
+{
+  mpg123_handle *mh = (mpg123_handle*)g_mp3stream;
+  size_t done = 0;
+
+  if(!mh)
+    return -1;
+  for (;;) {
+    int ret = mpg123_read(mh, buf, size, &done);
+    if(ret == MPG123_NEW_FORMAT && done == 0)
+      continue;
+    if(ret == MPG123_DONE)
+      return done;
+    if(ret != MPG123_OK && ret != MPG123_NEW_FORMAT) {
+      write_log("MP3: error while decoding\n");
+      return -1;
+    }
+    return done;
+  }
+}
+
+bool mp3decoder::seek (uae_s64 sample)
+{
+  mpg123_handle *mh = (mpg123_handle*)g_mp3stream;
+
+  if(!mh)
+    return false;
+  return mpg123_seek(mh, sample, SEEK_SET) >= 0;
+}
+
+void mp3decoder::close (void)
+{
+  mpg123_handle *mh = (mpg123_handle*)g_mp3stream;
+
+  if(!mh)
+    return;
+  mpg123_close(mh);
+  mpg123_delete(mh);
+  mpg123_exit();
+  g_mp3stream = NULL;
 }
 
 uae_u8 *mp3decoder::get (struct zfile *zf, uae_u8 *outbuf, int maxsize) 
@@ -7,4 +7,9 @@ public:
     ~mp3decoder();
     uae_u8 *get(struct zfile *zf, uae_u8 *, int maxsize);
     uae_u32 getsize(struct zfile *zf);
+    /* streaming access, 44.1kHz 16-bit stereo */
+    bool open(struct zfile *zf);
+    int read(uae_u8 *buf, int size);
+    bool seek(uae_s64 sample);
+    void close(void);
 };
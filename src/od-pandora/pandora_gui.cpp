@@ -2,6 +2,9 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <map>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <guichan.hpp>
 #include <guichan/sdl.hpp>
 #include "sysconfig.h"
@@ -147,35 +150,36 @@ struct romscandata {
     int keysize;
 };
 
-static struct romdata *scan_single_rom_2 (struct zfile *f)
+/* Identify a ROM image held in memory. Touches no global state (a
+ * decoded Cloanto ROM is reported in *cloanto), so it can run on the scan
+ * workers. */
+static struct romdata *scan_rom_data (uae_u8 *data, int size, bool *cloanto)
 {
-  uae_u8 buffer[20] = { 0 };
   uae_u8 *rombuf;
-  int cl = 0, size;
+  int cl = 0, start = 0, avail = size;
   struct romdata *rd = 0;
 
-  zfile_fseek (f, 0, SEEK_END);
-  size = zfile_ftell (f);
-  zfile_fseek (f, 0, SEEK_SET);
   if (size > 524288 * 2) /* don't skip KICK disks or 1M ROMs */
   	return 0;
-  zfile_fread (buffer, 1, 11, f);
-  if (!memcmp (buffer, "KICK", 4)) {
-	  zfile_fseek (f, 512, SEEK_SET);
+  if (size >= 11 && !memcmp (data, "KICK", 4)) {
+	  start = 512;
 	  if (size > 262144)
 	    size = 262144;
-  } else if (!memcmp (buffer, "AMIROMTYPE1", 11)) {
+  } else if (size >= 11 && !memcmp (data, "AMIROMTYPE1", 11)) {
   	cl = 1;
+	  start = 11;
 	  size -= 11;
-  } else {
-	  zfile_fseek (f, 0, SEEK_SET);
   }
   rombuf = xcalloc (uae_u8, size);
   if (!rombuf)
   	return 0;
-  zfile_fread (rombuf, 1, size, f);
+  avail -= start;
+  if (avail > size)
+    avail = size;
+  if (avail > 0)
+    memcpy (rombuf, data + start, avail);
   if (cl > 0) {
-  	decode_cloanto_rom_do (rombuf, size, size);
+  	decode_cloanto_rom_key (rombuf, size, size, cloanto);
 	  cl = 0;
   }
   if (!cl) {
@@ -195,6 +199,29 @@ static struct romdata *scan_single_rom_2 (struct zfile *f)
   return rd;
 }
 
+static struct romdata *scan_single_rom_2 (struct zfile *f)
+{
+  uae_u8 *data;
+  int size;
+  struct romdata *rd;
+
+  zfile_fseek (f, 0, SEEK_END);
+  size = zfile_ftell (f);
+  zfile_fseek (f, 0, SEEK_SET);
+  if (size > 524288 * 2)
+  	return 0;
+  data = xcalloc (uae_u8, size + 1);
+  if (!data)
+  	return 0;
+  zfile_fread (data, 1, size, f);
+  bool cloanto = false;
+  rd = scan_rom_data (data, size, &cloanto);
+  if (cloanto)
+    cloanto_rom = 1;
+  xfree (data);
+  return rd;
+}
+
 static struct romdata *scan_single_rom (char *path)
 {
     struct zfile *z;
@@ -233,33 +260,250 @@ static int isromext(char *path)
   return 0;
 }
 
-static int scan_rom_2 (struct zfile *f, void *dummy)
+static int isarchiveext(const char *path)
+{
+  const char *ext = strrchr (path, '.');
+
+  if (!ext)
+  	return 0;
+  for (int i = 0; uae_archive_extensions[i]; i++) {
+	  if (!stricmp (ext + 1, uae_archive_extensions[i]))
+	    return 1;
+  }
+  return 0;
+}
+
+/*
+ * ROM scanning. Results are kept in romindex.txt in the config directory,
+ * keyed by path, size and mtime, so unchanged files are not read again.
+ * Plain files that do need hashing are handed to a small worker pool;
+ * archives (and packed or unreadable files) go through zfile
+ * on the calling thread because zfile is not thread safe.
+ */
+
+#define ROMINDEX_FILE "romindex.txt"
+#define ROMINDEX_HEADER "uae4arm romindex 1"
+#define ROMSCAN_MAX_WORKERS 4
+
+struct romscan_entry {
+  std::string path;
+  int id;
+};
+
+struct romscan_job {
+  std::string path;
+  uae_s64 size;
+  uae_s64 mtime;
+  bool cached;
+  bool hashed;
+  bool cloanto;		/* set by a worker, applied on the main thread */
+  std::vector<romscan_entry> roms;
+};
+
+struct romscan_pool {
+  std::vector<romscan_job*> jobs;
+  volatile uae_atomic next;
+  uae_sem_t done_sem;
+};
+
+static int scan_rom_2 (struct zfile *f, void *user)
 {
+  romscan_job *job = (romscan_job*)user;
   char *path = zfile_getname(f);
   struct romdata *rd;
 
   if (!isromext(path))
 	  return 0;
   rd = scan_single_rom_2(f);
-  if (rd)
-    addrom (rd, path);
+  if (rd) {
+    romscan_entry e;
+    e.path = path;
+    e.id = rd->id;
+    job->roms.push_back(e);
+  }
   return 0;
 }
 
-static void scan_rom(char *path)
+static void scan_rom(romscan_job *job)
 {
+  char path[MAX_DPATH];
+
+  strncpy(path, job->path.c_str(), MAX_DPATH - 1);
+  path[MAX_DPATH - 1] = 0;
   if (!isromext(path)) {
 	  //write_log("ROMSCAN: skipping file '%s', unknown extension\n", path);
 	  return;
   }
-  zfile_zopen (path, scan_rom_2, 0);
+  zfile_zopen (path, scan_rom_2, job);
+}
+
+/* Compressed or archived data that only zfile can look into */
+static bool romscan_packed (const uae_u8 *d, int size)
+{
+  if (size < 8)
+    return false;
+  return (d[0] == 0x1f && d[1] == 0x8b)			/* gzip */
+    || !memcmp (d, "\xfd" "7zXZ", 5)			/* xz */
+    || !memcmp (d, "PK\x03\x04", 4)			/* zip */
+    || !memcmp (d, "Rar!", 4)
+    || !memcmp (d, "7z\xbc\xaf", 4)
+    || !memcmp (d, "DMS!", 4)
+    || (d[2] == '-' && d[3] == 'l' && d[4] == 'h');	/* lha */
+}
+
+static void *romscan_worker (void *arg)
+{
+  romscan_pool *pool = (romscan_pool*)arg;
+
+  for (;;) {
+    int i = atomic_inc(&pool->next) - 1;
+    if (i >= pool->jobs.size())
+      break;
+    romscan_job *job = pool->jobs[i];
+    if (job->size <= 0 || job->size > 524288 * 2)
+      continue;
+    FILE *f = fopen(job->path.c_str(), "rb");
+    if (!f)
+      continue;
+    uae_u8 *data = xcalloc (uae_u8, job->size + 1);
+    if (data && fread(data, 1, job->size, f) == job->size) {
+      struct romdata *rd = scan_rom_data(data, job->size, &job->cloanto);
+      if (rd) {
+        romscan_entry e;
+        e.path = job->path;
+        e.id = rd->id;
+        job->roms.push_back(e);
+      }
+      job->hashed = rd || !romscan_packed(data, job->size);
+    }
+    xfree(data);
+    fclose(f);
+  }
+  uae_sem_post(&pool->done_sem);
+  return 0;
+}
+
+static void romscan_run_workers (std::vector<romscan_job*> &jobs)
+{
+  romscan_pool pool;
+  uae_thread_id tids[ROMSCAN_MAX_WORKERS];
+  int started = 0;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int workers = cpus < 1 ? 1 : (cpus > ROMSCAN_MAX_WORKERS ? ROMSCAN_MAX_WORKERS : cpus);
+
+  if (jobs.size() == 0)
+    return;
+  if (workers > jobs.size())
+    workers = jobs.size();
+  pool.jobs = jobs;
+  pool.next = 0;
+  uae_sem_init(&pool.done_sem, 0, 0);
+  for (int i = 0; i < workers; i++) {
+    if (uae_start_thread(_T("romscan"), romscan_worker, &pool, &tids[started]) != BAD_THREAD)
+      started++;
+  }
+  /* No thread could be started, do the work here */
+  if (!started)
+    romscan_worker(&pool);
+  for (int i = 0; i < (started ? started : 1); i++)
+    uae_sem_wait(&pool.done_sem);
+  for (int i = 0; i < started; i++)
+    uae_wait_thread(tids[i]);
+  uae_sem_destroy(&pool.done_sem);
+}
+
+static void romindex_name (char *out, int size)
+{
+  fetch_configurationpath(out, size);
+  strncat(out, ROMINDEX_FILE, size - strlen(out) - 1);
+}
+
+static void romindex_load (std::vector<romscan_job*> &jobs)
+{
+  char name[MAX_DPATH];
+  char line[MAX_DPATH * 2 + 64];
+  std::map<std::string, romscan_job*> bypath;
+  FILE *f;
+
+  romindex_name(name, sizeof name);
+  f = fopen(name, "r");
+  if (!f)
+    return;
+  if (!fgets(line, sizeof line, f) || strncmp(line, ROMINDEX_HEADER, strlen(ROMINDEX_HEADER))) {
+    fclose(f);
+    return;
+  }
+  for (int i = 0; i < jobs.size(); i++)
+    bypath[jobs[i]->path] = jobs[i];
+  while (fgets(line, sizeof line, f)) {
+    char *fields[5];
+    char *p = line;
+    int n;
+    line[strcspn(line, "\r\n")] = 0;
+    for (n = 0; n < 5 && p; n++) {
+      fields[n] = p;
+      p = strchr(p, '\t');
+      if (p)
+        *p++ = 0;
+    }
+    if (n < 4)
+      continue;
+    std::map<std::string, romscan_job*>::iterator it = bypath.find(fields[0]);
+    if (it == bypath.end())
+      continue;
+    romscan_job *job = it->second;
+    if (job->size != strtoll(fields[1], NULL, 10) || job->mtime != strtoll(fields[2], NULL, 10))
+      continue;
+    int id = atoi(fields[3]);
+    if (id > 0 && n == 5 && getromdatabyid(id)) {
+      romscan_entry e;
+      e.path = fields[4];
+      e.id = id;
+      job->roms.push_back(e);
+    }
+    job->cached = true;
+  }
+  fclose(f);
+  /* A new or changed key file can make encrypted ROMs readable */
+  for (int i = 0; i < jobs.size(); i++) {
+    const char *ext = strrchr(jobs[i]->path.c_str(), '.');
+    if (ext && !stricmp(ext, ".key") && !jobs[i]->cached) {
+      for (int j = 0; j < jobs.size(); j++) {
+        jobs[j]->cached = false;
+        jobs[j]->roms.clear();
+      }
+      break;
+    }
+  }
 }
 
+static void romindex_save (std::vector<romscan_job*> &jobs)
+{
+  char name[MAX_DPATH];
+  FILE *f;
+
+  romindex_name(name, sizeof name);
+  f = fopen(name, "w");
+  if (!f)
+    return;
+  fprintf(f, "%s\n", ROMINDEX_HEADER);
+  for (int i = 0; i < jobs.size(); i++) {
+    romscan_job *job = jobs[i];
+    if (job->roms.size() == 0)
+      fprintf(f, "%s\t%lld\t%lld\t0\n", job->path.c_str(), job->size, job->mtime);
+    for (int j = 0; j < job->roms.size(); j++)
+      fprintf(f, "%s\t%lld\t%lld\t%d\t%s\n", job->path.c_str(), job->size, job->mtime, job->roms[j].id, job->roms[j].path.c_str());
+  }
+  fclose(f);
+}
 
 void RescanROMs(void)
 {
   std::vector<std::string> files;
+  std::vector<romscan_job*> jobs, work;
   char path[MAX_DPATH];
+  int cached = 0, hashed = 0, zscanned = 0;
+  Uint32 starttime = SDL_GetTicks();
   
   romlist_clear();
   
@@ -271,10 +515,54 @@ void RescanROMs(void)
   for(int i=0; i<files.size(); ++i)
   {
     char tmppath[MAX_PATH];
+    struct stat st;
     strncpy(tmppath, path, MAX_PATH - 1);
     strncat(tmppath, files[i].c_str(), MAX_PATH - 1);
-    scan_rom (tmppath);
+    if (!isromext(tmppath) || stat(tmppath, &st) != 0)
+      continue;
+    romscan_job *job = new romscan_job();
+    job->path = tmppath;
+    job->size = st.st_size;
+    job->mtime = st.st_mtime;
+    job->cached = false;
+    job->hashed = false;
+    job->cloanto = false;
+    jobs.push_back(job);
+  }
+
+  romindex_load(jobs);
+  for (int i = 0; i < jobs.size(); i++) {
+    if (jobs[i]->cached)
+      cached++;
+    else if (!isarchiveext(jobs[i]->path.c_str()))
+      work.push_back(jobs[i]);
+  }
+  romscan_run_workers(work);
+
+  for (int i = 0; i < jobs.size(); i++) {
+    romscan_job *job = jobs[i];
+    if (!job->cached && !job->hashed) {
+      /* archives, packed files and files the workers could not read */
+      scan_rom(job);
+      zscanned++;
+    } else if (job->hashed) {
+      hashed++;
+    }
+    if (job->cloanto)
+      cloanto_rom = 1;
+    for (int j = 0; j < job->roms.size(); j++) {
+      char rompath[MAX_DPATH];
+      strncpy(rompath, job->roms[j].path.c_str(), MAX_DPATH - 1);
+      rompath[MAX_DPATH - 1] = 0;
+      addrom (getromdatabyid(job->roms[j].id), rompath);
+    }
   }
+  if (cached != jobs.size())
+    romindex_save(jobs);
+  write_log(_T("ROMSCAN: %d files, %d from index, %d hashed, %d via zfile, %d ms\n"),
+    jobs.size(), cached, hashed, zscanned, SDL_GetTicks() - starttime);
+  for (int i = 0; i < jobs.size(); i++)
+    delete jobs[i];
   
 	int id = 1;
 	for (;;) {
@@ -393,6 +393,7 @@ bool mapped_malloc (addrbank *ab)
 	    ab->baseaddr, ab->baseaddr + ab->allocated_size, ab->name, ab->label);
 	}
   ab->flags |= ABFLAG_DIRECTMAP;
+  memory_direct_update (ab);
   
   return (ab->baseaddr != NULL);
 }
@@ -408,6 +409,7 @@ void mapped_free (addrbank *ab)
   }
   ab->baseaddr = NULL;
   ab->allocated_size = 0;
+  memory_direct_update (ab);
 }
 
 
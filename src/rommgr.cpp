@@ -1088,7 +1088,9 @@ static struct romdata *checkromdata (const uae_u8 *sha1, int size, uae_u32 mask)
   return NULL;
 }
 
-int decode_cloanto_rom_do (uae_u8 *mem, int size, int real_size)
+/* Same as decode_cloanto_rom_do() but reports a Cloanto ROM in *cloanto
+   instead of setting cloanto_rom, so it can run off the main thread */
+int decode_cloanto_rom_key (uae_u8 *mem, int size, int real_size, bool *cloanto)
 {
   int cnt, t, i;
 
@@ -1105,14 +1107,14 @@ int decode_cloanto_rom_do (uae_u8 *mem, int size, int real_size)
   	    t = keysize - 1;
     }
   	if ((mem[2] == 0x4e && mem[3] == 0xf9) || (mem[0] == 0x11 && (mem[1] == 0x11 || mem[1] == 0x14))) {
-	    cloanto_rom = 1;
+	    *cloanto = true;
 	    return 1;
   	}
   	get_sha1 (mem, size, sha1);
   	rd = checkromdata (sha1, size, -1);
   	if (rd) {
 	    if (rd->cloanto)
-    		cloanto_rom = 1;
+    		*cloanto = true;
 	    return 1;
   	}
   	if (i == 0)
@@ -1126,6 +1128,15 @@ int decode_cloanto_rom_do (uae_u8 *mem, int size, int real_size)
   return 0;
 }
 
+int decode_cloanto_rom_do (uae_u8 *mem, int size, int real_size)
+{
+  bool cloanto = false;
+  int v = decode_cloanto_rom_key (mem, size, real_size, &cloanto);
+  if (cloanto)
+    cloanto_rom = 1;
+  return v;
+}
+
 static int decode_rekick_rom_do (uae_u8 *mem, int size, int real_size)
 {
   uae_u32 d1 = 0xdeadfeed, d0;
@@ -212,6 +212,13 @@ struct TrapContext
 
 	uae_u32 calllib_regs[16];
 	uae_u8 calllib_reg_inuse[16];
+
+  /* Next idle context in the trap pool. */
+  TrapContext       *next_free;
+  /* Set to make an idle trap thread exit. */
+  int               quit;
+  /* Host time at trap entry, for the latency counters. */
+  frame_time_t      start_time;
 };
 
 static void copytocpucontext(struct TrapCPUContext *cpu)
@@ -238,6 +245,24 @@ static uae_sem_t trap_mutex = 0;
 static TrapContext *current_context;
 
 
+/*
+ * Extended trap contexts are pooled: each context owns a host thread which
+ * stays alive between traps, so a trap only costs a semaphore handoff
+ * instead of creating and joining a thread. The pool is only touched from
+ * the emulator thread (trap entry and exit_trap_handler), so it needs no
+ * locking of its own.
+ */
+#define TRAP_POOL_MAX 8
+
+static TrapContext *trap_free_list;
+static int trap_free_count;
+
+/* Trap pool statistics */
+static unsigned int trap_stat_calls;
+static unsigned int trap_stat_threads;
+static uae_u64 trap_stat_time;
+static frame_time_t trap_stat_maxtime;
+
 /*
  * Thread body for trap context
  */
@@ -245,42 +270,105 @@ static void *trap_thread (void *arg)
 {
   TrapContext *context = (TrapContext *) arg;
 
-  /* Wait until main thread is ready to switch to the
-   * this trap context. */
-  uae_sem_wait (&context->switch_to_trap_sem);
+  for (;;) {
+    /* Wait until main thread is ready to switch to the
+     * this trap context. */
+    uae_sem_wait (&context->switch_to_trap_sem);
+    if (context->quit)
+      break;
+
+    /* Execute trap handler function. */
+    context->trap_retval = context->trap_handler (context);
+
+    /* Trap handler is done - we still need to tidy up
+     * and make sure the handler's return value is propagated
+     * to the calling 68k thread.
+     *
+     * We do this by causing our exit handler to be executed on the 68k context.
+     */
+
+    /* Enter critical section - only one trap at a time, please! */
+    uae_sem_wait (&trap_mutex);
+
+  	//regs = context->saved_regs;
+  	/* Set PC to address of the exit handler, so that it will be called
+  	* when the 68k context resumes. */
+  	copyfromcpucontext (&context->saved_regs, exit_trap_trapaddr);
+    /* Don't allow an interrupt and thus potentially another
+     * trap to be invoked while we hold the above mutex.
+     * This is probably just being paranoid. */
+    regs.intmask = 7;
+
+  	//m68k_setpc (exit_trap_trapaddr);
+    current_context = context;
+
+    /* Switch back to 68k context, then sleep until this
+     * context is handed its next trap. */
+    uae_sem_post (&context->switch_to_emu_sem);
+  }
 
-  /* Execute trap handler function. */
-  context->trap_retval = context->trap_handler (context);
+  /* Good bye, cruel world... */
 
-  /* Trap handler is done - we still need to tidy up
-   * and make sure the handler's return value is propagated
-   * to the calling 68k thread.
-   *
-   * We do this by causing our exit handler to be executed on the 68k context.
-   */
+  /* dummy return value */
+  return 0;
+}
 
-  /* Enter critical section - only one trap at a time, please! */
-  uae_sem_wait (&trap_mutex);
+static TrapContext *trap_get_context (void)
+{
+  TrapContext *context = trap_free_list;
 
-	//regs = context->saved_regs;
-	/* Set PC to address of the exit handler, so that it will be called
-	* when the 68k context resumes. */
-	copyfromcpucontext (&context->saved_regs, exit_trap_trapaddr);
-  /* Don't allow an interrupt and thus potentially another
-   * trap to be invoked while we hold the above mutex.
-   * This is probably just being paranoid. */
-  regs.intmask = 7;
+  if (context) {
+    trap_free_list = context->next_free;
+    trap_free_count--;
+  } else {
+    context = xcalloc (TrapContext, 1);
+    if (!context)
+      return NULL;
+	  uae_sem_init (&context->switch_to_trap_sem, 0, 0);
+	  uae_sem_init (&context->switch_to_emu_sem, 0, 0);
 
-	//m68k_setpc (exit_trap_trapaddr);
-  current_context = context;
+	  /* Start thread to handle this and later trap contexts. */
+	  if (!uae_start_thread_fast (trap_thread, (void *)context, &context->thread)) {
+	    uae_sem_destroy (&context->switch_to_trap_sem);
+	    uae_sem_destroy (&context->switch_to_emu_sem);
+	    xfree (context);
+	    return NULL;
+	  }
+    trap_stat_threads++;
+  }
+  context->next_free = NULL;
+  memset (context->calllib_reg_inuse, 0, sizeof context->calllib_reg_inuse);
+  return context;
+}
 
-  /* Switch back to 68k context */
-  uae_sem_post (&context->switch_to_emu_sem);
+static void trap_put_context (TrapContext *context)
+{
+  if (trap_free_count < TRAP_POOL_MAX) {
+    context->next_free = trap_free_list;
+    trap_free_list = context;
+    trap_free_count++;
+    return;
+  }
 
-  /* Good bye, cruel world... */
+  /* Enough idle threads already, retire this one. */
+  context->quit = 1;
+  uae_sem_post (&context->switch_to_trap_sem);
+  uae_wait_thread (context->thread);
+  uae_sem_destroy (&context->switch_to_trap_sem);
+  uae_sem_destroy (&context->switch_to_emu_sem);
+  xfree (context);
+}
 
-  /* dummy return value */
-  return 0;
+static void trap_log_stats (void)
+{
+  if (!trap_stat_calls)
+    return;
+  write_log (_T("TRAPS: %u extended traps, %u threads started, %d idle, avg %u us, max %lu us\n"),
+    trap_stat_calls, trap_stat_threads, trap_free_count,
+    (unsigned int)(trap_stat_time / trap_stat_calls), trap_stat_maxtime);
+  trap_stat_calls = 0;
+  trap_stat_time = 0;
+  trap_stat_maxtime = 0;
 }
 
 /*
@@ -288,21 +376,16 @@ static void *trap_thread (void *arg)
  */
 static void trap_HandleExtendedTrap (TrapHandler handler_func, int has_retval)
 {
-  struct TrapContext *context = xcalloc (TrapContext, 1);
+  struct TrapContext *context = trap_get_context ();
 
   if (context) {
-	  uae_sem_init (&context->switch_to_trap_sem, 0, 0);
-	  uae_sem_init (&context->switch_to_emu_sem, 0, 0);
-
 	  context->trap_handler    = handler_func;
 	  context->trap_has_retval = has_retval;
+	  context->start_time      = read_processor_time ();
 
 		//context->saved_regs = regs;
 		copytocpucontext (&context->saved_regs);
 
-	  /* Start thread to handle new trap context. */
-	  uae_start_thread_fast (trap_thread, (void *)context, &context->thread);
-
 	  /* Switch to trap context to begin execution of
 	   * trap handler function.
 	   */
@@ -431,9 +514,12 @@ static uae_u32 REGPARAM2 m68k_return_handler (TrapContext *dummy_ctx)
 static uae_u32 REGPARAM2 exit_trap_handler (TrapContext *dummy_ctx)
 {
   TrapContext *context = current_context;
+  frame_time_t t = read_processor_time () - context->start_time;
 
-  /* Wait for trap context thread to exit. */
-  uae_wait_thread (context->thread);
+  trap_stat_calls++;
+  trap_stat_time += t;
+  if (t > trap_stat_maxtime)
+    trap_stat_maxtime = t;
 
   /* Restore 68k state saved at trap entry. */
 	//regs = context->saved_regs;
@@ -444,10 +530,9 @@ static uae_u32 REGPARAM2 exit_trap_handler (TrapContext *dummy_ctx)
   if (context->trap_has_retval)
   	m68k_dreg (regs, 0) = context->trap_retval;
 
-  uae_sem_destroy (&context->switch_to_trap_sem);
-  uae_sem_destroy (&context->switch_to_emu_sem);
-
-  xfree (context);
+  /* The trap thread goes back to waiting on switch_to_trap_sem;
+   * keep it for the next trap. */
+  trap_put_context (context);
 
   /* End critical section */
   uae_sem_post (&trap_mutex);
@@ -495,6 +580,8 @@ void init_traps (void)
  */
 void init_extended_traps (void)
 {
+  trap_log_stats ();
+
   m68k_call_trapaddr = here ();
   calltrap (deftrap2 (m68k_call_handler, TRAPFLAG_NO_RETVAL, _T("m68k_call")));
 
@@ -0,0 +1,227 @@
+/*
+ * CD image sector cache benchmark.
+ *
+ * Runs the sector cache and do_read()/do_read_l2() from blkdev_cdimage.cpp
+ * over an ISO image file the way a CD32 load reads it: Akiko asks for 64
+ * raw 2352 byte sectors and refills once the drive is two thirds through
+ * them, with directory lookups and seeks between files. A second pass does
+ * the plain 2048 byte reads of command_read(). Each pattern is timed with
+ * the image in the host page cache and again after dropping it.
+ *
+ * Build with -DCD_CACHE_SECTORS=0 for the uncached reads; both builds
+ * print a checksum of the data so their output can be compared.
+ */
+
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+typedef uint8_t uae_u8;
+typedef uint32_t uae_u32;
+typedef int64_t uae_s64;
+typedef uint64_t uae_u64;
+typedef char TCHAR;
+
+#define _T(x) x
+#define xmalloc(T, N) ((T *)malloc (sizeof (T) * (N)))
+#define xcalloc(T, N) ((T *)calloc (sizeof (T), (N)))
+#define xfree(p) free (p)
+
+static bool quiet;
+
+static void write_log (const TCHAR *format, ...)
+{
+  va_list parms;
+
+  if (quiet)
+    return;
+  va_start (parms, format);
+  vprintf (format, parms);
+  va_end (parms);
+}
+
+typedef pthread_mutex_t uae_sem_t;
+static void uae_sem_wait (uae_sem_t *s) { pthread_mutex_lock (s); }
+static void uae_sem_post (uae_sem_t *s) { pthread_mutex_unlock (s); }
+
+/* zfile on a plain file is stdio */
+struct zfile { FILE *f; };
+static uae_s64 zfile_fseek (struct zfile *z, uae_s64 offset, int mode) { return fseeko (z->f, offset, mode); }
+static size_t zfile_fread (void *b, size_t l1, size_t l2, struct zfile *z) { return fread (b, l1, l2, z->f); }
+
+void encode_l2 (uae_u8 *p, int address);
+
+/* live code from blkdev_cdimage.cpp */
+#include "cdcache-defs.inc"
+
+struct cdtoc
+{
+  struct zfile *handle;
+  uae_s64 offset;
+  int size;
+  int skipsize;
+};
+
+struct cdunit
+{
+  uae_sem_t cache_sem;
+  struct cdcache_entry *cache;
+  uae_u8 *ra_buf;
+  struct cdtoc *ra_track;
+  int ra_next, ra_size;
+  uae_u32 cache_hits, cache_misses, cache_readahead;
+};
+
+#include "cdcache.inc"
+
+#define AKIKO_BUFFER 64
+
+static struct cdunit unit = { PTHREAD_MUTEX_INITIALIZER };
+static struct cdtoc track;
+static struct zfile image;
+static int image_sectors;
+static uae_u32 sum;
+
+/* one word in every 16 bytes, enough to catch a wrong sector */
+static void add_sum (const uae_u8 *p, int len)
+{
+  for (int i = 0; i + 4 <= len; i += 16)
+    sum = sum * 31 + *(const uae_u32 *)(p + i);
+}
+
+/* command_rawread(), 2048 -> 2352 */
+static void rawread (uae_u8 *data, int sector, int size)
+{
+  while (size-- > 0 && sector < image_sectors) {
+    do_read_l2 (&unit, &track, data, sector);
+    add_sum (data, 2352);
+    sector++;
+    data += 2352;
+  }
+}
+
+/* command_read() on a 2048 byte track */
+static void cookedread (uae_u8 *data, int sector, int size)
+{
+  while (size-- > 0 && sector < image_sectors) {
+    do_read (&unit, &track, data, sector, 0, 2048, false);
+    add_sum (data, 2048);
+    sector++;
+    data += 2048;
+  }
+}
+
+/* Akiko streams a file: refill 64 sectors from the current position
+   whenever it is past two thirds of the buffer */
+static void akiko_file (uae_u8 *buf, int start, int len)
+{
+  for (int s = start; s < start + len; s += AKIKO_BUFFER * 2 / 3)
+    rawread (buf, s, AKIKO_BUFFER);
+}
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void drop_page_cache (void)
+{
+  fflush (image.f);
+  fdatasync (fileno (image.f));
+  posix_fadvise (fileno (image.f), 0, 0, POSIX_FADV_DONTNEED);
+}
+
+/* 40 files of 100-1500 sectors spread over the disc, each found through
+   the root and a sub directory first */
+static void cd32_load (uae_u8 *buf, void (*read) (uae_u8 *, int, int), bool akiko)
+{
+  srand (5);
+  read (buf, 16, 1);
+  for (int f = 0; f < 40; f++) {
+    int len = 100 + rand () % 1400;
+    int start = 100 + rand () % (image_sectors - len - 100);
+    read (buf, 18, 2);
+    read (buf, 20 + rand () % 60, 1);
+    if (akiko)
+      akiko_file (buf, start, len);
+    else
+      for (int s = start; s < start + len; s += 16)
+        read (buf, s, 16);
+  }
+}
+
+static void flush (void)
+{
+  cdcache_flush (&unit);
+}
+
+int main (int argc, char **argv)
+{
+  const char *name = argc > 1 ? argv[1] : "cdcache.iso";
+  int mb = argc > 2 ? atoi (argv[2]) : 96;
+  static uae_u8 buf[AKIKO_BUFFER * 2352];
+
+  image_sectors = mb * 1024 * 1024 / 2048;
+  image.f = fopen (name, "rb");
+  if (!image.f || (fseeko (image.f, 0, SEEK_END), ftello (image.f)) != (uae_s64)image_sectors * 2048) {
+    if (image.f)
+      fclose (image.f);
+    printf ("cdcache: writing a %d MB image to %s\n", mb, name);
+    FILE *f = fopen (name, "wb");
+    if (!f)
+      return 1;
+    srand (1);
+    for (int i = 0; i < image_sectors; i++) {
+      for (int j = 0; j < 2048; j++)
+        buf[j] = rand ();
+      fwrite (buf, 1, 2048, f);
+    }
+    fclose (f);
+    image.f = fopen (name, "rb");
+  }
+  track.handle = &image;
+  track.size = 2048;
+
+  static const struct {
+    const char *name;
+    void (*read) (uae_u8 *, int, int);
+    bool akiko;
+  } runs[] = {
+    { "CD32 raw 2352", rawread, true },
+    { "cooked 2048", cookedread, false },
+  };
+  printf ("cdcache: CD_CACHE_SECTORS %d, best of 3\n", CD_CACHE_SECTORS);
+  for (int r = 0; r < 2; r++) {
+    for (int cold = 1; cold >= 0; cold--) {
+      double best = 1e9;
+      quiet = true;
+      for (int i = 0; i < 3; i++) {
+        if (cold)
+          drop_page_cache ();
+        else
+          cd32_load (buf, runs[r].read, runs[r].akiko);
+        flush ();
+        sum = 0;
+        double t = now ();
+        cd32_load (buf, runs[r].read, runs[r].akiko);
+        t = now () - t;
+        if (t < best)
+          best = t;
+        quiet = i < 2;
+        flush ();
+      }
+      printf ("%-14s %-4s %8.1f ms  sum %08x\n", runs[r].name, cold ? "cold" : "hot", best * 1000, sum);
+    }
+  }
+  fclose (image.f);
+  return 0;
+}
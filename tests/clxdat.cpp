@@ -0,0 +1,388 @@
+/*
+ * Sprite/playfield collision check (CLXDAT).
+ *
+ * do_sprite_collisions() in custom.cpp builds per-line bitmasks instead of
+ * testing every sprite pixel against the planes. The old per-pixel loop is
+ * kept below as do_sprite_collisions_old(). It has one quirk that the new
+ * code does not copy: a pixel is skipped when ANY sprite pair on it already
+ * has both of its collision bits set, so the other pairs on that pixel are
+ * lost. do_sprite_collisions_ref() is the old loop without that skip.
+ *
+ * The table lists fixed cases with the CLXDAT value the old and the new code
+ * give; the random pass then requires new == ref, new to be a superset of
+ * old, and new == old whenever only one sprite pair is active.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t uae_u8;
+typedef uint16_t uae_u16;
+typedef uint32_t uae_u32;
+typedef int hwres_t;
+typedef int sprbuf_res_t;
+
+#define STATIC_INLINE static inline
+#define MAX_PLANES 8
+#define MAX_WORDS_PER_LINE 100
+
+static struct {
+  int plfleft, plfright, diwfirstword, diwlastword, nr_planes;
+} thisline_decision;
+static int coord_window_to_diw_x (int x) { return x; }
+static int bplcon0_res, aga_mode, next_lineno, sprite_buffer_res;
+static unsigned int bplcon0, clxdat, clxcon, clxcon_bpl_enable, clxcon_bpl_match;
+static uae_u8 line_data[1][MAX_PLANES * MAX_WORDS_PER_LINE * 2 + 64];
+static struct {
+  int nr_sprites, first_sprite_entry;
+} curr_drawinfo[1];
+struct sprite_entry
+{
+  unsigned short pos;
+  unsigned short max;
+  unsigned int first_pixel;
+  bool has_attached;
+};
+static struct sprite_entry curr_sprite_entries[16];
+static uae_u16 spixels[16 * 2000];
+static uae_u32 clxmask[16], sprite_ab_merge[256];
+
+/* live code from custom.cpp */
+#include "clxdat.inc"
+
+/* The per-pixel loop do_sprite_collisions() replaced. With quirk == 0
+ * the "both bits already set" skip is left out. */
+static void do_sprite_collisions_pixel (int quirk)
+{
+  int nr_sprites = curr_drawinfo[next_lineno].nr_sprites;
+  int first = curr_drawinfo[next_lineno].first_sprite_entry;
+  int i;
+  unsigned int collision_mask = clxmask[clxcon >> 12];
+  int bplres = bplcon0_res;
+  hwres_t ddf_left = thisline_decision.plfleft * 2 << bplres;
+  hwres_t hw_diwlast = coord_window_to_diw_x (thisline_decision.diwlastword);
+  hwres_t hw_diwfirst = coord_window_to_diw_x (thisline_decision.diwfirstword);
+
+  for (i = 0; i < nr_sprites; i++) {
+    struct sprite_entry *e = curr_sprite_entries + first + i;
+    sprbuf_res_t j;
+    sprbuf_res_t minpos = e->pos;
+    sprbuf_res_t maxpos = e->max;
+    hwres_t minp1 = minpos >> sprite_buffer_res;
+    hwres_t maxp1 = maxpos >> sprite_buffer_res;
+
+    if (maxp1 > hw_diwlast)
+      maxpos = hw_diwlast << sprite_buffer_res;
+    if (maxp1 > thisline_decision.plfright * 2)
+      maxpos = thisline_decision.plfright * 2 << sprite_buffer_res;
+    if (minp1 < hw_diwfirst)
+      minpos = hw_diwfirst << sprite_buffer_res;
+    if (minp1 < thisline_decision.plfleft * 2)
+      minpos = thisline_decision.plfleft * 2 << sprite_buffer_res;
+
+    for (j = minpos; j < maxpos; j++) {
+      int sprpix = spixels[e->first_pixel + j - e->pos] & collision_mask;
+      int k, offs, match = 1;
+
+      if (sprpix == 0)
+        continue;
+
+      offs = ((j << bplres) >> sprite_buffer_res) - ddf_left;
+      sprpix = sprite_ab_merge[sprpix & 255] | (sprite_ab_merge[sprpix >> 8] << 2);
+      sprpix <<= 1;
+
+      // both odd and even collision bits already set?
+      if (quirk && (clxdat & (sprpix << 0)) && (clxdat & (sprpix << 4)))
+        continue;
+
+      /* Loop over number of playfields.  */
+      for (k = 1; k >= 0; k--) {
+        int l;
+        int planes = (aga_mode) ? 8 : 6;
+        if (bplcon0 & 0x400)
+          match = 1;
+        for (l = k; match && l < planes; l += 2) {
+          int t = 0;
+          if (l < thisline_decision.nr_planes) {
+            uae_u32 *ldata = (uae_u32 *)(line_data[next_lineno] + 2 * l * MAX_WORDS_PER_LINE);
+            uae_u32 word = ldata[offs >> 5];
+            t = (word >> (31 - (offs & 31))) & 1;
+          }
+          if (clxcon_bpl_enable & (1 << l)) {
+            if (t != ((clxcon_bpl_match >> l) & 1))
+              match = 0;
+          }
+        }
+        if (match) {
+          clxdat |= sprpix << (k * 4);
+        }
+      }
+    }
+  }
+}
+
+static void do_sprite_collisions_old (void) { do_sprite_collisions_pixel (1); }
+static void do_sprite_collisions_ref (void) { do_sprite_collisions_pixel (0); }
+
+/* The per-word loop do_playfield_collisions() replaced. */
+static void do_playfield_collisions_old (void)
+{
+  int bplres = bplcon0_res;
+  hwres_t ddf_left = thisline_decision.plfleft * 2 << bplres;
+  hwres_t hw_diwlast = coord_window_to_diw_x (thisline_decision.diwlastword);
+  hwres_t hw_diwfirst = coord_window_to_diw_x (thisline_decision.diwfirstword);
+  int i, collided, minpos, maxpos;
+  int planes = (aga_mode) ? 8 : 6;
+
+  collided = 0;
+  minpos = thisline_decision.plfleft * 2;
+  if (minpos < hw_diwfirst)
+    minpos = hw_diwfirst;
+  maxpos = thisline_decision.plfright * 2;
+  if (maxpos > hw_diwlast)
+    maxpos = hw_diwlast;
+  for (i = minpos; i < maxpos && !collided; i+= 32) {
+    int offs = ((i << bplres) - ddf_left) >> 3;
+    int j;
+    uae_u32 total = 0xffffffff;
+    for (j = 0; j < planes; j++) {
+      int ena = (clxcon_bpl_enable >> j) & 1;
+      int match = (clxcon_bpl_match >> j) & 1;
+      uae_u32 t = 0xffffffff;
+      if (ena) {
+        if (j < thisline_decision.nr_planes) {
+          t = *(uae_u32 *)(line_data[next_lineno] + offs + 2 * j * MAX_WORDS_PER_LINE);
+          t ^= (match & 1) - 1;
+        } else {
+          t = (match & 1) - 1;
+        }
+      }
+      total &= t;
+    }
+    if (total) {
+      collided = 1;
+    }
+  }
+  if (collided)
+    clxdat |= 1;
+}
+
+static void init_tables (void)
+{
+  int i;
+
+  /* as in init_hardware_frame () */
+  for (i = 0; i < 256; i++)
+    sprite_ab_merge[i] = (((i & 15) ? 1 : 0) | ((i & 240) ? 2 : 0));
+  for (i = 0; i < 16; i++)
+    clxmask[i] = (((i & 1) ? 0xF : 0x3)
+      | ((i & 2) ? 0xF0 : 0x30)
+      | ((i & 4) ? 0xF00 : 0x300)
+      | ((i & 8) ? 0xF000 : 0x3000));
+}
+
+/*
+ * Fixed cases, OCS lores, two planes, the playfield starting at pixel 0x70.
+ * Sprites 0 (pair 0) and 2 (pair 1) draw single pixels at the given
+ * positions; plane bits are given for each position that is used.
+ * CLXDAT bits 1-4 are pair 0-3 against planes 0/2/4, bits 5-8 against
+ * planes 1/3/5.
+ */
+struct clx_case {
+  const char *what;
+  int dual;
+  int spr0, spr2;       /* pixel offset, -1 = not drawn */
+  int plane0, plane1;   /* plane bits at the sprite pixels */
+  uae_u16 start;
+  uae_u16 old_result, new_result;
+};
+
+static const struct clx_case cases[] = {
+  { "pair 0 over matching planes",          0,  4, -1, 1, 1, 0x000, 0x022, 0x022 },
+  { "pair 0 and 1 on one pixel",            0,  4,  4, 1, 1, 0x000, 0x066, 0x066 },
+  { "odd planes don't match, single pf",    0,  4, -1, 1, 0, 0x000, 0x000, 0x000 },
+  { "odd planes don't match, dual pf",      1,  4, -1, 1, 0, 0x000, 0x002, 0x002 },
+  { "pair 0 already found, pair 1 apart",   0,  4, 20, 1, 1, 0x022, 0x066, 0x066 },
+  { "pair 0 half found, same pixel",        0,  4,  4, 1, 1, 0x002, 0x066, 0x066 },
+  /* the quirk: pair 1 is hidden behind the already complete pair 0 */
+  { "pair 0 already found, same pixel",     0,  4,  4, 1, 1, 0x022, 0x022, 0x066 },
+  { "pair 0 already found, same pixel, dpf",1,  4,  4, 1, 1, 0x022, 0x022, 0x066 },
+  { "no sprite pixels",                     0, -1, -1, 1, 1, 0x000, 0x000, 0x000 },
+};
+
+static void set_plane_bit (int plane, int offs, int v)
+{
+  uae_u32 *p = (uae_u32 *)(line_data[0] + 2 * plane * MAX_WORDS_PER_LINE) + (offs >> 5);
+  uae_u32 bit = 0x80000000 >> (offs & 31);
+  if (v)
+    *p |= bit;
+  else
+    *p &= ~bit;
+}
+
+static void setup_case (const struct clx_case *c)
+{
+  int n = 0, fp = 0;
+  int pix[2] = { c->spr0, c->spr2 };
+
+  aga_mode = 0;
+  bplcon0_res = 0;
+  sprite_buffer_res = 0;
+  bplcon0 = c->dual ? 0x400 : 0;
+  thisline_decision.nr_planes = 2;
+  thisline_decision.plfleft = 0x38;
+  thisline_decision.plfright = 0x38 + 160;
+  thisline_decision.diwfirstword = 0x70;
+  thisline_decision.diwlastword = 0x70 + 320;
+  clxcon = 0x0c3;       /* planes 0 and 1 enabled, both match 1 */
+  clxcon_bpl_enable = 3;
+  clxcon_bpl_match = 3;
+  memset (line_data, 0, sizeof line_data);
+  next_lineno = 0;
+
+  for (int s = 0; s < 2; s++) {
+    /* a pixel shared by both sprites is one entry */
+    if (pix[s] < 0 || (s == 1 && pix[0] == pix[1]))
+      continue;
+    set_plane_bit (0, pix[s], c->plane0);
+    set_plane_bit (1, pix[s], c->plane1);
+    struct sprite_entry *e = &curr_sprite_entries[n++];
+    e->pos = 0x70 + pix[s];
+    e->max = e->pos + 1;
+    e->first_pixel = fp;
+    spixels[fp] = 1 << (s * 4);
+    if (s == 0 && pix[1] == pix[0])
+      spixels[fp] |= 1 << 4;
+    fp++;
+  }
+  curr_drawinfo[0].nr_sprites = n;
+  curr_drawinfo[0].first_sprite_entry = 0;
+}
+
+static int run_table (void)
+{
+  int bad = 0;
+
+  printf ("%-40s start   old   new\n", "");
+  for (unsigned int i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+    const struct clx_case *c = &cases[i];
+    uae_u16 r_old, r_new;
+
+    setup_case (c);
+    clxdat = c->start;
+    do_sprite_collisions_old ();
+    r_old = clxdat;
+    clxdat = c->start;
+    do_sprite_collisions ();
+    r_new = clxdat;
+    printf ("%-40s %04x  %04x  %04x%s\n", c->what, c->start, r_old, r_new,
+      r_old != c->old_result || r_new != c->new_result ? "  FAIL" : "");
+    if (r_old != c->old_result || r_new != c->new_result)
+      bad++;
+  }
+  return bad;
+}
+
+static int run_random (int count)
+{
+  long bad_ref = 0, bad_sub = 0, bad_single = 0, bad_pf = 0, single = 0, differs = 0;
+
+  srand (3);
+  for (int it = 0; it < count; it++) {
+    aga_mode = rand () & 1;
+    bplcon0_res = rand () % 3;
+    sprite_buffer_res = rand () % 3;
+    bplcon0 = (rand () & 1) ? 0x400 : 0;
+    thisline_decision.nr_planes = rand () % ((aga_mode ? 8 : 6) + 1);
+    int left = 0x18 + rand () % 40;
+    int wpix = 80 + rand () % (aga_mode ? 200 : 160);
+    thisline_decision.plfleft = left;
+    thisline_decision.plfright = left + (wpix >> bplcon0_res);
+    thisline_decision.diwfirstword = left * 2 + rand () % 40 - 20;
+    thisline_decision.diwlastword = thisline_decision.plfright * 2 - rand () % 40 + 20;
+    clxcon = rand () & 0xffff;
+    clxcon_bpl_enable = (clxcon >> 6) & 63;
+    clxcon_bpl_match = clxcon & 63;
+    if (aga_mode && (rand () & 1)) {
+      clxcon_bpl_enable |= rand () & 0xc0;
+      clxcon_bpl_match |= rand () & 0xc0;
+    }
+    int dens = rand () % 4;
+    for (unsigned int i = 0; i < sizeof line_data[0]; i++)
+      line_data[0][i] = dens == 0 ? rand () : dens == 1 ? (rand () % 4 ? 0 : rand ())
+        : dens == 2 ? (rand () % 4 ? 0xff : rand ()) : (rand () & 0xaa);
+    next_lineno = 0;
+
+    int ns = rand () % 5, fp = 0;
+    bool one = rand () & 1;
+    curr_drawinfo[0].nr_sprites = ns;
+    curr_drawinfo[0].first_sprite_entry = 0;
+    for (int s = 0; s < ns; s++) {
+      struct sprite_entry *e = &curr_sprite_entries[s];
+      int pos = (left * 2 - 30 + rand () % (wpix * 2)) << sprite_buffer_res;
+      int len = (16 + rand () % 64) << sprite_buffer_res;
+      int pr = rand () % 4;
+      if (pos < 0)
+        pos = 0;
+      e->pos = pos;
+      e->max = pos + len;
+      e->first_pixel = fp;
+      for (int j = 0; j < len; j++)
+        spixels[fp + j] = rand () % 3 ? 0
+          : one ? (rand () & 3) << (pr * 4 + (rand () & 1) * 2) : rand ();
+      fp += len;
+    }
+
+    uae_u16 start = rand () % 3 == 0 ? rand () & 0x1ff : 0;
+    clxdat = start;
+    do_sprite_collisions_old ();
+    uae_u16 r_old = clxdat;
+    clxdat = start;
+    do_sprite_collisions_ref ();
+    uae_u16 r_ref = clxdat;
+    clxdat = start;
+    do_sprite_collisions ();
+    uae_u16 r_new = clxdat;
+
+    if (r_new != r_ref) {
+      if (bad_ref < 5)
+        printf ("case %d: start %04x ref %04x new %04x\n", it, start, r_ref, r_new);
+      bad_ref++;
+    }
+    if ((r_new & r_old) != r_old)
+      bad_sub++;
+    if (r_new != r_old)
+      differs++;
+    if (one) {
+      single++;
+      if (r_new != r_old)
+        bad_single++;
+    }
+
+    clxdat = start & ~1;
+    do_playfield_collisions_old ();
+    uae_u16 p_old = clxdat;
+    clxdat = start & ~1;
+    do_playfield_collisions ();
+    if (clxdat != p_old)
+      bad_pf++;
+  }
+  printf ("%d random lines: %ld differ from ref, %ld lose old bits, "
+    "%ld of %ld single pair lines differ from old, %ld playfield differ "
+    "(%ld differ from old through the quirk)\n",
+    count, bad_ref, bad_sub, bad_single, single, bad_pf, differs);
+  return bad_ref + bad_sub + bad_single + bad_pf;
+}
+
+int main (int argc, char **argv)
+{
+  int bad;
+
+  init_tables ();
+  bad = run_table ();
+  bad += run_random (argc > 1 ? atoi (argv[1]) : 200000);
+  printf ("clxdat: %s\n", bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Copper lookahead cache check and benchmark.
+ *
+ * predict_copper() in custom.cpp can remember its result per line and
+ * position and reuse it while the copper state and the chip RAM words it
+ * read are unchanged. This includes predict_copper() twice, with a 512
+ * entry cache and with COPPER_TRACE_ENTRIES 0, and calls both from the same copper
+ * states, which a simple copper model produces frame by frame:
+ *
+ *   game      - static list: pointers, colours, one split screen
+ *   gradient  - a wait and three colour moves on every line
+ *   rewritten - the gradient with its colours changed by the CPU each frame
+ *   doublebuf - two copies of the game list swapped every frame
+ *
+ * Each copper line gets a call where the copper wakes up plus three at
+ * random positions, which stand in for the CPU custom register writes
+ * that sync the copper. Both builds must give the same first_sync,
+ * regtypes_modified and copper event for every call; the time spent in
+ * predict_copper() is printed for each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+typedef uint8_t uae_u8;
+typedef uint16_t uae_u16;
+typedef uint32_t uae_u32;
+typedef uae_u32 uaecptr;
+
+#define STATIC_INLINE static inline
+#define _T(x) x
+#define write_log printf
+
+/* live code from custom.cpp */
+#include "copper-defs.inc"
+
+static struct copper cop_state;
+static int vpos, maxhpos = 227;
+
+#define CHIPMEM_SIZE 0x80000
+static struct {
+  uae_u8 *baseaddr;
+} chipmem_bank;
+static uae_u32 chipmem_full_mask = CHIPMEM_SIZE - 1;
+
+STATIC_INLINE uae_u32 chipmem_wget_indirect (uae_u32 PT)
+{
+  uae_u8 *p = chipmem_bank.baseaddr + (PT & chipmem_full_mask);
+  return (p[0] << 8) | p[1];
+}
+
+#define SPCFLAG_COPPER 4
+#define CYCLE_UNIT 512
+enum { ev_copper };
+static struct {
+  int active;
+  unsigned long evtime;
+} eventtab[1];
+static unsigned long cycles;
+static void unset_special (int) { }
+static unsigned long get_cycles (void) { return cycles; }
+static void events_schedule (void) { }
+
+namespace on {
+#define COPPER_TRACE_ENTRIES 512
+#include "copper.inc"
+}
+#undef COPPER_TRACE_ENTRIES
+
+namespace off {
+#define COPPER_TRACE_ENTRIES 0
+#include "copper.inc"
+}
+
+#include "copper-regtypes.inc"
+
+/* a copper state to predict from */
+struct call {
+  int vpos;
+  struct copper cop;
+};
+
+/* what predict_copper left behind */
+struct result {
+  unsigned int first_sync, regtypes_modified;
+  int active;
+  unsigned long evtime;
+};
+
+static void put_word (uaecptr addr, uae_u16 v)
+{
+  chipmem_bank.baseaddr[addr] = v >> 8;
+  chipmem_bank.baseaddr[addr + 1] = v;
+}
+
+static uaecptr put_insn (uaecptr addr, uae_u16 w1, uae_u16 w2)
+{
+  put_word (addr, w1);
+  put_word (addr + 2, w2);
+  return addr + 4;
+}
+
+static uaecptr put_wait (uaecptr addr, int line, int hpos)
+{
+  return put_insn (addr, ((line & 0xff) << 8) | (hpos & 0xfe) | 1, 0xfffe);
+}
+
+/* a typical game display: sprite and bitplane pointers, display setup,
+   32 colours, and a status panel split at line 0xe0 */
+static uaecptr put_game_list (uaecptr addr)
+{
+  for (int i = 0; i < 16; i++)
+    addr = put_insn (addr, 0x120 + i * 2, rand ());
+  for (int i = 0; i < 10; i++)
+    addr = put_insn (addr, 0xe0 + i * 2, rand ());
+  static const uae_u16 setup[] = { 0x100, 0x102, 0x104, 0x8e, 0x90, 0x92, 0x94, 0x108, 0x10a };
+  for (unsigned int i = 0; i < sizeof setup / sizeof setup[0]; i++)
+    addr = put_insn (addr, setup[i], rand ());
+  for (int i = 0; i < 32; i++)
+    addr = put_insn (addr, 0x180 + i * 2, rand () & 0xfff);
+  addr = put_wait (addr, 0xe0, 0x07);
+  for (int i = 0; i < 8; i++)
+    addr = put_insn (addr, 0xe0 + i * 2, rand ());
+  for (int i = 0; i < 8; i++)
+    addr = put_insn (addr, 0x180 + i * 2, rand () & 0xfff);
+  return put_insn (addr, 0xffff, 0xfffe);
+}
+
+/* three colour moves on every line from 0x2c */
+static uaecptr put_gradient_list (uaecptr addr)
+{
+  for (int i = 0; i < 10; i++)
+    addr = put_insn (addr, 0xe0 + i * 2, rand ());
+  for (int line = 0x2c; line < 0x100; line++) {
+    addr = put_wait (addr, line, 0x07);
+    for (int c = 0; c < 3; c++)
+      addr = put_insn (addr, 0x180 + c * 2, rand () & 0xfff);
+  }
+  return put_insn (addr, 0xffff, 0xfffe);
+}
+
+static void rewrite_gradient (uaecptr list, int frame)
+{
+  uaecptr addr = list + 10 * 4;
+  for (int line = 0x2c; line < 0x100; line++) {
+    addr += 4;
+    for (int c = 0; c < 3; c++, addr += 4)
+      put_word (addr + 2, (line + frame + c * 0x50) & 0xfff);
+  }
+}
+
+/* Just enough of the copper to know where it is: moves take 4 cycles,
+   waits 6 and wake up 2 cycles after their position. */
+static void copper_step (int line_end)
+{
+  struct copper *c = &cop_state;
+
+  if (c->state == COP_wait) {
+    unsigned int vcmp = (c->i1 & (c->i2 | 0x8000)) >> 8;
+    unsigned int hcmp = c->i1 & c->i2 & 0xfe;
+    unsigned int vp = vpos & (((c->i2 >> 8) & 0x7f) | 0x80);
+    if (vp < vcmp) {
+      c->hpos = line_end;
+    } else if (vp > vcmp || hcmp <= (unsigned int)c->hpos) {
+      c->hpos += 2;
+      c->state = COP_read1;
+    } else {
+      c->hpos = hcmp + 2;
+      c->state = COP_read1;
+    }
+    return;
+  }
+  unsigned int w1 = chipmem_wget_indirect (c->ip);
+  unsigned int w2 = chipmem_wget_indirect (c->ip + 2);
+  c->ip += 4;
+  if (!(w1 & 1)) {
+    c->hpos += 4;
+    return;
+  }
+  c->i1 = w1;
+  c->i2 = w2;
+  c->hpos += 6;
+  if (w2 & 1)
+    return;
+  c->state = w1 == 0xffff && w2 == 0xfffe ? COP_waitforever : COP_wait;
+}
+
+static bool copper_waiting (void)
+{
+  struct copper *c = &cop_state;
+
+  if (c->state == COP_waitforever)
+    return true;
+  if (c->state != COP_wait)
+    return false;
+  unsigned int vp = vpos & (((c->i2 >> 8) & 0x7f) | 0x80);
+  return vp < ((c->i1 & (c->i2 | 0x8000)) >> 8);
+}
+
+static void copper_run (int hpos)
+{
+  while (cop_state.hpos < hpos && !copper_waiting ())
+    copper_step (hpos);
+}
+
+/* one frame of the list, adding a call wherever the copper syncs */
+static void model_frame (uaecptr list, std::vector<struct call> &calls)
+{
+  memset (&cop_state, 0, sizeof cop_state);
+  cop_state.ip = list;
+  cop_state.state = COP_read1;
+  for (vpos = 0; vpos < 0x138; vpos++) {
+    cop_state.hpos = 0;
+    if (copper_waiting ())
+      continue;
+    int sync[4] = { 0, 8 + rand () % 200, 8 + rand () % 200, 8 + rand () % 200 };
+    for (int i = 1; i < 4; i++)
+      for (int j = i; j > 0 && sync[j] < sync[j - 1]; j--) {
+        int t = sync[j]; sync[j] = sync[j - 1]; sync[j - 1] = t;
+      }
+    for (int i = 0; i < 4; i++) {
+      copper_run (sync[i]);
+      if (copper_waiting () || cop_state.hpos + 8 >= maxhpos)
+        break;
+      struct call c = { vpos, cop_state };
+      calls.push_back (c);
+    }
+    copper_run (maxhpos);
+  }
+}
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum { GAME, GRADIENT, REWRITTEN, DOUBLEBUF };
+static const char *names[] = { "game", "gradient", "rewritten", "doublebuf" };
+
+static uaecptr lists[2];
+
+/* the list of a frame, and the calls the copper makes on it */
+static void setup (int kind, int frame, std::vector<struct call> &calls)
+{
+  uaecptr list = lists[kind == DOUBLEBUF ? frame & 1 : 0];
+
+  if (kind == REWRITTEN)
+    rewrite_gradient (list, frame);
+  calls.clear ();
+  model_frame (list, calls);
+}
+
+static double run (int kind, int frames, void (*predict) (void), void (*flush) (void),
+  std::vector<struct result> &out, unsigned long *ncalls)
+{
+  std::vector<struct call> calls;
+  double t = 0;
+
+  flush ();
+  *ncalls = 0;
+  out.clear ();
+  srand (kind + 1);
+  for (int f = 0; f < frames; f++) {
+    bool record = f < 50 || f >= frames - 50;
+    setup (kind, f, calls);
+    double t0 = now ();
+    for (size_t i = 0; i < calls.size (); i++) {
+      vpos = calls[i].vpos;
+      cop_state = calls[i].cop;
+      eventtab[ev_copper].active = 0;
+      eventtab[ev_copper].evtime = 0;
+      predict ();
+      if (record) {
+        struct result r;
+        memset (&r, 0, sizeof r);
+        r.first_sync = cop_state.first_sync;
+        r.regtypes_modified = cop_state.regtypes_modified;
+        r.active = eventtab[ev_copper].active;
+        r.evtime = eventtab[ev_copper].evtime;
+        out.push_back (r);
+      }
+    }
+    t += now () - t0;
+    *ncalls += calls.size ();
+  }
+  return t;
+}
+
+int main (int argc, char **argv)
+{
+  int frames = argc > 1 ? atoi (argv[1]) : 2000;
+  std::vector<struct result> ron, roff;
+  int bad = 0;
+
+  chipmem_bank.baseaddr = (uae_u8 *)calloc (1, CHIPMEM_SIZE);
+  init_regtypes ();
+  srand (1);
+  put_game_list (0x1000);
+  put_gradient_list (0x2000);
+
+  printf ("copper: %d frames, time in predict_copper\n", frames);
+  for (int kind = GAME; kind <= DOUBLEBUF; kind++) {
+    unsigned long ncalls;
+    lists[0] = kind == GAME || kind == DOUBLEBUF ? 0x1000 : 0x2000;
+    lists[1] = 0x3000;
+    if (kind == DOUBLEBUF)
+      memcpy (chipmem_bank.baseaddr + 0x3000, chipmem_bank.baseaddr + 0x1000, 0x1000);
+    double toff = run (kind, frames, off::predict_copper, off::copper_trace_flush, roff, &ncalls);
+    double ton = run (kind, frames, on::predict_copper, on::copper_trace_flush, ron, &ncalls);
+    int differ = 0;
+    for (size_t i = 0; i < ron.size (); i++)
+      if (memcmp (&ron[i], &roff[i], sizeof ron[i]))
+        differ++;
+    printf ("%-10s %6lu calls/frame  cache on %7.1f ms (%3.0f ns/call)  off %7.1f ms (%3.0f ns/call)  %d differ\n",
+      names[kind], ncalls / frames, ton * 1000, ton * 1e9 / ncalls, toff * 1000, toff * 1e9 / ncalls, differ);
+    bad += differ;
+  }
+  printf ("copper: %s\n", bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}
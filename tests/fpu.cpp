@@ -0,0 +1,271 @@
+/*
+ * Fast FPU mode check and benchmark.
+ *
+ * With fpu_fast set, fpuop_arithmetic() in fpp.cpp decodes the basic
+ * arithmetic instructions in fpuop_arithmetic_fast() instead of going
+ * through get_fp_value() and fp_arithmetic(). This includes fpp.cpp and
+ * runs 5M random FPU instructions twice from the same state, with
+ * fpu_fast off and on: random opcodes (mostly the fast path ones),
+ * operand sizes and addressing modes, FP register values including zeros,
+ * infinities and NaNs, FPCR rounding, precision and exception enables,
+ * FPSR, CPU and FPU models and pending exceptions. FP and CPU registers,
+ * FPSR, FPIAR, PC, memory and raised exceptions must match. NaN results
+ * only have to be NaN: the host may keep either operand's NaN in
+ * NaN + NaN.
+ *
+ * Then a few common instructions are timed with fpu_fast off and on.
+ */
+
+#include "fpp.inc"
+
+#include <time.h>
+
+struct regstruct regs;
+struct uae_prefs currprefs, changed_prefs;
+addrbank *mem_banks[MEMORY_BANKS];
+
+#define RAM_SIZE 0x1000
+static uae_u8 ram[RAM_SIZE + 16];
+static int exc_count, illg_count;
+
+void Exception (int n) { exc_count += n; }
+uae_u32 REGPARAM2 op_illg (uae_u32 opcode) { illg_count++; return 0; }
+uae_u32 _get_disp_ea_020 (uae_u32 base) { return base; }
+void init_fpucw_x87 (void) { }
+uae_u32 restore_u32_func (uae_u8 **) { return 0; }
+uae_u16 restore_u16_func (uae_u8 **) { return 0; }
+void save_u32_func (uae_u8 **, uae_u32) { }
+void save_u16_func (uae_u8 **, uae_u16) { }
+
+/* all addresses wrap around in ram[] */
+static uae_u32 get_l (uaecptr a)
+{
+	a &= RAM_SIZE - 1;
+	return (ram[a] << 24) | (ram[a + 1] << 16) | (ram[a + 2] << 8) | ram[a + 3];
+}
+static uae_u32 get_w (uaecptr a)
+{
+	a &= RAM_SIZE - 1;
+	return (ram[a] << 8) | ram[a + 1];
+}
+static uae_u32 get_b (uaecptr a)
+{
+	return ram[a & (RAM_SIZE - 1)];
+}
+static void put_l (uaecptr a, uae_u32 v)
+{
+	a &= RAM_SIZE - 1;
+	ram[a] = v >> 24; ram[a + 1] = v >> 16; ram[a + 2] = v >> 8; ram[a + 3] = v;
+}
+static void put_w (uaecptr a, uae_u32 v)
+{
+	a &= RAM_SIZE - 1;
+	ram[a] = v >> 8; ram[a + 1] = v;
+}
+static void put_b (uaecptr a, uae_u32 v)
+{
+	ram[a & (RAM_SIZE - 1)] = v;
+}
+uae_u32 (*x_get_long)(uaecptr) = get_l;
+uae_u32 (*x_get_word)(uaecptr) = get_w;
+uae_u32 (*x_get_byte)(uaecptr) = get_b;
+void (*x_put_long)(uaecptr, uae_u32) = put_l;
+void (*x_put_word)(uaecptr, uae_u32) = put_w;
+void (*x_put_byte)(uaecptr, uae_u32) = put_b;
+
+static uae_u8 *REGPARAM2 ram_xlate (uaecptr a) { return ram + (a & (RAM_SIZE - 1)); }
+static addrbank ram_bank;
+
+/* xorshift, rand () only gives 31 bits */
+static uae_u64 rnd_state = 1;
+static uae_u64 rnd (void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 7;
+	rnd_state ^= rnd_state << 17;
+	return rnd_state;
+}
+
+static double rnd_double (void)
+{
+	switch (rnd () % 10) {
+	case 0: return 0.0;
+	case 1: return -0.0;
+	case 2: return INFINITY * ((rnd () & 1) ? 1 : -1);
+	case 3: return NAN;
+	case 4: return (double)(int)(rnd () % 2000) - 1000;
+	case 5: { uae_u64 v = rnd (); double d; memcpy (&d, &v, 8); return d; }
+	default: return ((double)(rnd () % 1000000) / 997.0) * ((rnd () & 1) ? 1 : -1);
+	}
+}
+
+/* the fast path ones, then some that it leaves to fp_arithmetic () */
+static const int ops[] = {
+	0x00, 0x40, 0x44, 0x04, 0x41, 0x45, 0x18, 0x58, 0x5c, 0x1a, 0x5a, 0x5e,
+	0x20, 0x60, 0x64, 0x22, 0x62, 0x66, 0x23, 0x63, 0x67, 0x28, 0x68, 0x6c, 0x38, 0x3a,
+	0x01, 0x03, 0x0e, 0x24, 0x27, 0x21, 0x30, 0x1e
+};
+
+struct state {
+	struct regstruct r;
+	uae_u8 ram[RAM_SIZE];
+	int exc, illg;
+};
+
+static const int models[4][2] = { { 68020, 68881 }, { 68030, 68882 }, { 68040, 68040 }, { 68060, 68060 } };
+static uae_u8 ibuf[64];
+
+static void random_state (uae_u32 *opcode, uae_u16 *extra)
+{
+	int m = rnd () % 4;
+
+	currprefs.cpu_model = models[m][0];
+	currprefs.fpu_model = (rnd () % 16) ? models[m][1] : 0;
+	currprefs.fpu_no_unimplemented = rnd () & 1;
+	memset (&regs, 0, sizeof regs);
+	for (int i = 0; i < 16; i++)
+		regs.regs[i] = rnd ();
+	for (int i = 8; i < 16; i++)
+		if (rnd () % 4)
+			regs.regs[i] = 0x100 + rnd () % (RAM_SIZE - 0x200);
+	for (int i = 0; i < 8; i++)
+		regs.fp[i].fp = rnd_double ();
+	regs.fpsr = rnd ();
+	regs.fpcr = rnd () & ((rnd () % 8) ? 0xf0 : 0xfff0);
+	regs.fp_unimp_pend = (rnd () % 32) == 0;
+	regs.pcr = (rnd () % 32) == 0 ? 2 : 0;
+	for (int i = 0; i < 64; i++)
+		ibuf[i] = rnd ();
+	regs.pc = 0x1004;
+
+	*opcode = 0xf200 | (rnd () & 0x3f);
+	*extra = (rnd () & 0x1f80) | ops[rnd () % (sizeof ops / sizeof ops[0])];
+	*extra |= (rnd () % 8) ? ((rnd () & 1) << 14) : (rnd () & 0xe000);
+	if ((rnd () % 16) == 0)
+		*extra = 0x5c00 | (rnd () & 0x3ff);
+	/* half of the double operands in memory are valid doubles */
+	if ((*extra & 0x4000) && ((*extra >> 10) & 7) == 5 && (rnd () & 1)) {
+		fpdata f;
+		uae_u32 w1, w2;
+		uaecptr ad = regs.regs[8 + (*opcode & 7)];
+		f.fp = rnd_double ();
+		fpp_from_double (&f, &w1, &w2);
+		put_l (ad, w1); put_l (ad + 4, w2);
+		put_l (ad - 8, w1); put_l (ad - 4, w2);
+	}
+}
+
+static void run_insn (const struct state *init, struct state *s, bool fast, uae_u32 opcode, uae_u16 extra)
+{
+	regs = init->r;
+	memcpy (ram, init->ram, RAM_SIZE);
+	regs.pc_p = regs.pc_oldp = ibuf;
+	exc_count = illg_count = 0;
+	currprefs.fpu_fast = fast;
+	fpu_mode_control = ~regs.fpcr;
+	fpp_set_fpcr (regs.fpcr);
+	fpuop_arithmetic (opcode, extra);
+	s->r = regs;
+	memcpy (s->ram, ram, RAM_SIZE);
+	s->exc = exc_count;
+	s->illg = illg_count;
+}
+
+static bool same (struct state *a, const struct state *b)
+{
+	for (int i = 0; i < 8; i++) {
+		if (isnan (a->r.fp[i].fp) && isnan (b->r.fp[i].fp))
+			a->r.fp[i] = b->r.fp[i];
+	}
+	if ((a->r.fpsr & b->r.fpsr & FPSR_CC_NAN))
+		a->r.fpsr = (a->r.fpsr & ~FPSR_CC_N) | (b->r.fpsr & FPSR_CC_N);
+	return !memcmp (a->r.fp, b->r.fp, sizeof a->r.fp) && a->r.fpsr == b->r.fpsr && a->r.fpiar == b->r.fpiar
+		&& !memcmp (a->r.regs, b->r.regs, sizeof a->r.regs) && a->r.pc_p == b->r.pc_p
+		&& a->exc == b->exc && a->illg == b->illg && a->r.fpu_state == b->r.fpu_state
+		&& a->r.fp_unimp_pend == b->r.fp_unimp_pend && !memcmp (a->ram, b->ram, RAM_SIZE);
+}
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench (void)
+{
+	static const struct {
+		const char *name;
+		uae_u16 opcode, extra;
+	} insns[] = {
+		{ "FMUL FP2,FP0", 0xf200, 0x0823 },
+		{ "FADD FP1,FP0", 0xf200, 0x0422 },
+		{ "FADD.D (A0),FP0", 0xf210, 0x5422 },
+		{ "FCMP FP2,FP0", 0xf200, 0x0838 },
+	};
+	const int count = 20000000;
+
+	currprefs.cpu_model = 68060;
+	currprefs.fpu_model = 68060;
+	currprefs.fpu_no_unimplemented = 1;
+	printf ("fpu: time per instruction\n");
+	for (int k = 0; k < 4; k++) {
+		double t[2];
+		for (int fast = 0; fast < 2; fast++) {
+			memset (&regs, 0, sizeof regs);
+			regs.regs[8] = 0x100;
+			put_l (0x100, 0x3ff00000);
+			put_l (0x104, 0);
+			for (int i = 0; i < 8; i++)
+				regs.fp[i].fp = 1.0 + i * 1e-9;
+			currprefs.fpu_fast = fast;
+			fpp_set_fpcr (0);
+			t[fast] = now ();
+			for (int i = 0; i < count; i++) {
+				regs.pc_p = regs.pc_oldp = ibuf;
+				fpuop_arithmetic (insns[k].opcode, insns[k].extra);
+			}
+			t[fast] = now () - t[fast];
+		}
+		printf ("%-16s fpu_fast off %5.1f ns  on %5.1f ns\n", insns[k].name, t[0] * 1e9 / count, t[1] * 1e9 / count);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	int n = argc > 1 ? atoi (argv[1]) : 5000000;
+	int bad = 0, fast = 0;
+	static struct state init, a, b;
+
+	ram_bank.xlateaddr = ram_xlate;
+	for (int i = 0; i < MEMORY_BANKS; i++)
+		mem_banks[i] = &ram_bank;
+	for (int i = 0; i < RAM_SIZE; i++)
+		ram[i] = rnd ();
+
+	for (int t = 0; t < n; t++) {
+		uae_u32 opcode;
+		uae_u16 extra;
+
+		random_state (&opcode, &extra);
+		init.r = regs;
+		memcpy (init.ram, ram, RAM_SIZE);
+		run_insn (&init, &a, false, opcode, extra);
+		run_insn (&init, &b, true, opcode, extra);
+		/* did the fast path take it? */
+		regs = init.r;
+		memcpy (ram, init.ram, RAM_SIZE);
+		regs.pc_p = regs.pc_oldp = ibuf;
+		fpp_set_fpcr (regs.fpcr);
+		fast += fpuop_arithmetic_fast (opcode, extra);
+
+		if (!same (&a, &b) && bad++ < 10)
+			printf ("fpu: %04x %04x differs: fpcr %04x model %d/%d fpsr %08x/%08x illg %d/%d exc %d/%d\n",
+				opcode, extra, init.r.fpcr, currprefs.cpu_model, currprefs.fpu_model,
+				a.r.fpsr, b.r.fpsr, a.illg, b.illg, a.exc, b.exc);
+	}
+	printf ("fpu: %d instructions, %d on the fast path, %d differ\n", n, fast, bad);
+	bench ();
+	printf ("fpu: %s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * HAM decoding check.
+ *
+ * decode_ham() in drawing.cpp resolves HAM from keep/set tables, eight
+ * pixels at a time with NEON. This runs init_ham_decoding() and decode_ham()
+ * from drawing.cpp, built with HAM_CHECK set, over random lines in OCS HAM6,
+ * AGA HAM6 and HAM8 (with and without BPLCON4 xor), plain colour lines, and
+ * palette changes between spans. The result is compared with the per-pixel
+ * switch decode_ham() used before, and with HAM_CHECK's own log.
+ *
+ * Build with -DARMV6T2 for the bit field channel updates and with
+ * -DHAM_NEON to run the NEON path; off ARM the few NEON intrinsics it uses
+ * are done in C below.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+typedef uint8_t uae_u8;
+typedef uint16_t uae_u16;
+typedef uint32_t uae_u32;
+typedef uae_u32 xcolnr;
+typedef char TCHAR;
+
+#define STATIC_INLINE static inline
+#define _T(x) x
+
+static int mismatches;
+
+static void write_log (const TCHAR *format, ...)
+{
+  va_list parms;
+
+  va_start (parms, format);
+  vprintf (format, parms);
+  va_end (parms);
+  mismatches++;
+}
+
+static struct {
+  xcolnr acolors[256];
+} colors_for_drawing;
+static struct {
+  uae_u8 apixels[4096];
+} pixdata;
+static uae_u16 ham_linebuf[4096];
+static int bplxor, bplham, aga_mode, bplplanecnt, unpainted, src_pixel;
+
+static int res_shift_from_window (int x) { return x; }
+
+#ifdef ARMV6T2
+/* the ubfx/bfi sequences of drawing.cpp */
+static inline int bfi (int col, int v, int lsb, int width)
+{
+  int m = ((1 << width) - 1) << lsb;
+  return (col & ~m) | ((v << lsb) & m);
+}
+STATIC_INLINE int DECODE_HAM8_1(int col, int pv) { return bfi (col, (pv >> 3) & 31, 0, 5); }
+STATIC_INLINE int DECODE_HAM8_2(int col, int pv) { return bfi (col, (pv >> 3) & 31, 11, 5); }
+STATIC_INLINE int DECODE_HAM8_3(int col, int pv) { return bfi (col, (pv >> 2) & 63, 5, 6); }
+STATIC_INLINE int DECODE_HAM6_1(int col, int pv) { return bfi (col, pv, 1, 4); }
+STATIC_INLINE int DECODE_HAM6_2(int col, int pv) { return bfi (col, pv, 12, 4); }
+STATIC_INLINE int DECODE_HAM6_3(int col, int pv) { return bfi (col, pv, 7, 4); }
+#endif
+
+#ifdef HAM_NEON
+#define USE_ARMNEON
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#else
+#define __ARM_NEON__
+struct uint16x8_t { uae_u16 v[8]; };
+static uint16x8_t vdupq_n_u16 (uae_u16 x)
+{
+  uint16x8_t r;
+  for (int i = 0; i < 8; i++)
+    r.v[i] = x;
+  return r;
+}
+static uint16x8_t vld1q_u16 (const uae_u16 *p)
+{
+  uint16x8_t r;
+  memcpy (r.v, p, sizeof r.v);
+  return r;
+}
+static void vst1q_u16 (uae_u16 *p, uint16x8_t a) { memcpy (p, a.v, sizeof a.v); }
+static uint16x8_t vandq_u16 (uint16x8_t a, uint16x8_t b)
+{
+  for (int i = 0; i < 8; i++)
+    a.v[i] &= b.v[i];
+  return a;
+}
+static uint16x8_t vorrq_u16 (uint16x8_t a, uint16x8_t b)
+{
+  for (int i = 0; i < 8; i++)
+    a.v[i] |= b.v[i];
+  return a;
+}
+static uint16x8_t vextq_u16 (uint16x8_t a, uint16x8_t b, int n)
+{
+  uint16x8_t r;
+  for (int i = 0; i < 8; i++)
+    r.v[i] = i + n < 8 ? a.v[i + n] : b.v[i + n - 8];
+  return r;
+}
+static uae_u16 vgetq_lane_u16 (uint16x8_t a, int n) { return a.v[n]; }
+#endif
+#endif
+
+/* live code from drawing.cpp */
+#include "ham.inc"
+
+/* The decoder decode_ham() replaced: one switch per pixel. */
+static uae_u16 ref_lastcolor;
+static int ref_pixel;
+static uae_u16 ref_linebuf[4096];
+
+static void ref_step (void)
+{
+	int pv = pixdata.apixels[ref_pixel];
+
+	if (!bplham) {
+		if (aga_mode)
+			ref_lastcolor = colors_for_drawing.acolors[pv ^ bplxor];
+		else
+			ref_lastcolor = colors_for_drawing.acolors[pv];
+	} else if (aga_mode) {
+		pv ^= bplxor;
+		if (bplplanecnt >= 7) { /* AGA mode HAM8 */
+			switch (pv & 0x3)
+			{
+				case 0x0: ref_lastcolor = colors_for_drawing.acolors[pv >> 2]; break;
+#ifdef ARMV6T2
+				case 0x1: ref_lastcolor = DECODE_HAM8_1(ref_lastcolor, pv); break;
+				case 0x2: ref_lastcolor = DECODE_HAM8_2(ref_lastcolor, pv); break;
+				case 0x3: ref_lastcolor = DECODE_HAM8_3(ref_lastcolor, pv); break;
+#else
+				case 0x1: ref_lastcolor &= 0xFFFF03; ref_lastcolor |= (pv & 0xFC); break;
+				case 0x2: ref_lastcolor &= 0x03FFFF; ref_lastcolor |= (pv & 0xFC) << 16; break;
+				case 0x3: ref_lastcolor &= 0xFF03FF; ref_lastcolor |= (pv & 0xFC) << 8; break;
+#endif
+			}
+		} else { /* AGA mode HAM6 */
+			uae_u32 pc = ((pv & 0xf) << 0) | ((pv & 0xf) << 4);
+			switch (pv & 0x30)
+			{
+				case 0x00: ref_lastcolor = colors_for_drawing.acolors[pv]; break;
+#ifdef ARMV6T2
+				case 0x10: ref_lastcolor = DECODE_HAM8_1(ref_lastcolor, pc); break;
+				case 0x20: ref_lastcolor = DECODE_HAM8_2(ref_lastcolor, pc); break;
+				case 0x30: ref_lastcolor = DECODE_HAM8_3(ref_lastcolor, pc); break;
+#else
+				case 0x10: ref_lastcolor &= 0xFFFF00; ref_lastcolor |= (pv & 0xF) << 4; break;
+				case 0x20: ref_lastcolor &= 0x00FFFF; ref_lastcolor |= (pv & 0xF) << 20; break;
+				case 0x30: ref_lastcolor &= 0xFF00FF; ref_lastcolor |= (pv & 0xF) << 12; break;
+#endif
+			}
+		}
+	} else { /* OCS/ECS mode HAM6 */
+		switch (pv & 0x30)
+		{
+			case 0x00: ref_lastcolor = colors_for_drawing.acolors[pv]; break;
+#ifdef ARMV6T2
+			case 0x10: ref_lastcolor = DECODE_HAM6_1(ref_lastcolor, pv); break;
+			case 0x20: ref_lastcolor = DECODE_HAM6_2(ref_lastcolor, pv); break;
+			case 0x30: ref_lastcolor = DECODE_HAM6_3(ref_lastcolor, pv); break;
+#else
+			case 0x10: ref_lastcolor &= 0xFFE1; ref_lastcolor |= (pv & 0xF) << 1; break;
+			case 0x20: ref_lastcolor &= 0x0FFF; ref_lastcolor |= (pv & 0xF) << 12; break;
+			case 0x30: ref_lastcolor &= 0xF87F; ref_lastcolor |= (pv & 0xF) << 7; break;
+#endif
+		}
+	}
+	ref_pixel++;
+}
+
+static void ref_init (void)
+{
+	ref_pixel = src_pixel;
+	ref_lastcolor = colors_for_drawing.acolors[0];
+	if (!bplham) {
+		if (unpainted > 0) {
+			ref_pixel += unpainted - 1;
+			ref_step ();
+			ref_pixel = src_pixel;
+		}
+	} else {
+		for (int i = 0; i < unpainted; i++)
+			ref_step ();
+	}
+}
+
+static void ref_decode (int pix, int stoppos)
+{
+	for (int n = res_shift_from_window (stoppos - pix); n > 0; n--) {
+		int p = ref_pixel;
+		ref_step ();
+		ref_linebuf[p] = ref_lastcolor;
+	}
+}
+
+int main (int argc, char **argv)
+{
+	int lines = argc > 1 ? atoi (argv[1]) : 30000;
+	int bad = 0;
+
+	srand (1);
+	for (int it = 0; it < lines; it++) {
+		for (int i = 0; i < 256; i++)
+			colors_for_drawing.acolors[i] = rand () ^ (rand () << 16);
+		/* random lines, and lines of mostly channel updates */
+		int updates = rand () % 4;
+		for (int i = 0; i < 4096; i++)
+			pixdata.apixels[i] = !updates || rand () % 8 == 0 ? rand ()
+				: rand () | ((rand () & 1) ? 0x30 : 0x03);
+		bplham = rand () % 8 != 0;
+		aga_mode = rand () & 1;
+		bplplanecnt = (rand () & 1) ? 8 : 6;
+		bplxor = rand () % 3 == 0 ? rand () & 255 : 0;
+		src_pixel = rand () % 64;
+		unpainted = rand () % 40;
+
+		init_ham_decoding ();
+		ref_init ();
+		int start = ref_pixel, pos = 0;
+		for (int span = 0; span < 4; span++) {
+			int len = rand () % 300;
+			if (span && (rand () & 1))
+				colors_for_drawing.acolors[rand () & 255] = rand ();
+			decode_ham (pos, pos + len);
+			ref_decode (pos, pos + len);
+			pos += len;
+		}
+		if (ref_lastcolor != ham_lastcolor || ref_pixel != ham_decode_pixel
+			|| memcmp (ref_linebuf + start, ham_linebuf + start, (ref_pixel - start) * sizeof (uae_u16))) {
+			if (bad++ < 10)
+				printf ("line %d differs: aga %d planes %d ham %d xor %02x\n",
+					it, aga_mode, bplplanecnt, bplham, bplxor);
+		}
+	}
+	printf ("ham: %d lines, %d differ, %d HAM_CHECK mismatches: %s\n",
+		lines, bad, mismatches, bad || mismatches ? "FAILED" : "ok");
+	return bad || mismatches ? 1 : 0;
+}
@@ -0,0 +1,437 @@
+/*
+ * IDE data port fast path check and benchmark.
+ *
+ * ide_get_data() and ide_put_data() in ide.cpp serve the words inside a
+ * block straight from secbuf once ide_get_data_2()/ide_put_data_2() has
+ * opened a window with ide_pio_window(). This runs that code and the data
+ * port code it replaced (kept below in namespace old) in lockstep on 4M
+ * random accesses: 8 and 16 bit reads and writes, random block sizes,
+ * multiple counts, ATAPI packets and negative sizes, command restarts and
+ * register writes that close the window. Every returned word, the buffer
+ * and all the transfer state must match after each access.
+ *
+ * The benchmark then reads and writes 64 MB in 64 KB commands, one and 16
+ * sectors per DRQ block, through both and prints the host time per word.
+ * Build with -DIDE_PIO_STATS=1 to also get the IDE_PIO_STATS line of the
+ * last command of each run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef uint8_t uae_u8;
+typedef uint16_t uae_u16;
+typedef uint32_t uae_u32;
+typedef uint64_t uae_u64;
+typedef unsigned long frame_time_t;
+typedef char TCHAR;
+
+#define _T(x) x
+#define IDE_LOG 0
+#define IDE_STATUS_DRQ 0x08
+
+static bool quiet = true;
+
+static void write_log (const TCHAR *format, ...)
+{
+  va_list parms;
+
+  if (quiet)
+    return;
+  va_start (parms, format);
+  vprintf (format, parms);
+  va_end (parms);
+}
+
+static uae_u32 m68k_getpc (void) { return 0; }
+
+static frame_time_t read_processor_time (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct ide_registers
+{
+  uae_u8 ide_status, ide_hcyl, ide_lcyl;
+};
+
+/* the fields the data port code uses */
+struct ide_hdf
+{
+  struct ide_registers regs;
+  uae_u8 *secbuf;
+  int secbuf_size;
+  int buffer_offset, data_offset, data_size, data_multi, direction;
+  int num, blocksize;
+  int packet_state, packet_data_size, packet_data_offset, packet_transfer_size;
+  int pio_words, pio_offset;
+  bool pio_write;
+  /* what the stubs below were asked to do, in order */
+  uae_u32 events;
+};
+
+static void ide_grow_buffer (struct ide_hdf *ide, int newsize)
+{
+  if (ide->secbuf_size >= newsize)
+    return;
+  uae_u8 *old = ide->secbuf;
+  int oldsize = ide->secbuf_size;
+  ide->secbuf_size = newsize + 16384;
+  ide->secbuf = (uae_u8 *)calloc (ide->secbuf_size, 1);
+  memcpy (ide->secbuf, old, oldsize);
+  free (old);
+}
+
+static bool ide_isdrive (struct ide_hdf *) { return true; }
+static void ide_fast_interrupt (struct ide_hdf *ide) { ide->events = ide->events * 31 + 1; }
+static void process_rw_command (struct ide_hdf *ide) { ide->events = ide->events * 31 + 3; }
+
+/* next block: the real one reads or writes the disk and raises an
+   interrupt; this changes a few bytes where the block goes */
+static void do_process_rw_command (struct ide_hdf *ide)
+{
+  ide->data_offset = 0;
+  ide->events = ide->events * 31 + 2;
+  ide_grow_buffer (ide, ide->buffer_offset + 8192);
+  for (int i = 0; i < 64; i++)
+    ide->secbuf[(ide->buffer_offset + i * 7) % ide->secbuf_size] ^= i;
+}
+
+static void process_packet_command (struct ide_hdf *ide)
+{
+  ide->events = ide->events * 31 + 4;
+  ide->data_offset = 0;
+  ide->packet_data_offset += ide->packet_transfer_size;
+}
+
+static void atapi_data_done (struct ide_hdf *ide)
+{
+  ide->events = ide->events * 31 + 5;
+  ide->data_size = 0;
+  ide->packet_data_offset = 0;
+  ide->data_offset = 0;
+}
+
+/* live code from ide.cpp */
+namespace live {
+#include "ide-pio.inc"
+#include "ide-data.inc"
+}
+
+/* The data port code before the fast path. */
+namespace old {
+static uae_u16 ide_get_data_2(struct ide_hdf *ide, int bussize)
+{
+	bool irq = false;
+	uae_u16 v;
+	int inc = bussize ? 2 : 1;
+
+	if (ide->data_size == 0) {
+		if (IDE_LOG > 0)
+			write_log (_T("IDE%d DATA but no data left!? %02X PC=%08X\n"), ide->num, ide->regs.ide_status, m68k_getpc ());
+		if (!ide_isdrive (ide))
+			return 0xffff;
+		return 0;
+	}
+	if (ide->packet_state) {
+		if (bussize) {
+			v = ide->secbuf[ide->packet_data_offset + ide->data_offset + 1] | (ide->secbuf[ide->packet_data_offset + ide->data_offset + 0] << 8);
+		} else {
+			v = ide->secbuf[(ide->packet_data_offset + ide->data_offset)];
+		}
+		if (IDE_LOG > 4)
+			write_log (_T("IDE%d DATA read %04x\n"), ide->num, v);
+		ide->data_offset += inc;
+		if (ide->data_size < 0)
+			ide->data_size += inc;
+		else
+			ide->data_size -= inc;
+		if (ide->data_offset == ide->packet_transfer_size) {
+			if (IDE_LOG > 1)
+				write_log (_T("IDE%d ATAPI partial read finished, %d bytes remaining\n"), ide->num, ide->data_size);
+			if (ide->data_size == 0 || ide->data_size == 1) { // 1 byte remaining: ignore, ATAPI has word transfer size.
+				ide->packet_state = 0;
+				atapi_data_done (ide);
+				if (IDE_LOG > 1)
+					write_log (_T("IDE%d ATAPI read finished, %d bytes\n"), ide->num, ide->packet_data_offset + ide->data_offset);
+				irq = true;
+			} else {
+				process_packet_command (ide);
+			}
+		}
+	} else {
+		if (bussize) {
+			v = ide->secbuf[ide->buffer_offset + ide->data_offset + 1] | (ide->secbuf[ide->buffer_offset + ide->data_offset + 0] << 8);
+		} else {
+			v = ide->secbuf[(ide->buffer_offset + ide->data_offset)];
+		}
+		if (IDE_LOG > 4)
+			write_log (_T("IDE%d DATA read %04x %d/%d\n"), ide->num, v, ide->data_offset, ide->data_size);
+		ide->data_offset += inc;
+		if (ide->data_size < 0) {
+			ide->data_size += inc;
+		} else {
+			ide->data_size -= inc;
+			if (((ide->data_offset % ide->blocksize) == 0) && ((ide->data_offset / ide->blocksize) % ide->data_multi) == 0) {
+				if (ide->data_size) {
+					ide->buffer_offset += ide->data_offset;
+					do_process_rw_command(ide);
+				}
+			}
+		}
+		if (ide->data_size == 0) {
+			if (!(ide->regs.ide_status & IDE_STATUS_DRQ)) {
+				write_log (_T("IDE%d read finished but DRQ was not active?\n"), ide->num);
+			}
+			ide->regs.ide_status &= ~IDE_STATUS_DRQ;
+			if (IDE_LOG > 1)
+				write_log (_T("IDE%d read finished\n"), ide->num);
+		}
+	}
+	if (irq)
+		ide_fast_interrupt (ide);
+	return v;
+}
+
+uae_u16 ide_get_data(struct ide_hdf *ide)
+{
+	return ide_get_data_2(ide, 1);
+}
+uae_u8 ide_get_data_8bit(struct ide_hdf *ide)
+{
+	return (uae_u8)ide_get_data_2(ide, 0);
+}
+
+static void ide_put_data_2(struct ide_hdf *ide, uae_u16 v, int bussize)
+{
+	int inc = bussize ? 2 : 1;
+	if (IDE_LOG > 4)
+		write_log (_T("IDE%d DATA write %04x %d/%d\n"), ide->num, v, ide->data_offset, ide->data_size);
+	if (ide->data_size == 0) {
+		if (IDE_LOG > 0)
+			write_log (_T("IDE%d DATA write without request!? %02X PC=%08X\n"), ide->num, ide->regs.ide_status, m68k_getpc ());
+		return;
+	}
+	ide_grow_buffer(ide, ide->packet_data_offset + ide->data_offset + 2);
+	if (ide->packet_state) {
+		if (bussize) {
+			ide->secbuf[ide->packet_data_offset + ide->data_offset + 1] = v & 0xff;
+			ide->secbuf[ide->packet_data_offset + ide->data_offset + 0] = v >> 8;
+		} else {
+			ide->secbuf[(ide->packet_data_offset + ide->data_offset) ^ 1] = v;
+		}
+	} else {
+		if (bussize) {
+			ide->secbuf[ide->buffer_offset + ide->data_offset + 1] = v & 0xff;
+			ide->secbuf[ide->buffer_offset + ide->data_offset + 0] = v >> 8;
+		} else {
+			ide->secbuf[(ide->buffer_offset + ide->data_offset)] = v;
+		}
+	}
+	ide->data_offset += inc;
+	ide->data_size -= inc;
+	if (ide->packet_state) {
+		if (ide->data_offset == ide->packet_transfer_size) {
+			if (IDE_LOG > 0) {
+				uae_u16 v = (ide->regs.ide_hcyl << 8) | ide->regs.ide_lcyl;
+				write_log (_T("Data size after command received = %d (%d)\n"), v, ide->packet_data_size);
+			}
+			process_packet_command (ide);
+		}
+	} else {
+		if (ide->data_size == 0) {
+			process_rw_command (ide);
+		} else if (((ide->data_offset % ide->blocksize) == 0) && ((ide->data_offset / ide->blocksize) % ide->data_multi) == 0) {
+			int off = ide->data_offset;
+			do_process_rw_command(ide);
+			ide->buffer_offset += off;
+		}
+	}
+}
+
+void ide_put_data(struct ide_hdf *ide, uae_u16 v)
+{
+	ide_put_data_2(ide, v, 1);
+}
+void ide_put_data_8bit(struct ide_hdf *ide, uae_u8 v)
+{
+	ide_put_data_2(ide, v, 0);
+}
+
+}
+
+static bool same (const struct ide_hdf *a, const struct ide_hdf *b)
+{
+  return a->buffer_offset == b->buffer_offset && a->data_offset == b->data_offset
+    && a->data_size == b->data_size && a->events == b->events
+    && a->regs.ide_status == b->regs.ide_status && a->packet_state == b->packet_state
+    && a->packet_data_offset == b->packet_data_offset && a->secbuf_size == b->secbuf_size
+    && !memcmp (a->secbuf, b->secbuf, a->secbuf_size);
+}
+
+/* what ide_read_sectors/ide_write_sectors and the ATAPI code set up */
+static void start_command (struct ide_hdf *ide, int blocksize, int multi, int size, int packet, int dir)
+{
+  ide->blocksize = blocksize;
+  ide->data_multi = multi;
+  ide->data_offset = 0;
+  ide->data_size = size;
+  ide->buffer_offset = 0;
+  ide->direction = dir;
+  ide->packet_state = packet;
+  ide->packet_transfer_size = blocksize * 2;
+  ide->packet_data_offset = 0;
+  ide->regs.ide_status |= IDE_STATUS_DRQ;
+}
+
+static void init_unit (struct ide_hdf *ide)
+{
+  memset (ide, 0, sizeof *ide);
+  ide->secbuf_size = 65536;
+  ide->secbuf = (uae_u8 *)malloc (ide->secbuf_size);
+  for (int i = 0; i < ide->secbuf_size; i++)
+    ide->secbuf[i] = rand ();
+  ide->blocksize = 512;
+  ide->data_multi = 1;
+}
+
+static void copy_unit (struct ide_hdf *to, const struct ide_hdf *from)
+{
+  *to = *from;
+  to->secbuf = (uae_u8 *)malloc (from->secbuf_size);
+  memcpy (to->secbuf, from->secbuf, from->secbuf_size);
+}
+
+static int lockstep (int units, int accesses, long *windowed)
+{
+  int bad = 0;
+
+  srand (11);
+  *windowed = 0;
+  for (int u = 0; u < units; u++) {
+    struct ide_hdf a, b;
+    init_unit (&a);
+    copy_unit (&b, &a);
+    for (int k = 0; k < accesses; k++) {
+      int r = rand () % 1000;
+      if (r < 3) {
+        int multi = rand () % 2 ? 1 : 1 << (rand () % 5);
+        int bs = rand () % 4 ? 512 : (rand () % 2 ? 256 : 2048);
+        int size = (1 + rand () % 20) * bs;
+        int packet = rand () % 8 == 0;
+        int dir = rand () & 1;
+        if (rand () % 30 == 0)
+          size = -size;
+        start_command (&a, bs, multi, size, packet, dir);
+        start_command (&b, bs, multi, size, packet, dir);
+        live::ide_pio_start (&b);
+      } else if (r < 6) {
+        /* ide_write_reg () */
+        b.pio_words = 0;
+      } else {
+        int op = rand () % 20;
+        *windowed += b.pio_words > 0 && op < 18;
+        if (op < 10) {
+          if (old::ide_get_data (&a) != live::ide_get_data (&b))
+            bad++;
+        } else if (op < 18) {
+          uae_u16 v = rand ();
+          old::ide_put_data (&a, v);
+          live::ide_put_data (&b, v);
+        } else if (op < 19) {
+          if (old::ide_get_data_8bit (&a) != live::ide_get_data_8bit (&b))
+            bad++;
+        } else {
+          uae_u8 v = rand ();
+          old::ide_put_data_8bit (&a, v);
+          live::ide_put_data_8bit (&b, v);
+        }
+      }
+      if (!same (&a, &b)) {
+        if (bad++ < 10)
+          printf ("ide: unit %d access %d: transfer state differs\n", u, k);
+        break;
+      }
+    }
+    free (a.secbuf);
+    free (b.secbuf);
+  }
+  return bad;
+}
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define BENCH_COMMAND (64 * 1024)
+
+/* A guest copy loop moving total bytes through the data port in
+   BENCH_COMMAND byte commands. */
+static double transfer (struct ide_hdf *ide, bool fast, int dir, int multi, int total, uae_u32 *sum)
+{
+  double t = now ();
+
+  for (int done = 0; done < total; done += BENCH_COMMAND) {
+    quiet = done + BENCH_COMMAND < total;
+    start_command (ide, 512, multi, BENCH_COMMAND, 0, dir);
+    ide->num = 0;
+    if (fast)
+      live::ide_pio_start (ide);
+    if (!dir)
+      do_process_rw_command (ide);
+    for (int i = 0; i < BENCH_COMMAND / 2; i++) {
+      if (dir) {
+        if (fast)
+          live::ide_put_data (ide, i);
+        else
+          old::ide_put_data (ide, i);
+      } else {
+        *sum += fast ? live::ide_get_data (ide) : old::ide_get_data (ide);
+      }
+    }
+  }
+  quiet = true;
+  return now () - t;
+}
+
+int main (int argc, char **argv)
+{
+  int units = argc > 1 ? atoi (argv[1]) : 200;
+  int mb = argc > 2 ? atoi (argv[2]) : 64;
+  long windowed;
+
+  int bad = lockstep (units, 20000, &windowed);
+  printf ("ide: %d accesses, %ld%% in a window, %d differ\n", units * 20000,
+    (long)(windowed * 100 / ((long)units * 20000)), bad);
+
+  printf ("ide: %d MB in %d KB commands, host time per data port word\n", mb, BENCH_COMMAND / 1024);
+  for (int dir = 0; dir < 2; dir++) {
+    for (int multi = 1; multi <= 16; multi *= 16) {
+      uae_u32 sum[2] = { 0, 0 };
+      double t[2];
+      for (int fast = 0; fast < 2; fast++) {
+        struct ide_hdf ide;
+        srand (3);
+        init_unit (&ide);
+        t[fast] = transfer (&ide, fast, dir, multi, mb * 1024 * 1024, &sum[fast]);
+        free (ide.secbuf);
+      }
+      double words = mb * 1024.0 * 1024 / 2;
+      printf ("%-5s multi %2d  old %5.2f ns/word (%5.0f MB/s)  new %5.2f ns/word (%5.0f MB/s)\n",
+        dir ? "write" : "read", multi, t[0] * 1e9 / words, mb / t[0], t[1] * 1e9 / words, mb / t[1]);
+      if (sum[0] != sum[1])
+        bad++;
+    }
+  }
+  printf ("ide: %s\n", bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}
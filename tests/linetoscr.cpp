@@ -0,0 +1,231 @@
+/*
+ * Line to screen converter check.
+ *
+ * linetoscr.cpp has the per-pixel 16 bit converters and block versions of
+ * them (the *_vec functions) that drawing.cpp uses when linetoscr_vector()
+ * says so. This includes linetoscr.cpp and runs every per-pixel/block pair
+ * on the same random spans: OCS/ECS normal, stretch1 and shrink1 and AGA
+ * normal, stretch1, shrink1 and shrink2, each with plain, HAM, dual
+ * playfield and EHB lines, BPLCON4 xor and and masks, sprites over AGA dual
+ * playfield, both line buffer alignments and empty or negative spans. The
+ * whole line buffer and the returned spix must match.
+ *
+ * Build with -DLTS_NEON to run the NEON stores and shuffles; off ARM the
+ * intrinsics they use are done in C below. Off ARM the per-pixel
+ * converters use the C merge_words() and double_word().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t uae_u8;
+typedef uint16_t uae_u16;
+typedef uint32_t uae_u32;
+typedef uae_u32 xcolnr;
+
+#define STATIC_INLINE static inline
+#define NOINLINE __attribute__((noinline))
+#define _T(x) x
+#define write_log printf
+#define AGA
+
+static uae_u32 xredcolors[256], xgreencolors[256], xbluecolors[256];
+#define CONVERT_RGB(c) (xbluecolors[((uae_u8 *)(&c))[0]] | xgreencolors[((uae_u8 *)(&c))[1]] | xredcolors[((uae_u8 *)(&c))[2]])
+#define CONVERT_RGB_16(c) ((uae_u16)(xbluecolors[((uae_u8 *)(&c))[0]] | xgreencolors[((uae_u8 *)(&c))[1]] | xredcolors[((uae_u8 *)(&c))[2]]))
+
+/* drawing state the converters read */
+static struct {
+  uae_u16 color_regs_ecs[32];
+  uae_u32 color_regs_aga[256];
+} colors_for_drawing;
+static struct {
+  uae_u8 apixels[4096];
+} pixdata;
+static uae_u8 spritepixels[4096];
+static uae_u16 ham_linebuf[4096];
+static xcolnr acolors[256], xcolors[4096];
+static xcolnr *p_acolors = acolors, *p_xcolors = xcolors;
+static int bplham, bpldualpf, bpldualpfpri, bplehb, bplxor, bpland, bpldualpf2of;
+static int dblpfofs[4];
+static int dblpf_ind1[256], dblpf_ind2[256], dblpf_ind1_aga[256], dblpf_ind2_aga[256];
+static int dblpf_2nd1[256], dblpf_2nd2[256];
+static uae_u8 *xlinebuffer;
+
+#ifdef LTS_NEON
+#define USE_ARMNEON
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#else
+#define __ARM_NEON__
+struct uint16x4_t { uae_u16 v[4]; };
+struct uint16x8_t { uae_u16 v[8]; };
+struct uint32x4_t { uae_u32 v[4]; };
+struct uint16x8x2_t { uint16x8_t val[2]; };
+struct uint16x8x4_t { uint16x8_t val[4]; };
+static uint32x4_t vld1q_u32 (const uae_u32 *p)
+{
+  uint32x4_t r;
+  memcpy (r.v, p, sizeof r.v);
+  return r;
+}
+static uint16x8_t vld1q_u16 (const uae_u16 *p)
+{
+  uint16x8_t r;
+  memcpy (r.v, p, sizeof r.v);
+  return r;
+}
+static void vst1q_u16 (uae_u16 *p, uint16x8_t a) { memcpy (p, a.v, sizeof a.v); }
+static uint16x4_t vmovn_u32 (uint32x4_t a)
+{
+  uint16x4_t r;
+  for (int i = 0; i < 4; i++)
+    r.v[i] = a.v[i];
+  return r;
+}
+static uint16x8_t vcombine_u16 (uint16x4_t a, uint16x4_t b)
+{
+  uint16x8_t r;
+  for (int i = 0; i < 4; i++) {
+    r.v[i] = a.v[i];
+    r.v[i + 4] = b.v[i];
+  }
+  return r;
+}
+static uint16x8x2_t vld2q_u16 (const uae_u16 *p)
+{
+  uint16x8x2_t r;
+  for (int i = 0; i < 8; i++)
+    for (int k = 0; k < 2; k++)
+      r.val[k].v[i] = p[2 * i + k];
+  return r;
+}
+static uint16x8x4_t vld4q_u16 (const uae_u16 *p)
+{
+  uint16x8x4_t r;
+  for (int i = 0; i < 8; i++)
+    for (int k = 0; k < 4; k++)
+      r.val[k].v[i] = p[4 * i + k];
+  return r;
+}
+static uint16x8x2_t vzipq_u16 (uint16x8_t a, uint16x8_t b)
+{
+  uint16x8x2_t r;
+  for (int i = 0; i < 16; i++)
+    r.val[i / 8].v[i % 8] = (i & 1) ? b.v[i / 2] : a.v[i / 2];
+  return r;
+}
+#endif
+#endif
+
+/* live code, all of linetoscr.cpp */
+#include "linetoscr.inc"
+
+typedef int (*linetoscr_func) (int, int, int);
+static const struct {
+  const char *name;
+  linetoscr_func pixel, block;
+  int stretch;
+} funcs[] = {
+  { "16", linetoscr_16, linetoscr_16_vec, 0 },
+  { "16_stretch1", linetoscr_16_stretch1, linetoscr_16_stretch1_vec, 1 },
+  { "16_shrink1", linetoscr_16_shrink1, linetoscr_16_shrink1_vec, 0 },
+  { "16_aga", linetoscr_16_aga, linetoscr_16_aga_vec, 0 },
+  { "16_stretch1_aga", linetoscr_16_stretch1_aga, linetoscr_16_stretch1_aga_vec, 1 },
+  { "16_shrink1_aga", linetoscr_16_shrink1_aga, linetoscr_16_shrink1_aga_vec, 0 },
+  { "16_shrink2_aga", linetoscr_16_shrink2_aga, linetoscr_16_shrink2_aga_vec, 0 },
+};
+#define NR_FUNCS (int)(sizeof funcs / sizeof funcs[0])
+
+static uae_u8 buf_pixel[8192 + 64], buf_block[8192 + 64];
+
+static uae_u32 rnd_state = 1;
+
+/* xorshift, rand () is too slow for filling whole lines */
+static uae_u32 rnd (void)
+{
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 17;
+  rnd_state ^= rnd_state << 5;
+  return rnd_state;
+}
+
+static void new_palette (void)
+{
+  for (int i = 0; i < 256; i++) {
+    uae_u32 c = rnd () & 0xffff;
+    /* mostly both words the same, as xcolors are, but not always */
+    acolors[i] = rnd () % 8 ? c * 0x10001 : rnd ();
+    dblpf_ind1[i] = rnd () & 63;
+    dblpf_ind2[i] = rnd () & 63;
+    dblpf_ind1_aga[i] = rnd () & 255;
+    dblpf_ind2_aga[i] = rnd () & 255;
+    dblpf_2nd1[i] = rnd () & 1;
+    dblpf_2nd2[i] = rnd () & 1;
+    colors_for_drawing.color_regs_aga[i] = rnd ();
+  }
+  for (int i = 0; i < 4096; i++)
+    xcolors[i] = (rnd () & 0xffff) * 0x10001;
+  for (int i = 0; i < 32; i++)
+    colors_for_drawing.color_regs_ecs[i] = rnd () & 0xfff;
+  for (int i = 0; i < 4; i++)
+    dblpfofs[i] = rnd () & 255;
+}
+
+static void new_line (void)
+{
+  for (int i = 0; i < 4096; i++) {
+    uae_u32 r = rnd ();
+    pixdata.apixels[i] = r;
+    spritepixels[i] = (r >> 8) & 3 ? 0 : r >> 16;
+    ham_linebuf[i] = r >> 13;
+  }
+
+  int mode = rnd () % 4;
+  bplham = mode == 1;
+  bpldualpf = mode == 2;
+  bplehb = mode == 3;
+  bpldualpfpri = rnd () & 1;
+  bpldualpf2of = rnd () & 3;
+  bplxor = rnd () & 1 ? rnd () & 255 : 0;
+  bpland = rnd () & 1 ? 0xff : rnd () & 255;
+}
+
+int main (int argc, char **argv)
+{
+  int spans = argc > 1 ? atoi (argv[1]) : 200000;
+  int bad = 0;
+
+  for (int i = 0; i < 256; i++) {
+    xredcolors[i] = ((i >> 3) << 11) * 0x10001;
+    xgreencolors[i] = ((i >> 2) << 5) * 0x10001;
+    xbluecolors[i] = (i >> 3) * 0x10001;
+  }
+  for (int it = 0; it < spans; it++) {
+    int f = rnd () % NR_FUNCS;
+
+    if (it % 64 == 0)
+      new_palette ();
+    new_line ();
+    int spix = rnd () % 64;
+    int dpix = rnd () % 700;
+    int len = rnd () % 10 == 0 ? -(int)(rnd () % 3) : rnd () % (funcs[f].stretch ? 700 : 1200);
+    int align = rnd () & 1 ? 0 : 2;
+
+    memset (buf_pixel, 0x5a, sizeof buf_pixel);
+    memset (buf_block, 0x5a, sizeof buf_block);
+    xlinebuffer = buf_pixel + align;
+    int spix_pixel = funcs[f].pixel (spix, dpix, dpix + len);
+    xlinebuffer = buf_block + align;
+    int spix_block = funcs[f].block (spix, dpix, dpix + len);
+
+    if (spix_pixel != spix_block || memcmp (buf_pixel, buf_block, sizeof buf_pixel)) {
+      if (bad++ < 10)
+        printf ("linetoscr_%s: span %d differs (ham %d dualpf %d ehb %d, dpix %d len %d align %d, spix %d/%d)\n",
+          funcs[f].name, it, bplham, bpldualpf, bplehb, dpix, len, align, spix_pixel, spix_block);
+    }
+  }
+  printf ("linetoscr: %d spans over %d converter pairs, %d differ: %s\n", spans, NR_FUNCS, bad, bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}
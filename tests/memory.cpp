@@ -0,0 +1,290 @@
+/*
+ * Direct RAM/ROM access benchmark.
+ *
+ * get_long() and friends in memory.h go straight to host memory when
+ * mem_read_direct[]/mem_write_direct[] have a pointer for the 64k segment,
+ * and call the bank handlers otherwise. This fills the tables with
+ * memory_direct_update() from memory.cpp for 2 MB chip, 8 MB Zorro II fast
+ * and a 512k ROM, with a handler-only I/O bank beside them. It then times
+ * memory-bound loops through the memory.h accessors and through the
+ * handler-only accessors they replaced (kept below in namespace old):
+ *
+ *   copy    - long copy from chip to fast RAM
+ *   clear   - long writes over chip RAM
+ *   fetch   - word instruction fetches from ROM and fast RAM
+ *   mixed   - random byte, word and long accesses to all banks, one in
+ *             eight to a custom register, which takes the handler
+ *
+ * Both runs start from the same memory and must end with the same memory
+ * and the same checksum of everything read.
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <time.h>
+
+#include "options.h"
+#include "memory.h"
+
+addrbank *mem_banks[MEMORY_BANKS];
+uae_u8 *mem_read_direct[MEMORY_BANKS];
+uae_u8 *mem_write_direct[MEMORY_BANKS];
+
+addrbank chipmem_bank, kickmem_bank, custom_bank;
+addrbank fastmem_bank[MAX_RAM_BOARDS];
+static addrbank dummy_bank;
+
+/* the plain handlers, as memory.cpp has them */
+MEMORY_FUNCTIONS(chipmem);
+MEMORY_ARRAY_FUNCTIONS(fastmem, 0);
+MEMORY_FUNCTIONS(kickmem);
+
+static uae_u16 custom_regs[256];
+static uae_u32 REGPARAM2 custom_wget (uaecptr addr) { return custom_regs[(addr >> 1) & 255]; }
+static uae_u32 REGPARAM2 custom_lget (uaecptr addr) { return (custom_wget (addr) << 16) | custom_wget (addr + 2); }
+static uae_u32 REGPARAM2 custom_bget (uaecptr addr) { return custom_wget (addr) >> (addr & 1 ? 0 : 8); }
+static void REGPARAM2 custom_wput (uaecptr addr, uae_u32 v) { custom_regs[(addr >> 1) & 255] = v; }
+static void REGPARAM2 custom_lput (uaecptr addr, uae_u32 v) { custom_wput (addr, v >> 16); custom_wput (addr + 2, v); }
+static void REGPARAM2 custom_bput (uaecptr addr, uae_u32 v) { custom_wput (addr, v * 0x101); }
+static void REGPARAM2 kickmem_ignore (uaecptr, uae_u32) { }
+static uae_u32 REGPARAM2 dummy_get (uaecptr) { return 0; }
+static void REGPARAM2 dummy_put (uaecptr, uae_u32) { }
+
+/* live code from memory.cpp */
+#include "memory.inc"
+
+/* The accessors before the direct tables. */
+namespace old {
+STATIC_INLINE uae_u32 get_long(uaecptr addr)
+{
+  return longget(addr);
+}
+STATIC_INLINE uae_u32 get_word(uaecptr addr)
+{
+  return wordget(addr);
+}
+STATIC_INLINE uae_u32 get_byte(uaecptr addr)
+{
+  return byteget(addr);
+}
+STATIC_INLINE uae_u32 get_wordi(uaecptr addr)
+{
+  return wordgeti(addr);
+}
+STATIC_INLINE void put_long(uaecptr addr, uae_u32 l)
+{
+    longput(addr, l);
+}
+STATIC_INLINE void put_word(uaecptr addr, uae_u32 w)
+{
+    wordput(addr, w);
+}
+STATIC_INLINE void put_byte(uaecptr addr, uae_u32 b)
+{
+    byteput(addr, b);
+}
+}
+
+static void set_bank (addrbank *ab, uaecptr start, uae_u32 size, int flags)
+{
+  ab->start = start;
+  ab->reserved_size = ab->allocated_size = size;
+  ab->mask = size - 1;
+  ab->flags = flags;
+  ab->baseaddr = (uae_u8 *)malloc (size);
+  for (unsigned int i = start >> 16; i < (start + size) >> 16; i++)
+    mem_banks[i] = ab;
+}
+
+static void set_handlers (addrbank *ab, mem_get_func lget, mem_get_func wget, mem_get_func bget,
+  mem_put_func lput, mem_put_func wput, mem_put_func bput)
+{
+  ab->lget = ab->lgeti = lget;
+  ab->wget = ab->wgeti = wget;
+  ab->bget = bget;
+  ab->lput = lput;
+  ab->wput = wput;
+  ab->bput = bput;
+}
+
+static void setup (void)
+{
+  set_handlers (&dummy_bank, dummy_get, dummy_get, dummy_get, dummy_put, dummy_put, dummy_put);
+  for (int i = 0; i < MEMORY_BANKS; i++)
+    mem_banks[i] = &dummy_bank;
+  set_handlers (&chipmem_bank, chipmem_lget, chipmem_wget, chipmem_bget, chipmem_lput, chipmem_wput, chipmem_bput);
+  set_bank (&chipmem_bank, 0, 0x200000, ABFLAG_RAM | ABFLAG_THREADSAFE | ABFLAG_CHIPRAM);
+  set_handlers (&fastmem_bank[0], fastmem0_lget, fastmem0_wget, fastmem0_bget, fastmem0_lput, fastmem0_wput, fastmem0_bput);
+  set_bank (&fastmem_bank[0], 0x200000, 0x800000, ABFLAG_RAM | ABFLAG_THREADSAFE);
+  set_handlers (&kickmem_bank, kickmem_lget, kickmem_wget, kickmem_bget, kickmem_ignore, kickmem_ignore, kickmem_ignore);
+  set_bank (&kickmem_bank, 0xf80000, 0x80000, ABFLAG_ROM | ABFLAG_THREADSAFE);
+  set_handlers (&custom_bank, custom_lget, custom_wget, custom_bget, custom_lput, custom_wput, custom_bput);
+  custom_bank.flags = ABFLAG_IO;
+  mem_banks[0xdf] = &custom_bank;
+  memory_direct_update (NULL);
+}
+
+/* the memory both runs start from, and what the first run left */
+static uae_u8 *start_image[3], *end_image[3];
+static addrbank *ram[3] = { &chipmem_bank, &fastmem_bank[0], &kickmem_bank };
+
+static void save (uae_u8 **image)
+{
+  for (int i = 0; i < 3; i++) {
+    if (!image[i])
+      image[i] = (uae_u8 *)malloc (ram[i]->allocated_size);
+    memcpy (image[i], ram[i]->baseaddr, ram[i]->allocated_size);
+  }
+}
+
+static void restore (uae_u8 **image)
+{
+  for (int i = 0; i < 3; i++)
+    memcpy (ram[i]->baseaddr, image[i], ram[i]->allocated_size);
+  memset (custom_regs, 0, sizeof custom_regs);
+}
+
+static bool same (uae_u8 **image)
+{
+  for (int i = 0; i < 3; i++)
+    if (memcmp (image[i], ram[i]->baseaddr, ram[i]->allocated_size))
+      return false;
+  return true;
+}
+
+#define FAST 0x200000
+#define ROM 0xf80000
+#define CUSTOM 0xdff000
+
+/* The loops, for the accessors of namespace NS. Each returns a checksum
+   of what it read and counts the accesses it made. */
+#define WORKLOADS(NS) \
+static uae_u32 copy_##NS (int passes, unsigned long *n) \
+{ \
+  for (int p = 0; p < passes; p++) \
+    for (uaecptr a = 0; a < 0x100000; a += 4) \
+      NS::put_long (FAST + ((a + p * 0x4000) & 0x7ffffc), NS::get_long (a)); \
+  *n = (unsigned long)passes * 0x100000 / 4 * 2; \
+  return 0; \
+} \
+static uae_u32 clear_##NS (int passes, unsigned long *n) \
+{ \
+  for (int p = 0; p < passes; p++) \
+    for (uaecptr a = 0; a < 0x200000; a += 4) \
+      NS::put_long (a, a ^ p); \
+  *n = (unsigned long)passes * 0x200000 / 4; \
+  return 0; \
+} \
+static uae_u32 fetch_##NS (int passes, unsigned long *n) \
+{ \
+  uae_u32 sum = 0; \
+  for (int p = 0; p < passes; p++) { \
+    for (uaecptr a = ROM; a < ROM + 0x80000; a += 2) \
+      sum += NS::get_wordi (a); \
+    for (uaecptr a = FAST; a < FAST + 0x80000; a += 2) \
+      sum += NS::get_wordi (a); \
+  } \
+  *n = (unsigned long)passes * 0x80000; \
+  return sum; \
+} \
+static uae_u32 mixed_##NS (int passes, unsigned long *n) \
+{ \
+  uae_u32 sum = 0, r = 1; \
+  for (int p = 0; p < passes; p++) { \
+    for (int i = 0; i < 0x100000; i++) { \
+      r ^= r << 13; r ^= r >> 17; r ^= r << 5; \
+      uaecptr a; \
+      switch (r & 7) { \
+      case 0: a = CUSTOM + ((r >> 8) & 0x1fe); break; \
+      case 1: case 2: a = (r >> 8) & 0x1ffffe; break; \
+      case 3: a = ROM + ((r >> 8) & 0x7fffe); break; \
+      default: a = FAST + ((r >> 8) & 0x7ffffe); break; \
+      } \
+      switch ((r >> 3) & 7) { \
+      case 0: sum += NS::get_byte (a); break; \
+      case 1: NS::put_byte (a, r >> 16); break; \
+      case 2: case 3: sum += NS::get_word (a); break; \
+      case 4: NS::put_word (a, sum); break; \
+      case 5: sum += NS::get_long (a & ~3); break; \
+      case 6: NS::put_long (a & ~3, sum ^ r); break; \
+      default: sum += NS::get_wordi (a); break; \
+      } \
+    } \
+  } \
+  *n = (unsigned long)passes * 0x100000; \
+  return sum; \
+}
+
+namespace live {
+using ::get_long; using ::get_word; using ::get_byte; using ::get_wordi;
+using ::put_long; using ::put_word; using ::put_byte;
+}
+WORKLOADS(old)
+WORKLOADS(live)
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef uae_u32 (*workload) (int, unsigned long *);
+
+/* best of 3, from the same memory each time */
+static double run (workload w, int passes, uae_u32 *sum, unsigned long *n)
+{
+  double best = 1e9;
+
+  for (int i = 0; i < 3; i++) {
+    restore (start_image);
+    double t = now ();
+    *sum = w (passes, n);
+    t = now () - t;
+    if (t < best)
+      best = t;
+  }
+  return best;
+}
+
+int main (int argc, char **argv)
+{
+  int passes = argc > 1 ? atoi (argv[1]) : 20;
+  int bad = 0;
+
+  static const struct {
+    const char *name;
+    workload before, after;
+  } loads[] = {
+    { "copy", copy_old, copy_live },
+    { "clear", clear_old, clear_live },
+    { "fetch", fetch_old, fetch_live },
+    { "mixed", mixed_old, mixed_live },
+  };
+
+  setup ();
+  int direct = 0;
+  for (int i = 0; i < MEMORY_BANKS; i++)
+    direct += mem_read_direct[i] != NULL;
+  srand (1);
+  for (int i = 0; i < 3; i++)
+    for (uae_u32 j = 0; j < ram[i]->allocated_size; j++)
+      ram[i]->baseaddr[j] = rand ();
+  save (start_image);
+
+  printf ("memory: %d direct segments, %d passes, best of 3\n", direct, passes);
+  for (int l = 0; l < 4; l++) {
+    uae_u32 sum_old, sum_new;
+    unsigned long n;
+    double t_old = run (loads[l].before, passes, &sum_old, &n);
+    save (end_image);
+    double t_new = run (loads[l].after, passes, &sum_new, &n);
+    bool ok = sum_old == sum_new && same (end_image);
+    printf ("%-6s %9lu accesses  handlers %6.1f ms (%5.2f ns)  direct %6.1f ms (%5.2f ns)  %s\n",
+      loads[l].name, n, t_old * 1000, t_old * 1e9 / n, t_new * 1000, t_new * 1e9 / n, ok ? "same" : "DIFFER");
+    bad += !ok;
+  }
+  printf ("memory: %s\n", bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}
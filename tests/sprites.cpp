@@ -0,0 +1,199 @@
+/*
+ * Sprite drawing check.
+ *
+ * The sprite drawing loops in drawing.cpp skip empty runs of the sprite
+ * buffer when SPRITE_SPAN_SKIP is set. This includes the loops twice, once
+ * with the skip and once as plain per-pixel loops, runs every OCS/ECS and
+ * AGA variant on the same random sprite lines, and requires the same
+ * playfield, HAM and sprite line buffers and the same sprite_first_x and
+ * sprite_last_x from both.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t uae_u8;
+typedef uint16_t uae_u16;
+typedef uint32_t uae_u32;
+typedef uint64_t uae_u64;
+typedef uae_u32 xcolnr;
+
+#define STATIC_INLINE static inline
+#define MAX_PIXELS_PER_LINE 1760
+#define MAX_SPR_PIXELS 4096
+#define DIW_DDF_OFFSET 1
+#define DISPLAY_LEFT_SHIFT 0x38
+
+struct sprite_entry
+{
+  unsigned short pos;
+  unsigned short max;
+  unsigned int first_pixel;
+  bool has_attached;
+};
+
+/* drawing state the loops read */
+static uae_u16 spixels[MAX_SPR_PIXELS];
+static union {
+  uae_u8 bytes[MAX_SPR_PIXELS];
+} spixstate;
+static int sprite_col_nat[65536], sprite_col_at[65536], sprite_bit[65536];
+static int dblpf_ms1[256], dblpf_ms2[256];
+static int bpldualpfpri, bplxor, pixels_offset, sprite_buffer_res;
+static int sbasecol[2] = { 16, 16 };
+static uae_u32 plf_sprite_mask, plf_sprite_mask_n16;
+static struct {
+  xcolnr acolors[256];
+} colors_for_drawing;
+
+/* and the ones they write */
+static union {
+  uae_u8 apixels[MAX_PIXELS_PER_LINE * 2];
+  uae_u16 apixels_w[MAX_PIXELS_PER_LINE * 2 / sizeof (uae_u16)];
+} pixdata;
+static uae_u16 ham_linebuf[MAX_PIXELS_PER_LINE * 2];
+static uae_u8 spritepixels[MAX_PIXELS_PER_LINE * 2];
+static int sprite_first_x, sprite_last_x;
+
+namespace span {
+#define SPRITE_SPAN_SKIP 1
+#include "sprites.inc"
+#undef SPRITE_SPAN_SKIP
+#undef SPRITE_SKIP_EMPTY
+}
+
+namespace ref {
+#define SPRITE_SPAN_SKIP 0
+#include "sprites.inc"
+#undef SPRITE_SPAN_SKIP
+#undef SPRITE_SKIP_EMPTY
+}
+
+#define FUNC(n) { #n, span::n, ref::n }
+static const struct {
+  const char *name;
+  void (*span) (struct sprite_entry *);
+  void (*ref) (struct sprite_entry *);
+} funcs[] = {
+  FUNC (draw_sprites_normal_sp_lo_nat), FUNC (draw_sprites_normal_sp_lo_at),
+  FUNC (draw_sprites_normal_ham_lo_nat), FUNC (draw_sprites_normal_ham_lo_at),
+  FUNC (draw_sprites_normal_dp_lo_nat), FUNC (draw_sprites_normal_dp_lo_at),
+  FUNC (draw_sprites_normal_sp_hi_nat), FUNC (draw_sprites_normal_sp_hi_at),
+  FUNC (draw_sprites_normal_ham_hi_nat), FUNC (draw_sprites_normal_ham_hi_at),
+  FUNC (draw_sprites_normal_dp_hi_nat), FUNC (draw_sprites_normal_dp_hi_at),
+  FUNC (draw_sprites_normal_sp_shi_nat),
+  FUNC (draw_sprites_aga_sp_lo_nat), FUNC (draw_sprites_aga_sp_lo_at),
+  FUNC (draw_sprites_aga_dp_lo_nat), FUNC (draw_sprites_aga_dp_lo_at),
+  FUNC (draw_sprites_aga_ham_lo_nat), FUNC (draw_sprites_aga_ham_lo_at),
+  FUNC (draw_sprites_aga_sp_hi_nat), FUNC (draw_sprites_aga_sp_hi_at),
+  FUNC (draw_sprites_aga_dp_hi_nat), FUNC (draw_sprites_aga_dp_hi_at),
+  FUNC (draw_sprites_aga_ham_hi_nat), FUNC (draw_sprites_aga_ham_hi_at),
+  FUNC (draw_sprites_aga_sp_shi_nat), FUNC (draw_sprites_aga_sp_shi_at),
+  FUNC (draw_sprites_aga_dp_shi_nat), FUNC (draw_sprites_aga_dp_shi_at),
+  FUNC (draw_sprites_aga_ham_shi_nat), FUNC (draw_sprites_aga_ham_shi_at),
+  FUNC (draw_sprites_aga_sp_shi2_nat), FUNC (draw_sprites_aga_sp_shi2_at),
+};
+#define NR_FUNCS (int)(sizeof funcs / sizeof funcs[0])
+
+static uae_u8 save_apixels[sizeof pixdata.apixels];
+static uae_u16 save_ham[MAX_PIXELS_PER_LINE * 2];
+static uae_u8 save_spritepixels[MAX_PIXELS_PER_LINE * 2];
+
+static void init_tables (void)
+{
+  for (int i = 0; i < 65536; i++) {
+    sprite_col_nat[i] = rand () & 15;
+    sprite_col_at[i] = rand () & 15;
+    sprite_bit[i] = 1 << (rand () & 7);
+  }
+  for (int i = 0; i < 256; i++) {
+    dblpf_ms1[i] = rand () % 17;
+    dblpf_ms2[i] = rand () % 17;
+    colors_for_drawing.acolors[i] = rand ();
+  }
+}
+
+/* A sprite line: mostly empty, with short runs and single pixels at
+   random alignments, so that every skip boundary gets hit. */
+static void new_line (struct sprite_entry *e)
+{
+  int len = 1 + rand () % 200;
+
+  e->pos = 300 + rand () % 200;
+  e->max = e->pos + len;
+  e->first_pixel = rand () % 64;
+  memset (spixels, 0, sizeof spixels);
+  for (int x = 0; x < len; ) {
+    if (rand () % 3) {
+      x += rand () % 24;
+      continue;
+    }
+    for (int run = 1 + rand () % 6; run-- > 0 && x < len; x++)
+      spixels[e->first_pixel + x] = rand () % 4 ? rand () : 0;
+  }
+  for (int i = 0; i < MAX_SPR_PIXELS; i++)
+    spixstate.bytes[i] = rand ();
+  for (unsigned int i = 0; i < sizeof pixdata.apixels; i++)
+    pixdata.apixels[i] = rand () % 3 ? 0 : rand ();
+  for (int i = 0; i < MAX_PIXELS_PER_LINE * 2; i++) {
+    ham_linebuf[i] = rand ();
+    spritepixels[i] = rand ();
+  }
+  sprite_buffer_res = rand () % 3;
+  pixels_offset = rand () % 128;
+  bpldualpfpri = rand () & 1;
+  bplxor = rand () & 255;
+  sbasecol[0] = (rand () & 15) << 4;
+  sbasecol[1] = (rand () & 15) << 4;
+  plf_sprite_mask = rand () ^ (rand () << 16);
+  plf_sprite_mask_n16 = rand () & 0xffff;
+}
+
+int main (int argc, char **argv)
+{
+  int lines = argc > 1 ? atoi (argv[1]) : 20000;
+  int bad = 0;
+
+  srand (7);
+  init_tables ();
+  for (int it = 0; it < lines; it++) {
+    struct sprite_entry e;
+    int f = it % NR_FUNCS;
+
+    new_line (&e);
+    memcpy (save_apixels, pixdata.apixels, sizeof save_apixels);
+    memcpy (save_ham, ham_linebuf, sizeof save_ham);
+    memcpy (save_spritepixels, spritepixels, sizeof save_spritepixels);
+
+    sprite_first_x = 100000;
+    sprite_last_x = -1;
+    funcs[f].ref (&e);
+    static uae_u8 ref_apixels[sizeof pixdata.apixels];
+    static uae_u16 ref_ham[MAX_PIXELS_PER_LINE * 2];
+    static uae_u8 ref_spritepixels[MAX_PIXELS_PER_LINE * 2];
+    int ref_first = sprite_first_x, ref_last = sprite_last_x;
+    memcpy (ref_apixels, pixdata.apixels, sizeof ref_apixels);
+    memcpy (ref_ham, ham_linebuf, sizeof ref_ham);
+    memcpy (ref_spritepixels, spritepixels, sizeof ref_spritepixels);
+
+    memcpy (pixdata.apixels, save_apixels, sizeof save_apixels);
+    memcpy (ham_linebuf, save_ham, sizeof save_ham);
+    memcpy (spritepixels, save_spritepixels, sizeof save_spritepixels);
+    sprite_first_x = 100000;
+    sprite_last_x = -1;
+    funcs[f].span (&e);
+
+    if (memcmp (ref_apixels, pixdata.apixels, sizeof ref_apixels)
+      || memcmp (ref_ham, ham_linebuf, sizeof ref_ham)
+      || memcmp (ref_spritepixels, spritepixels, sizeof ref_spritepixels)
+      || ref_first != sprite_first_x || ref_last != sprite_last_x) {
+      if (bad++ < 10)
+        printf ("%s: line %d differs (pos %d max %d, sprite res %d)\n",
+          funcs[f].name, it, e.pos, e.max, sprite_buffer_res);
+    }
+  }
+  printf ("sprites: %d lines over %d loops, %d differ: %s\n", lines, NR_FUNCS, bad, bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}